@@ -4,32 +4,211 @@
 #include <time.h>
 #include <conio.h>
 #include <ctype.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <errno.h>
 
 #ifdef _WIN32
     #include <windows.h>
-    #define CLEAR_SCREEN "cls"
+    #include <io.h>
+    #include <direct.h>
+    #define strcasecmp _stricmp
 #else
     #include <unistd.h>
-    #define CLEAR_SCREEN "clear"
+    #include <pthread.h>
+    #include <poll.h>
+    #include <signal.h>
+    #include <sys/socket.h>
+    #include <netinet/in.h>
+    #include <arpa/inet.h>
+    #include <sys/stat.h>
+    #include <sys/mman.h>
+    #include <sys/ioctl.h>
+    #include <sys/resource.h>
+    #include <sys/wait.h>
+    #ifdef __linux__
+        #include <sys/syscall.h>
+        #include <linux/futex.h>
+    #endif
 #endif
 
-// Constants
+// Constants (table limits and lot layout can be raised with -D for large lots or benchmarks)
+#ifndef MAX_USERS
 #define MAX_USERS 1000
+#endif
+#ifndef MAX_VEHICLES
 #define MAX_VEHICLES 2000
-#define MAX_SLOTS 100
+#endif
+#ifndef MAX_RESERVATIONS
 #define MAX_RESERVATIONS 5000
+#endif
+#ifndef MAX_PAYMENTS
 #define MAX_PAYMENTS 5000
+#endif
 #define MAX_STRING 100
+#define TIME_TEXT_SIZE 20 // "YYYY-MM-DD_HH:MM:SS" and its terminator
+#define ZONE_CACHE_DAYS 512 // UTC offsets remembered per day, a power of two
+#define CLOCK_REAL 0        // engine clock follows the system clock
+#define CLOCK_FIXED 1       // stands still until advanced
+#define CLOCK_ACCELERATED 2 // runs clock_rate times faster than real time
+#ifndef BIKE_SLOTS
 #define BIKE_SLOTS 40
+#endif
+#ifndef CAR_SLOTS
 #define CAR_SLOTS 40
+#endif
+#ifndef TRUCK_SLOTS
 #define TRUCK_SLOTS 20
+#endif
+#define MAX_SLOTS (BIKE_SLOTS + CAR_SLOTS + TRUCK_SLOTS)
 #define CONSOLE_WIDTH 80
 
+// Terminal renderer
+#define TERM_MAX_ROWS 100
+#define TERM_DEFAULT_ROWS 25
+#define TERM_DEFAULT_COLOR -1 // terminal's own foreground color
+
+// Task pool limits
+#define POOL_MAX_WORKERS 64
+#define POOL_DEQUE_SIZE 1024
+#define REPORT_CHUNK_ROWS 2048 // rows per report scan task
+
+// Batch script mode
+#define SCRIPT_COMMIT_EVERY 256 // commands per journal commit
+
+// Journal and ANPR ingestion
+#define JOURNAL_FILE "journal.txt"
+#define JOURNAL_CHECKPOINT_RECORDS 10000 // rewrite the snapshot after this many records
+#define ANPR_BATCH_MAX 256
+#define ANPR_POLL_MS 200
+#ifndef PLATE_INDEX_SIZE
+#define PLATE_INDEX_SIZE 4096 // power of two, at least 2 * MAX_VEHICLES
+#endif
+
+// Benchmark suite
+#define BENCH_DIR "bench_data" // scratch directory; real data is never touched
+#define BENCH_DEFAULT_OPS 1000
+#define BENCH_FILE_RUNS 3      // load/save repetitions
+#define BENCH_REPORT_RUNS 20
+
+// Capacity simulator
+#define SIM_DIR "sim_data" // scratch directory, one run_<n> subdirectory per run
+#define SIM_MAX_LAYOUTS 16
+#define SIM_DEFAULT_DAYS 7
+#define SIM_DEFAULT_RUNS 4
+#define SIM_DEFAULT_ARRIVALS "12,16,6" // bikes, cars, trucks per hour
+#define SIM_DEFAULT_STAY_HOURS 2.0
+#define SIM_MIN_STAY_HOURS (5 / 60.0)
+#define SIM_START_TIME "2025-03-03_00:00:00" // a Monday; --clock fixed@<time> overrides
+#define SIM_ARRIVE 1
+#define SIM_DEPART 0 // sorts first, so a slot freed at the same second can be reused
+
+// Startup profiler
+#define STARTUP_MAX_PHASES 24
+
+// Memory accounting
+#define MEMORY_MAX_AREAS 24
+
+// Workload capture and replay
+#define TRACE_MAGIC "SPTRACE2"
+#define TRACE_RECORD_MAX 16384
+#define CAPTURE_FLUSH_RECORDS 64
+#define REPLAY_DIR "replay_data" // scratch directory for the replayed journal
+
+// Metrics export (Prometheus text format, for the node_exporter textfile collector)
+#define METRICS_FILE "smart_park.prom"
+
+// Latency instrumentation
+#define LATENCY_FILE "latency_stats.txt"
+#define LATENCY_SUB_BUCKETS 8 // per power of two: about 12% resolution
+#define LATENCY_BUCKETS 256   // covers up to about 4 hours in microseconds
+
+// Load generator
+#define LOADGEN_MAX_CLIENTS 256
+#define LOADGEN_MAX_SECONDS 3600
+#define LOADGEN_MAX_RETRIES 5 // reserve attempts after a slot was taken by another client
+#define LOADGEN_BUCKETS 32    // latency histogram: bucket b holds [2^b, 2^(b+1)) us
+
+// Engine result codes (engine_* functions return an index >= 0 on success)
+#define ENGINE_OK 0
+#define ENGINE_ERR_NOT_FOUND -1
+#define ENGINE_ERR_DUPLICATE_PHONE -2
+#define ENGINE_ERR_DUPLICATE_EMAIL -3
+#define ENGINE_ERR_FULL -4
+#define ENGINE_ERR_INVALID -5
+#define ENGINE_ERR_UNAVAILABLE -6
+#define ENGINE_ERR_STATE -7
+
+// Session server
+#define SESSION_MAX 512
+#define SESSION_INPUT_MAX 128
+#define SESSION_POLL_MS 1000
+#define SESSION_REPLY_MAX 512
+#define SESSION_OUTPUT_MAX 65536 // unsent reply bytes per client; a client this far behind is dropped
+#define SESSION_FREE_LIST 32 // slot ids per !FREE reply
+
+// Multi-lot federation
+#define LOT_DIR_FORMAT "lot_%d" // data directory of each lot shard
+#define ROUTER_MAX_LOTS 32
+#define ROUTER_MAX_LINKS 256
+#define ROUTER_QUERY_MS 2000 // fan-out deadline for cross-lot queries
+#define ROUTER_ROLE_CLIENT -1 // router poll entries: client socket, lot socket, else a fan-out lot index
+#define ROUTER_ROLE_LOT -2
+
+// Log-shipping replication
+#define REPLICA_MAX 16
+#define REPLICA_HEARTBEAT_MS 500
+#define REPLICA_STALE_MS 3000 // replicas refuse reads once the primary is this quiet
+#define REPLICA_QUEUE_MAX (4 * 1024 * 1024) // unsent bytes a replica may fall behind before it is dropped
+
+// Shared-memory slot table
+#define SHARED_SLOTS_NAME "/smart_park_slots_%d" // per lot id
+#define SHARED_SLOTS_MAGIC 0x50415256 // changes with the SharedSlotTable layout
+#define SLOT_STATE_AVAILABLE 0
+#define SLOT_STATE_RESERVED 1
+#define SLOT_STATE_OCCUPIED 2
+#define SLOT_EVENT_RING 1024 // power of two
+
+// Live slot dashboard
+#define DASHBOARD_FRAME_MS 200 // at most five redraws per second
+#define DASHBOARD_COLUMNS 64   // slots per grid row
+
+// Fixed-size record store (users/vehicles/reservations/payments .dat files)
+#define RECORD_SIZE 512 // bytes per row; row 0 is the header, row N holds id N
+
 // Pricing per hour
 #define BIKE_PRICE 10.0
 #define CAR_PRICE 20.0
 #define TRUCK_PRICE 50.0
 
+// Dynamic pricing: base rates scaled by occupancy and time of day
+#define PRICING_FILE "pricing.txt" // optional lot rules, read from the lot's data directory
+#define PRICING_MAX_FACTOR 2.0     // default cap on the occupancy multiplier
+#define TARIFF_MAX_RULES 64
+#define TARIFF_MAX_TIERS 8
+#define TARIFF_MAX_HOLIDAYS 64
+#define DAY_WEEKDAY 0
+#define DAY_WEEKEND 1
+#define DAY_HOLIDAY 2
+#define DAY_KINDS 3
+#define TARGET_UNKNOWN -2 // pricing.txt type or day kind that is not recognised
+
+// Lot geometry: zones, levels and walking distances for nearest-slot assignment
+#define GEOMETRY_FILE "geometry.txt" // optional, read from the lot's data directory
+#define GEOMETRY_MAX_ZONES 32
+#define GEOMETRY_UNLISTED 1000000    // distance of slots no zone line covers
+#define LEVEL_ANY -1000
+#define ASSIGN_RETRIES 8             // slots lost to other kiosks before giving up
+
+// Reservation timer wheel: 4 levels of 64 one-second slots cover about 194 days
+#define WHEEL_LEVELS 4
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define TIMER_OVERSTAY 0 // end of the booked time
+#define TIMER_HOLD 1     // end of an unpaid hold
+#define TIMER_KINDS 2
+#define HOLD_TTL_MINUTES 15 // unpaid reservations are released after this long
+
 // Color codes for Windows
 #define BLACK 0
 #define BLUE 1
@@ -48,8 +227,252 @@
 #define YELLOW 14
 #define WHITE 15
 
+// Frame-Buffered Terminal Renderer
+// Screens are drawn into an in-memory frame. term_flush() compares it with
+// what the terminal already shows and sends only the changed cells, in one
+// write. Input functions flush first. Plain mode (--plain, headless runs,
+// or output that is not a terminal) writes straight through with no escapes.
+typedef struct {
+    char ch;
+    signed char color;
+} TermCell;
+
+static TermCell term_frame[TERM_MAX_ROWS][CONSOLE_WIDTH];
+static TermCell term_shown[TERM_MAX_ROWS][CONSOLE_WIDTH]; // what the terminal displays
+static char term_output[TERM_MAX_ROWS * CONSOLE_WIDTH * 16];
+static int term_rows = TERM_DEFAULT_ROWS;
+static int term_row = 0, term_col = 0;
+static int term_color = TERM_DEFAULT_COLOR;
+static int term_plain = 1;         // until term_init decides otherwise
+static int term_shown_valid = 0;   // 0 = screen contents unknown, clear first
+static int term_echoing = 0;       // text the terminal echoed itself
+static int term_pending_scroll = 0; // lines to scroll the terminal at the next flush
+static int term_quiet = 0;          // status messages off; errors go to stderr
+
+static void term_fill(TermCell rows[][CONSOLE_WIDTH], int color) {
+    for (int r = 0; r < TERM_MAX_ROWS; r++) {
+        for (int c = 0; c < CONSOLE_WIDTH; c++) {
+            rows[r][c].ch = ' ';
+            rows[r][c].color = (signed char)color;
+        }
+    }
+}
+
+static void term_scroll(TermCell rows[][CONSOLE_WIDTH]) {
+    memmove(rows[0], rows[1], sizeof(TermCell) * CONSOLE_WIDTH * (term_rows - 1));
+    for (int c = 0; c < CONSOLE_WIDTH; c++) {
+        rows[term_rows - 1][c].ch = ' ';
+        rows[term_rows - 1][c].color = TERM_DEFAULT_COLOR;
+    }
+}
+
+static void term_newline() {
+    term_col = 0;
+    if (++term_row < term_rows) return;
+    term_row = term_rows - 1;
+    term_scroll(term_frame);
+    // Scroll the terminal the same way instead of repainting every row
+    term_scroll(term_shown);
+    if (!term_echoing && term_pending_scroll < term_rows) term_pending_scroll++;
+}
+
+static void term_put(const char *text, int length) {
+    if (term_quiet) return;
+    if (term_plain) {
+        fwrite(text, 1, length, stdout);
+        return;
+    }
+    for (int i = 0; i < length; i++) {
+        char ch = text[i];
+        if (ch == '\n') {
+            term_newline();
+        } else if (ch == '\r') {
+            term_col = 0;
+        } else if (ch == '\b') {
+            if (term_col > 0) term_col--;
+        } else if (ch == '\t') {
+            do term_put(" ", 1); while (term_col % 8 != 0);
+        } else {
+            if (term_col >= CONSOLE_WIDTH) term_newline();
+            term_frame[term_row][term_col].ch = ch;
+            term_frame[term_row][term_col].color = (signed char)term_color;
+            term_col++;
+        }
+    }
+}
+
+int term_printf(const char *format, ...) {
+    char text[1024];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (len < 0) return len;
+    if (len >= (int)sizeof(text)) len = sizeof(text) - 1;
+    term_put(text, len);
+    return len;
+}
+
+// Windows console colors keep red and blue swapped relative to ANSI
+static int term_append_color(char *out, int color) {
+    if (color == TERM_DEFAULT_COLOR) return sprintf(out, "\033[0m");
+    int ansi = ((color & 4) ? 1 : 0) | (color & 2) | ((color & 1) ? 4 : 0);
+    return sprintf(out, "\033[0;%dm", ((color & 8) ? 90 : 30) + ansi);
+}
+
+void term_flush() {
+    if (term_plain) {
+        fflush(stdout);
+        return;
+    }
+
+    int len = 0;
+    int emitted_color = -2; // unknown
+    if (!term_shown_valid) {
+        len += sprintf(term_output + len, "\033[0m\033[H\033[2J");
+        term_fill(term_shown, TERM_DEFAULT_COLOR);
+        emitted_color = TERM_DEFAULT_COLOR;
+        term_shown_valid = 1;
+    } else if (term_pending_scroll > 0) {
+        len += sprintf(term_output + len, "\033[%d;1H", term_rows);
+        while (term_pending_scroll-- > 0) term_output[len++] = '\n';
+    }
+    term_pending_scroll = 0;
+
+    for (int r = 0; r < term_rows; r++) {
+        int c = 0;
+        while (c < CONSOLE_WIDTH) {
+            if (term_frame[r][c].ch == term_shown[r][c].ch &&
+                term_frame[r][c].color == term_shown[r][c].color) {
+                c++;
+                continue;
+            }
+            // Move once per run of changed cells
+            len += sprintf(term_output + len, "\033[%d;%dH", r + 1, c + 1);
+            while (c < CONSOLE_WIDTH && (term_frame[r][c].ch != term_shown[r][c].ch ||
+                                         term_frame[r][c].color != term_shown[r][c].color)) {
+                if (term_frame[r][c].color != emitted_color) {
+                    emitted_color = term_frame[r][c].color;
+                    len += term_append_color(term_output + len, emitted_color);
+                }
+                term_output[len++] = term_frame[r][c].ch;
+                term_shown[r][c] = term_frame[r][c];
+                c++;
+            }
+        }
+    }
+    len += sprintf(term_output + len, "\033[%d;%dH", term_row + 1,
+                   (term_col < CONSOLE_WIDTH ? term_col : CONSOLE_WIDTH - 1) + 1);
+    if (term_color != emitted_color) len += term_append_color(term_output + len, term_color);
+
+    fflush(stdout);
+    if (write(fileno(stdout), term_output, len) != len) {
+        term_shown_valid = 0; // partial write: repaint everything next time
+    }
+}
+
+// Place the cursor anywhere in the frame, for screens that update in place
+void term_move(int row, int col) {
+    if (term_plain) return;
+    term_row = row < 0 ? 0 : row >= term_rows ? term_rows - 1 : row;
+    term_col = col < 0 ? 0 : col >= CONSOLE_WIDTH ? CONSOLE_WIDTH - 1 : col;
+}
+
+int term_height() {
+    return term_rows;
+}
+
+int term_is_plain() {
+    return term_plain;
+}
+
+void term_clear() {
+    if (term_plain) return;
+    term_fill(term_frame, TERM_DEFAULT_COLOR);
+    term_row = term_col = 0;
+}
+
+// The terminal echoes typed lines itself; mirror them so the diff stays exact
+static void term_echo(const char *line) {
+    if (term_plain) return;
+    int start_row = term_row;
+    term_echoing = 1;
+    term_put(line, (int)strlen(line));
+    if (line[0] == '\0' || line[strlen(line) - 1] != '\n') term_newline();
+    term_echoing = 0;
+    if (start_row > term_row) start_row = term_row; // scrolled
+    for (int r = start_row; r <= term_row && r < term_rows; r++) {
+        memcpy(term_shown[r], term_frame[r], sizeof(TermCell) * CONSOLE_WIDTH);
+    }
+}
+
+// Line-based scanf: one prompt, one line, blank lines are skipped like scanf does
+int term_scanf(const char *format, ...) {
+    char line[256];
+    int result;
+
+    do {
+        term_flush();
+        if (fgets(line, sizeof(line), stdin) == NULL) return EOF;
+        term_echo(line);
+        va_list args;
+        va_start(args, format);
+        result = vsscanf(line, format, args);
+        va_end(args);
+    } while (result == EOF);
+    return result;
+}
+
+int term_getch() {
+    term_flush();
+    return getch();
+}
+
+void term_set_quiet(int quiet) {
+    term_quiet = quiet;
+}
+
+static void term_shutdown() {
+    if (term_plain) return;
+    term_flush();
+    printf("\033[0m\n");
+    fflush(stdout);
+}
+
+void term_init(int plain) {
+#ifdef _WIN32
+    HANDLE console = GetStdHandle(STD_OUTPUT_HANDLE);
+    DWORD mode = 0;
+    CONSOLE_SCREEN_BUFFER_INFO info;
+    if (!plain && (!GetConsoleMode(console, &mode) ||
+                   !SetConsoleMode(console, mode | 0x0004))) { // ENABLE_VIRTUAL_TERMINAL_PROCESSING
+        plain = 1;
+    }
+    if (!plain && GetConsoleScreenBufferInfo(console, &info)) {
+        term_rows = info.srWindow.Bottom - info.srWindow.Top + 1;
+    }
+#else
+    struct winsize size;
+    if (!isatty(STDOUT_FILENO)) plain = 1;
+    if (!plain && ioctl(STDOUT_FILENO, TIOCGWINSZ, &size) == 0 && size.ws_row > 0) {
+        term_rows = size.ws_row;
+    }
+#endif
+    if (term_rows > TERM_MAX_ROWS) term_rows = TERM_MAX_ROWS;
+    if (term_rows < 2) term_rows = TERM_DEFAULT_ROWS;
+    term_plain = plain;
+    if (!term_plain) {
+        term_clear();
+        atexit(term_shutdown);
+    }
+}
+
 // Color functions
 void setColor(int color) {
+    if (!term_plain) {
+        term_color = color;
+        return;
+    }
 #ifdef _WIN32
     HANDLE hConsole = GetStdHandle(STD_OUTPUT_HANDLE);
     SetConsoleTextAttribute(hConsole, color);
@@ -57,6 +480,10 @@ void setColor(int color) {
 }
 
 void resetColor() {
+    if (!term_plain) {
+        term_color = TERM_DEFAULT_COLOR;
+        return;
+    }
 #ifdef _WIN32
     setColor(WHITE);
 #endif
@@ -64,29 +491,33 @@ void resetColor() {
 
 // Center alignment function
 void printCentered(const char* text, int color) {
+    if (term_quiet) {
+        if (color == LIGHTRED) fprintf(stderr, "%s\n", text);
+        return;
+    }
     int len = strlen(text);
     int padding = (CONSOLE_WIDTH - len) / 2;
     setColor(color);
     for (int i = 0; i < padding; i++) {
-        printf(" ");
+        term_printf(" ");
     }
-    printf("%s\n", text);
+    term_printf("%s\n", text);
     resetColor();
 }
 
 void printCenteredLine(char ch, int color) {
     setColor(color);
     for (int i = 0; i < CONSOLE_WIDTH; i++) {
-        printf("%c", ch);
+        term_printf("%c", ch);
     }
-    printf("\n");
+    term_printf("\n");
     resetColor();
 }
 
 // ASCII Header Function
 void print_ascii_header() {
     setColor(LIGHTCYAN);
-    printf("\n");
+    term_printf("\n");
     printCentered("  _____  __  __      ___      _____  _______     _____    ___      _____   _  __", LIGHTCYAN);
     printCentered(" / ____||  \\/  |    /   \\    |  __ \\|__   __|   |  __ \\  /   \\    |  __ \\ | |/ /", LIGHTCYAN);
     printCentered("| (___  | \\  / |   /  ^  \\   | |__) |  | |      | |__) |/  ^  \\   | |__) || ' / ", LIGHTCYAN);
@@ -94,7 +525,7 @@ void print_ascii_header() {
     printCentered(" ____) || |  | | /  _____  \\ | | \\ \\   | |      | |   /  _____  \\ | | \\ \\ | . \\ ", LIGHTCYAN);
     printCentered("|_____/ |_|  |_|/__/     \\__\\|_|  \\_\\  |_|      |_|  /__/     \\__\\|_|  \\_\\|_|\\_\\", LIGHTCYAN);
     printCentered("                |__|     |__|                        |__|     |__|              ", LIGHTCYAN);
-    printf("\n");
+    term_printf("\n");
     resetColor();
 }
 
@@ -111,7 +542,7 @@ typedef struct {
     char phone[20];
     char email[MAX_STRING];
     char password[MAX_STRING];
-    char reg_date[20];
+    long long reg_date; // epoch seconds, like every timestamp below; 0 = none
     int is_active;
 } User;
 
@@ -121,7 +552,7 @@ typedef struct {
     char type[20]; // bike, car, truck
     char license_plate[20];
     char color[20];
-    char reg_date[20];
+    long long reg_date;
 } Vehicle;
 
 typedef struct {
@@ -129,7 +560,7 @@ typedef struct {
     char type[20]; // bike, car, truck
     char status[20]; // available, occupied, reserved
     int vehicle_id;
-    char reserved_time[20];
+    long long reserved_time;
     int user_id;
 } Slot;
 
@@ -138,9 +569,9 @@ typedef struct {
     int user_id;
     int slot_id;
     int vehicle_id;
-    char start_time[20];
-    char end_time[20];
-    char status[20]; // active, completed, cancelled
+    long long start_time;
+    long long end_time; // 0 while the reservation is open
+    char status[20]; // active, completed, cancelled, expired
     double duration_hours;
     double total_amount;
 } Reservation;
@@ -151,14 +582,412 @@ typedef struct {
     int reservation_id;
     double amount;
     char method[20]; // cash, card, bkash, nagad
-    char payment_date[20];
+    long long payment_date;
     char status[20]; // completed, pending, failed
 } Payment;
 
+// Threading primitives (Windows threads or pthreads)
+#ifdef _WIN32
+    typedef CRITICAL_SECTION pool_mutex_t;
+    typedef CONDITION_VARIABLE pool_cond_t;
+    typedef HANDLE pool_thread_t;
+    #define POOL_TLS __declspec(thread)
+    #define pool_mutex_init(m) InitializeCriticalSection(m)
+    #define pool_mutex_lock(m) EnterCriticalSection(m)
+    #define pool_mutex_unlock(m) LeaveCriticalSection(m)
+    #define pool_cond_init(c) InitializeConditionVariable(c)
+    #define pool_cond_wait(c, m) SleepConditionVariableCS(c, m, INFINITE)
+    #define pool_cond_broadcast(c) WakeAllConditionVariable(c)
+#else
+    typedef pthread_mutex_t pool_mutex_t;
+    typedef pthread_cond_t pool_cond_t;
+    typedef pthread_t pool_thread_t;
+    #define POOL_TLS __thread
+    #define pool_mutex_init(m) pthread_mutex_init(m, NULL)
+    #define pool_mutex_lock(m) pthread_mutex_lock(m)
+    #define pool_mutex_unlock(m) pthread_mutex_unlock(m)
+    #define pool_cond_init(c) pthread_cond_init(c, NULL)
+    #define pool_cond_wait(c, m) pthread_cond_wait(c, m)
+    #define pool_cond_broadcast(c) pthread_cond_broadcast(c)
+#endif
+
+// ANPR camera read: a plate seen entering or leaving the lot
+typedef struct {
+    char plate[20];
+    int is_exit;
+    long long event_time;
+} PlateEvent;
+
+typedef struct {
+    int applied;
+    int unknown_plate;
+    int no_reservation;
+    int ignored; // reads that do not fit the slot's state, such as EXIT of a free slot
+} IngestStats;
+
+// Each screen of a session is a state; input lines move it to the next one
+typedef enum {
+    SESSION_MAIN_MENU,
+    SESSION_REGISTER_NAME,
+    SESSION_REGISTER_PHONE,
+    SESSION_REGISTER_EMAIL,
+    SESSION_REGISTER_PASSWORD,
+    SESSION_LOGIN_PHONE,
+    SESSION_LOGIN_PASSWORD,
+    SESSION_USER_MENU,
+    SESSION_VEHICLE_TYPE,
+    SESSION_VEHICLE_PLATE,
+    SESSION_VEHICLE_COLOR,
+    SESSION_RESERVE_VEHICLE,
+    SESSION_RESERVE_SLOT,
+    SESSION_RESERVE_HOURS,
+    SESSION_CANCEL_SELECT,
+    SESSION_PAY_SELECT,
+    SESSION_PAY_METHOD,
+    SESSION_CLOSED
+} SessionState;
+
+// A suspended session is just this struct: no thread, no stack
+typedef struct {
+    int in_fd;
+    int out_fd;
+    unsigned char state;
+    unsigned char is_socket;
+    unsigned char is_console;
+    unsigned char is_loopback; // the peer connected from 127.0.0.0/8
+    int user_id;
+    union {
+        struct { char name[40]; char phone[12]; char email[64]; } reg;
+        struct { char type[8]; char plate[20]; } vehicle;
+        struct { int vehicle_id; int slot_id; } reserve;
+        int reservation_id;
+    } step;
+    int input_length;
+    char input[SESSION_INPUT_MAX];
+    int output_length; // socket replies not yet taken by the kernel
+    char output[SESSION_OUTPUT_MAX];
+} Session;
+
+// Router table entry: lot shard id -> local port of its engine process
+typedef struct {
+    int lot_id;
+    int port;
+} LotRoute;
+
+// One cross-lot query in flight for a router client
+typedef struct {
+    int is_avail;          // !AVAIL, otherwise !REVENUE
+    long long deadline_ms; // monotonic_ms() after which silent lots count as unreachable
+    int waiting;
+    int fds[ROUTER_MAX_LOTS];
+    int lengths[ROUTER_MAX_LOTS];
+    char replies[ROUTER_MAX_LOTS][1024];
+} RouterQuery;
+
+// A router client; once bound to a lot, bytes are relayed to lot_fd.
+// Both directions are queued for non-blocking sockets.
+typedef struct {
+    int client_fd;
+    int lot_fd; // -1 until LOT <id> is chosen
+    unsigned char closed;
+    RouterQuery *query; // fan-out in progress, NULL otherwise
+    int input_length;   // typed lines not yet handled
+    char input[SESSION_INPUT_MAX];
+    int to_client_length;
+    char to_client[SESSION_OUTPUT_MAX];
+    int to_lot_length;
+    char to_lot[SESSION_OUTPUT_MAX];
+} RouterLink;
+
+// A connected replica and the batches its socket has not taken yet
+typedef struct {
+    int fd; // -1 once dropped
+    char *queue;
+    int queued;
+    int capacity;
+} ReplicaLink;
+
+typedef void (*TaskFunc)(void *arg);
+
+typedef struct TaskGroup {
+    int pending; // tasks submitted but not finished
+} TaskGroup;
+
+typedef struct {
+    TaskFunc fn;
+    void *arg;
+    TaskGroup *group;
+} Task;
+
+// Each worker owns a deque: it pushes/pops at the tail, thieves take from the head
+typedef struct {
+    Task tasks[POOL_DEQUE_SIZE];
+    int head;
+    int tail;
+    pool_mutex_t lock;
+} TaskDeque;
+
+typedef struct {
+    int worker_count;
+    pool_thread_t threads[POOL_MAX_WORKERS];
+    TaskDeque deques[POOL_MAX_WORKERS];
+    int queued;      // tasks sitting in any deque
+    int next_deque;  // round-robin target for external submissions
+    int shutdown;
+    pool_mutex_t lock;
+    pool_cond_t work_cond;
+    pool_cond_t done_cond;
+} TaskPool;
+
+// Range callback used by parallel_for: process rows [begin, end)
+typedef void (*RangeFunc)(void *ctx, int begin, int end, int chunk_index);
+
+typedef struct {
+    RangeFunc fn;
+    void *ctx;
+    int begin;
+    int end;
+    int chunk_index;
+} RangeTask;
+
+// Partial aggregate for report scans, merged chunk by chunk
+typedef struct {
+    int total_users, active_users;
+    int total_vehicles, bikes, cars, trucks;
+    int total_reservations, active_reservations, completed_reservations, cancelled_reservations;
+    int total_payments, completed_payments;
+    double total_revenue;
+    int cash_payments, card_payments, mobile_payments;
+    double cash_amount, card_amount, mobile_amount;
+    int total_occupied, total_reserved;
+} ReportTotals;
+
+// Slot change events: head counts every change ever made, and
+// slots[n % SLOT_EVENT_RING] is the slot index of change n
+typedef struct {
+    unsigned int head;
+    int slots[SLOT_EVENT_RING];
+} SlotEventRing;
+
+// Slot table shared by every kiosk process of a lot. The futex word guards
+// the slot records; state[] lets a reservation claim a slot with one CAS.
+typedef struct {
+    int magic;            // SHARED_SLOTS_MAGIC once the creator has loaded it
+    int lock;             // futex: 0 free, 1 locked, 2 locked with waiters
+    unsigned int version; // bumped on every slot change
+    int watchers;         // dashboards sleeping on events.head
+    int slot_count;
+    int state[MAX_SLOTS];
+    int type_counts[3][3]; // slots per type and SLOT_STATE_*, kept under the lock
+    Slot slots[MAX_SLOTS];
+    SlotEventRing events;
+} SharedSlotTable;
+
+// One .dat file of the record store. Rows are journal-format text lines
+// padded to RECORD_SIZE, so the row for an id is at id * RECORD_SIZE.
+typedef struct {
+    int fd;
+    char kind;       // journal record letter: U, V, N or P
+    int header_held; // header write lock taken by record_store_begin_append
+    int held_row;    // row write lock taken by record_store_lock_row, 0 if none
+} RecordFile;
+
+// Latency samples of one benchmarked operation
+typedef struct {
+    const char *name;
+    double *samples_us;
+    int count;
+    int capacity;
+    double total_us;
+} BenchSeries;
+
+// One timed step of startup: a table file, the journal replay, an index build
+typedef struct {
+    const char *name;
+    long bytes;  // bytes read, 0 when the step reads no file
+    int rows;    // rows parsed or entries indexed (journal: batches)
+    double us;
+} StartupPhase;
+
+// One timer in the reservation wheel; timer id = reservation index * TIMER_KINDS + kind
+typedef struct {
+    int next, prev;     // -1 ends the list
+    int level, slot;    // level -1 when not scheduled
+    long long expires;  // epoch seconds
+} TimerNode;
+
+// Hourly rate rules compiled into lookup tables so a quote is a few reads
+typedef struct {
+    double base[3];                              // bike, car, truck
+    double occupancy[3][101];                    // multiplier by percent of the type's slots in use
+    double max_factor;                           // cap on the occupancy multiplier
+    double rate[3][DAY_KINDS][24];               // tariff per hour by type, day kind and local hour
+    double day_prefix[3][DAY_KINDS][25];         // day_prefix[..][h]: cost of hours 0 to h-1
+    int tier_count[3];
+    double tier_from[3][TARIFF_MAX_TIERS];       // hour of the stay each tier starts at
+    double tier_factor[3][TARIFF_MAX_TIERS];
+    int holidays[TARIFF_MAX_HOLIDAYS];           // YYYYMMDD, sorted
+    int holiday_count;
+} PricingTable;
+
+// One zone of the lot. zone_heaps[heap_start[t]...] holds its free slots of
+// vehicle type t as a min-heap on distance.
+typedef struct {
+    char name[16];
+    int level;
+    int heap_start[3];
+    int heap_count[3];
+} LotZone;
+
+// Memory held by one table, index or buffer
+typedef struct {
+    const char *name;
+    size_t allocated;  // reserved for it, whether used or not
+    size_t used;       // held by live rows or entries
+    size_t row_bytes;  // size of one row or entry, 0 for byte buffers
+    long rows;
+} MemoryArea;
+
+// Operations in a workload trace; TRACE_END carries the final state digest
+typedef enum {
+    TRACE_REGISTER = 1,
+    TRACE_LOGIN,
+    TRACE_ADD_VEHICLE,
+    TRACE_RESERVE,
+    TRACE_CANCEL,
+    TRACE_PAY,
+    TRACE_PLATES,
+    TRACE_END,
+    TRACE_EXPIRE, // after TRACE_END so older traces keep their codes
+    TRACE_OP_COUNT
+} TraceOp;
+
+// One decoded trace record
+typedef struct {
+    int op;
+    double offset_us;  // start time relative to the start of the capture
+    double latency_us;
+    int result;
+    int ints[4];
+    double number;
+    char text[4][MAX_STRING];
+    int event_count;
+    PlateEvent events[ANPR_BATCH_MAX];
+    unsigned long long digest;
+} TraceRecord;
+
+// Instrumented engine operations and persistence phases
+typedef enum {
+    METRIC_REGISTER,
+    METRIC_LOGIN,
+    METRIC_ADD_VEHICLE,
+    METRIC_RESERVE,
+    METRIC_CANCEL,
+    METRIC_PAY,
+    METRIC_ANPR_BATCH,
+    METRIC_REPORT,
+    METRIC_LOAD_DATA,
+    METRIC_SAVE_DATA,
+    METRIC_JOURNAL_REPLAY,
+    METRIC_JOURNAL_WRITE,
+    METRIC_JOURNAL_FSYNC,
+    METRIC_REPLICATION_SHIP,
+    METRIC_RECORD_STORE_PUT,
+    METRIC_COUNT
+} MetricId;
+
+// Log-linear latency histogram: values below LATENCY_SUB_BUCKETS * 2 us get
+// their own bucket, above that each power of two is split into
+// LATENCY_SUB_BUCKETS equal parts (the HdrHistogram layout)
+typedef struct {
+    unsigned long long count;
+    unsigned long long errors;
+    double total_us;
+    double max_us;
+    unsigned int buckets[LATENCY_BUCKETS];
+} LatencyHistogram;
+
+// Load generator: what a simulated kiosk does next
+typedef enum {
+    LOAD_LIST_FREE,
+    LOAD_RESERVE,
+    LOAD_PAY,
+    LOAD_CANCEL,
+    LOAD_EXIT,
+    LOAD_OP_COUNT
+} LoadOp;
+
+typedef struct {
+    int count;
+    int errors;
+    double total_us;
+    double max_us;
+    unsigned int buckets[LOADGEN_BUCKETS];
+} LoadOpStats;
+
+// One arrival or departure in the simulator's event queue
+typedef struct {
+    long long at;
+    int kind;    // SIM_ARRIVE or SIM_DEPART
+    int type;    // 0 bike, 1 car, 2 truck
+    int vehicle; // departing vehicle's index
+    double hours; // stay of a trace arrival, 0 to draw one
+} SimEvent;
+
+// Simulator settings shared by every run
+typedef struct {
+    int layouts[SIM_MAX_LAYOUTS][3]; // bike, car and truck slots
+    int layout_count;
+    int runs;          // runs per layout; run r uses the same random stream for every layout
+    int days;
+    long long start;
+    double arrivals_per_hour[3];
+    double mean_stay_hours;
+    SimEvent *trace;   // recorded arrivals, NULL for Poisson arrivals
+    int trace_count;
+} SimConfig;
+
+// Totals of one run of one layout
+typedef struct {
+    int done;          // set by the worker when the run finished
+    long long events;
+    double wall_us;
+    long arrivals[3];
+    long rejected[3];
+    double occupied_seconds[3];
+    double revenue[3];
+} SimResult;
+
+// One simulated kiosk: a customer with a bike, a car and a truck
+typedef struct {
+    int index;
+    int fd;                   // daemon connection, -1 for the in-process engine
+    char input[SESSION_REPLY_MAX];
+    int input_length;
+    unsigned long long rng;
+    int ready;                // registration and vehicles succeeded
+    int user_id;
+    int vehicle_id[3];
+    char plate[3][20];
+    int reservation_id[3];
+    int vehicle_state[3];     // 0 parked elsewhere, 1 reserved, 2 paid
+    LoadOpStats ops[LOAD_OP_COUNT];
+    int conflicts;
+    int retries;
+    int lot_full;
+    int table_full;           // the engine ran out of rows; the client stops
+    int per_second[LOADGEN_MAX_SECONDS];
+} LoadClient;
+
+// Fails to compile when the plate index is too small for the vehicle table
+typedef char plate_index_size_check[(PLATE_INDEX_SIZE >= 2 * MAX_VEHICLES &&
+                                     (PLATE_INDEX_SIZE & (PLATE_INDEX_SIZE - 1)) == 0) ? 1 : -1];
+
 // Global Variables
 User users[MAX_USERS];
 Vehicle vehicles[MAX_VEHICLES];
-Slot slots[MAX_SLOTS];
+Slot local_slots[MAX_SLOTS];
+Slot *slots = local_slots; // points into shared memory with --shared-slots
 Reservation reservations[MAX_RESERVATIONS];
 Payment payments[MAX_PAYMENTS];
 
@@ -166,12 +995,121 @@ int user_count = 0, vehicle_count = 0, slot_count = 0;
 int reservation_count = 0, payment_count = 0;
 int current_user_id = -1;
 int is_admin = 0;
+TaskPool *task_pool = NULL;
+int headless_mode = 0; // no keypress waits (camera ingestion etc.)
+int lot_id = 0;        // shard id when running as one lot of a federation
+int script_queries_enabled = 0; // --allow-do: answer "!DO" from loopback test clients
+const char *listen_address = "127.0.0.1"; // --listen: where --serve and --router accept clients
+
+// Replication: the primary ships each committed journal batch to its replicas
+int replica_mode = 0; // read-only copy fed by a primary
+int replication_listener = -1;
+ReplicaLink replica_links[REPLICA_MAX];
+int replica_link_count = 0;
+int upstream_fd = -1, upstream_port = 0;
+int upstream_seq = 0;
+long long upstream_heard_ms = 0;
+long long replication_last_ms = 0; // last heartbeat sent / reconnect tried
+char *upstream_batch = NULL;       // records received but not yet committed
+int upstream_batch_length = 0, upstream_batch_capacity = 0;
+char upstream_line[RECORD_SIZE];
+int upstream_line_length = 0;
+
+SharedSlotTable *shared_slots = NULL;
+SlotEventRing local_slot_events;
+SlotEventRing *slot_events = &local_slot_events; // the shared ring with --shared-slots
+int shared_slots_live = 0; // attached to a table another process already loaded
+
+// Slots per type (bike, car, truck) and SLOT_STATE_*, kept up to date by every
+// slot change so metrics never rescan the table; shared with --shared-slots
+int local_slot_type_counts[3][3];
+int (*slot_type_counts)[3] = local_slot_type_counts;
+
+int record_store_mode = 0; // tables live in fixed-size .dat files shared by processes
+RecordFile record_files[4];
+
+// Latency statistics since start, dumped every latency_dump_seconds when set
+LatencyHistogram latency_stats[METRIC_COUNT];
+int latency_dump_seconds = 0;
+
+// Startup phases in the order they ran
+StartupPhase startup_phases[STARTUP_MAX_PHASES];
+int startup_phase_count = 0;
+
+// Metrics export
+int metrics_every_seconds = 0;
+double payment_amount_total = 0;
+long long journal_commit_ms = 0;   // last journal commit
+long long snapshot_saved_ms = 0;   // last load or save of the snapshot files
+
+PricingTable pricing;
+
+// Lot geometry (geometry.txt) and the free slots of each zone, nearest first
+LotZone lot_zones[GEOMETRY_MAX_ZONES];
+int lot_zone_count = 0;
+int slot_zone[MAX_SLOTS];             // zone of each slot index
+int slot_distance[MAX_SLOTS];         // metres from its level's entrance or lift
+unsigned char slot_queued[MAX_SLOTS]; // 1 while the slot is in its zone's heap
+int zone_heaps[MAX_SLOTS];            // slot indexes, one range per zone and type
+unsigned int geometry_seen_events = 0; // slot_events->head already applied
+int geometry_ready = 0;               // built on the first pick after the slots were loaded
+
+// Reservation timers: overstays and unpaid holds
+TimerNode timer_nodes[MAX_RESERVATIONS * TIMER_KINDS];
+int wheel_heads[WHEEL_LEVELS][WHEEL_SLOTS];
+long long wheel_now = 0;
+int timers_ready = 0;
+int hold_ttl_seconds = HOLD_TTL_MINUTES * 60; // 0 keeps unpaid holds until cancelled
+
+// Engine clock (--clock)
+int clock_mode = CLOCK_REAL;
+long long clock_origin = 0;   // engine time at clock_origin_us
+double clock_origin_us = 0;   // monotonic_us() when the simulated clock started
+double clock_rate = 1;
+unsigned char reservation_paid[MAX_RESERVATIONS];
+int hold_expired[MAX_RESERVATIONS];          // holds due, released after the wheel walk
+int hold_expired_count = 0;
+long hold_expiries_total = 0;
+int overstay_list[MAX_RESERVATIONS];
+int overstay_position[MAX_RESERVATIONS]; // index in overstay_list, -1 when not overstayed
+int overstay_count = 0;
+long overstay_alerts_total = 0;
+
+// Workload capture: every engine call is appended to the trace when open
+FILE *capture_file = NULL;
+double capture_started_us = 0;
+long capture_records = 0;
+
+// Journal state: records buffered until journal_commit()
+char *journal_buffer = NULL;
+int journal_length = 0, journal_capacity = 0;
+int journal_pending_records = 0;
+int journal_records_since_checkpoint = 0;
+int journal_seq = 0;
+FILE *journal_file = NULL;
+long journal_replay_bytes = 0;
+int journal_sync = 1; // 0 for the simulator's scratch journals: written, not fsynced
+
+// License plate -> vehicle index (stores index + 1, 0 = empty)
+int plate_index[PLATE_INDEX_SIZE];
+int plate_index_count = 0;
+static POOL_TLS int pool_worker_index = -1; // -1 on non-worker threads
 
 // Function Prototypes
 void initialize_system();
 void load_data();
 void save_data();
 void clear_screen();
+int term_printf(const char *format, ...);
+int term_scanf(const char *format, ...);
+int term_getch();
+void term_flush();
+void term_clear();
+void term_move(int row, int col);
+int term_height();
+int term_is_plain();
+void term_set_quiet(int quiet);
+void term_init(int plain);
 void main_menu();
 void user_menu();
 void admin_menu();
@@ -197,10 +1135,16 @@ void admin_view_all_vehicles();
 void admin_slot_usage_report();
 void admin_generate_daily_report();
 void initialize_slots();
+const char *phone_problem(const char *phone);
+const char *email_problem(const char *email);
 int validate_phone(char *phone);
 int validate_email(char *email);
 void get_current_time(char *time_str);
-double calculate_duration(char *start_time, char *end_time);
+double calculate_duration(long long start_time, long long end_time);
+long long now_epoch();
+int clock_configure(const char *spec);
+int clock_advance(long long seconds);
+char *format_time(long long when, char *out);
 void mask_password(char *password);
 int get_next_user_id();
 int get_next_vehicle_id();
@@ -209,19 +1153,446 @@ int get_next_payment_id();
 void pause_screen();
 void print_header();
 void print_colored_slots();
+int pool_cpu_count();
+TaskPool *pool_get();
+void pool_submit(TaskPool *pool, TaskGroup *group, TaskFunc fn, void *arg);
+void pool_wait(TaskPool *pool, TaskGroup *group);
+void pool_shutdown();
+void parallel_for(int total, int chunk_rows, RangeFunc fn, void *ctx);
+void compute_report_totals(int filter_user_id, ReportTotals *totals);
+void sleep_ms(int ms);
+int find_slot_index(int slot_id);
+int find_reservation_index(int reservation_id);
+void set_slot_state(int slot_index, const char *status, int vehicle_id, int user_id, long long reserved_time);
+void set_reservation_status(int reservation_index, const char *status, long long end_time);
+void journal_append(const char *format, ...);
+int journal_commit();
+void journal_checkpoint();
+int journal_replay();
+int find_vehicle_by_plate(const char *plate);
+int ingest_plate_events(const PlateEvent *events, int count, IngestStats *stats);
+void anpr_tail_mode(const char *path);
+const char *engine_error_text(int code);
+int find_user_index(int user_id);
+int find_vehicle_index(int vehicle_id);
+double slot_hourly_rate(const char *type);
+int reservation_is_paid(int reservation_id);
+int engine_register_user(const char *name, const char *phone, const char *email, const char *password);
+int engine_login(const char *phone, const char *password);
+int engine_add_vehicle(int user_id, const char *type, const char *plate, const char *color);
+int engine_reserve(int user_id, int vehicle_id, int slot_id, double duration);
+int engine_reserve_nearest(int user_id, int vehicle_id, int level, double duration);
+int engine_cancel(int user_id, int reservation_id);
+int engine_pay(int user_id, int reservation_id, const char *method);
+Session *session_open(int in_fd, int out_fd, int is_socket);
+void session_flush(Session *session);
+void session_feed(Session *session, const char *data, int length);
+void session_step(Session *session, const char *line);
+void session_server(int port);
+void session_query(Session *session, const char *line);
+int enter_lot_directory(int id);
+int parse_lot_routes(const char *spec, LotRoute *routes);
+void router_server(int port, LotRoute *routes, int route_count);
+long long monotonic_ms();
+double monotonic_us();
+void latency_record(MetricId metric, double started_us, int failed);
+double latency_percentile(const LatencyHistogram *histogram, double p);
+int latency_dump(const char *path);
+void latency_tick();
+void latency_dump_at_exit();
+void admin_latency_report();
+int replication_listen(int port);
+void replication_ship(const char *data, int length);
+int replication_poll_fd();
+#ifndef _WIN32
+int replication_poll_out(struct pollfd *fds);
+#endif
+void replication_flush();
+void replication_service();
+void replication_tick();
+int replica_is_stale();
+int shared_slots_attach();
+void shared_slots_publish();
+void shared_slots_detach();
+void slot_table_lock();
+void slot_table_unlock();
+int slot_state_code(const char *status);
+int slot_type_code(const char *type);
+void slot_counts_rebuild();
+void slot_counts_move(const Slot *slot, const char *new_status);
+int metrics_write(const char *path);
+void metrics_tick();
+void metrics_write_at_exit();
+void startup_phase_record(const char *name, long bytes, int rows, double started_us);
+void startup_report(FILE *out, double total_us);
+int memory_collect(MemoryArea *areas);
+long memory_resident_kb();
+void admin_memory_report();
+unsigned long long state_digest();
+void pricing_load();
+double pricing_quote(int type);
+double pricing_base_rate(const char *type);
+double pricing_stay_cost(int type, long long start, double hours);
+double pricing_booking_amount(int type, double hours);
+void geometry_load();
+int slot_pick_nearest(int type, int level);
+char *slot_location(int slot_index, char *out);
+long long parse_time(const char *time_str);
+void timers_rebuild();
+void reservation_timers_track(int reservation_index);
+void reservation_timers_paid(int reservation_id);
+void timers_advance(long long now);
+int engine_expire_hold(int reservation_id);
+int slot_type_occupancy(int type);
+int capture_open(const char *path);
+void capture_call(TraceOp op, double started_us, int result, const char *signature, ...);
+void capture_plates(const PlateEvent *events, int count, double started_us, int applied);
+void capture_close();
+int run_replay(const char *path, int paced, FILE *out);
+int slot_claim(int slot_index);
+void slot_events_wait(unsigned int seen, int ms);
+void slot_dashboard();
+int run_script(FILE *input);
+int script_command(const char *line, char *result);
+int format_free_slots(const char *type, char *reply, int size);
+int run_benchmark(int user_target, int op_target, FILE *out);
+int run_simulation(const char *layouts, const char *arrivals, double mean_stay_hours, int days, int runs,
+                   const char *trace_path, FILE *out);
+int run_load_generator(int port, int clients, int seconds, int think_ms, const char *mix);
+int format_table_record(char kind, int index, char *line);
+int record_store_open();
+void record_store_close();
+void record_store_pull(char kind);
+void record_store_refresh();
+void record_store_put(char kind, int index);
+void record_store_begin_append(char kind);
+void record_store_end_append(char kind);
+void record_store_lock_row(char kind, int id);
+void record_store_unlock_row(char kind);
 
 // Main Function
-int main() {
+int main(int argc, char *argv[]) {
+    const char *anpr_path = NULL;
+    int serve_port = 0;
+    int router_port = 0;
+    int replicate_port = 0;
+    int use_shared_slots = 0;
+    int use_record_store = 0;
+    int plain_output = 0;
+    int dashboard_only = 0;
+    const char *script_path = NULL;
+    int bench_users = 0;
+    int bench_ops = BENCH_DEFAULT_OPS;
+    const char *bench_out = NULL;
+    int loadgen_port = -1;
+    int loadgen_clients = 8;
+    int loadgen_seconds = 10;
+    int loadgen_think_ms = 100;
+    const char *loadgen_mix = "40,25,15,20";
+    int profile_startup = 0;
+    const char *capture_path = NULL;
+    const char *replay_path = NULL;
+    const char *replay_out = NULL;
+    int replay_paced = 0;
+    const char *sim_layouts = NULL;
+    const char *sim_arrivals = SIM_DEFAULT_ARRIVALS;
+    const char *sim_trace = NULL;
+    const char *sim_out = NULL;
+    double sim_stay_hours = SIM_DEFAULT_STAY_HOURS;
+    int sim_days = 0;
+    int sim_runs = SIM_DEFAULT_RUNS;
+    LotRoute routes[ROUTER_MAX_LOTS];
+    int route_count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--anpr") == 0 && i + 1 < argc) {
+            anpr_path = argv[++i];
+            headless_mode = 1;
+        } else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc) {
+            serve_port = atoi(argv[++i]);
+            headless_mode = 1;
+        } else if (strcmp(argv[i], "--listen") == 0 && i + 1 < argc) {
+            listen_address = argv[++i];
+        } else if (strcmp(argv[i], "--allow-do") == 0) {
+            script_queries_enabled = 1;
+        } else if (strcmp(argv[i], "--lot") == 0 && i + 1 < argc) {
+            lot_id = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--router") == 0 && i + 2 < argc) {
+            router_port = atoi(argv[++i]);
+            route_count = parse_lot_routes(argv[++i], routes);
+        } else if (strcmp(argv[i], "--shared-slots") == 0) {
+            use_shared_slots = 1;
+        } else if (strcmp(argv[i], "--record-store") == 0) {
+            use_record_store = 1;
+        } else if (strcmp(argv[i], "--plain") == 0) {
+            plain_output = 1;
+        } else if (strcmp(argv[i], "--script") == 0 && i + 1 < argc) {
+            script_path = argv[++i];
+            headless_mode = 1;
+        } else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+            bench_users = atoi(argv[++i]);
+            headless_mode = 1;
+        } else if (strcmp(argv[i], "--bench-ops") == 0 && i + 1 < argc) {
+            bench_ops = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--bench-out") == 0 && i + 1 < argc) {
+            bench_out = argv[++i];
+        } else if (strcmp(argv[i], "--loadgen") == 0 && i + 1 < argc) {
+            loadgen_port = atoi(argv[++i]);
+            headless_mode = 1;
+        } else if (strcmp(argv[i], "--clients") == 0 && i + 1 < argc) {
+            loadgen_clients = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc) {
+            loadgen_seconds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--think-ms") == 0 && i + 1 < argc) {
+            loadgen_think_ms = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--mix") == 0 && i + 1 < argc) {
+            loadgen_mix = argv[++i];
+        } else if (strcmp(argv[i], "--profile-startup") == 0) {
+            profile_startup = 1;
+            headless_mode = 1;
+        } else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            capture_path = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay_path = argv[++i];
+            headless_mode = 1;
+        } else if (strcmp(argv[i], "--replay-out") == 0 && i + 1 < argc) {
+            replay_out = argv[++i];
+        } else if (strcmp(argv[i], "--hold-ttl") == 0 && i + 1 < argc) {
+            hold_ttl_seconds = atoi(argv[++i]) * 60;
+        } else if (strcmp(argv[i], "--clock") == 0 && i + 1 < argc) {
+            if (clock_configure(argv[++i]) != 0) {
+                fprintf(stderr, "Unknown clock %s (real, fixed[@time] or <rate>x[@time])\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--simulate") == 0 && i + 1 < argc) {
+            sim_layouts = argv[++i];
+            headless_mode = 1;
+        } else if (strcmp(argv[i], "--sim-days") == 0 && i + 1 < argc) {
+            sim_days = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--sim-runs") == 0 && i + 1 < argc) {
+            sim_runs = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--sim-arrivals") == 0 && i + 1 < argc) {
+            sim_arrivals = argv[++i];
+        } else if (strcmp(argv[i], "--sim-stay") == 0 && i + 1 < argc) {
+            sim_stay_hours = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--sim-trace") == 0 && i + 1 < argc) {
+            sim_trace = argv[++i];
+        } else if (strcmp(argv[i], "--sim-out") == 0 && i + 1 < argc) {
+            sim_out = argv[++i];
+        } else if (strcmp(argv[i], "--replay-paced") == 0) {
+            replay_paced = 1;
+        } else if (strcmp(argv[i], "--metrics-every") == 0 && i + 1 < argc) {
+            metrics_every_seconds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--latency-every") == 0 && i + 1 < argc) {
+            latency_dump_seconds = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--dashboard") == 0) {
+            dashboard_only = 1;
+            use_shared_slots = 1;
+            headless_mode = 1;
+        } else if (strcmp(argv[i], "--replicate") == 0 && i + 1 < argc) {
+            replicate_port = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--replica") == 0 && i + 1 < argc) {
+            upstream_port = atoi(argv[++i]);
+            replica_mode = 1;
+            headless_mode = 1;
+        }
+    }
+
+    term_init(plain_output || (headless_mode && !dashboard_only) || router_port > 0);
+    term_set_quiet(script_path != NULL || bench_users > 0 || loadgen_port >= 0 || profile_startup ||
+                   replay_path != NULL || sim_layouts != NULL);
+    if (latency_dump_seconds > 0) atexit(latency_dump_at_exit);
+    if (metrics_every_seconds > 0) atexit(metrics_write_at_exit);
+
+    // Runs on generated data in its own directory and never loads the real files
+    if (bench_users > 0) {
+        FILE *out = bench_out != NULL ? fopen(bench_out, "w") : stdout;
+        if (out == NULL) {
+            fprintf(stderr, "Cannot write %s\n", bench_out);
+            return 1;
+        }
+        int status = run_benchmark(bench_users, bench_ops, out);
+        if (out != stdout) fclose(out);
+        pool_shutdown();
+        return status;
+    }
+
+    // The router holds no parking data; it only forwards to lot processes
+    if (router_port > 0) {
+        router_server(router_port, routes, route_count);
+        return 0;
+    }
+
+    // Against a running daemon the generator needs no data of its own
+    if (loadgen_port > 0) {
+        return run_load_generator(loadgen_port, loadgen_clients, loadgen_seconds,
+                                  loadgen_think_ms, loadgen_mix);
+    }
+
+    if (lot_id > 0 && enter_lot_directory(lot_id) != 0) {
+        term_printf("Cannot open data directory for lot %d\n", lot_id);
+        return 1;
+    }
+
+    // Works in scratch tables under SIM_DIR; only the lot's tariff is read
+    if (sim_layouts != NULL) {
+        FILE *out = sim_out != NULL ? fopen(sim_out, "w") : stdout;
+        if (out == NULL) {
+            fprintf(stderr, "Cannot write %s\n", sim_out);
+            return 1;
+        }
+        int status = run_simulation(sim_layouts, sim_arrivals, sim_stay_hours, sim_days, sim_runs, sim_trace, out);
+        if (out != stdout) fclose(out);
+        pool_shutdown();
+        return status;
+    }
+
+    double startup_started = monotonic_us();
+    if (use_shared_slots && !replica_mode && shared_slots_attach() != 0) {
+        term_printf("Cannot attach the shared slot table\n");
+        return 1;
+    }
+    if (shared_slots != NULL) startup_phase_record("shared_slots_attach", 0, slot_count, startup_started);
+
+    // A replica starts empty and is filled by the primary's snapshot
+    double phase_started = monotonic_us();
     initialize_system();
-    load_data();
+    startup_phase_record("initialize_system", 0, slot_count, phase_started);
+    record_store_mode = use_record_store && !replica_mode;
+    if (!replica_mode) load_data();
+    // Replicas follow the primary's releases; replays apply the recorded ones
+    if (replica_mode || replay_path != NULL) hold_ttl_seconds = 0;
+    phase_started = monotonic_us();
+    timers_rebuild();
+    startup_phase_record("overstay_timers", 0, reservation_count, phase_started);
+    phase_started = monotonic_us();
+    shared_slots_publish();
+    if (shared_slots != NULL) startup_phase_record("shared_slots_publish", 0, slot_count, phase_started);
+    phase_started = monotonic_us();
+    if (record_store_mode && record_store_open() != 0) {
+        term_printf("Cannot open the record store\n");
+        return 1;
+    }
+    if (record_store_mode) {
+        startup_phase_record("record_store_open", 0,
+                             user_count + vehicle_count + reservation_count + payment_count, phase_started);
+    }
+
+    // Cold-start timing only: nothing is served or saved
+    if (profile_startup) {
+        // Normally built by the first plate lookup; timed here so it is not missed
+        phase_started = monotonic_us();
+        find_vehicle_by_plate("");
+        startup_phase_record("plate_index", 0, plate_index_count, phase_started);
+        phase_started = monotonic_us();
+        geometry_load(); // likewise built by the first nearest-slot pick
+        startup_phase_record("lot_geometry", 0, slot_count, phase_started);
+        startup_report(stdout, monotonic_us() - startup_started);
+        pool_shutdown();
+        shared_slots_detach();
+        record_store_close();
+        return 0;
+    }
+
+    // Runs the trace against the loaded data; the site's files are not written
+    if (replay_path != NULL) {
+        FILE *out = replay_out != NULL ? fopen(replay_out, "w") : stdout;
+        if (out == NULL) {
+            fprintf(stderr, "Cannot write %s\n", replay_out);
+            return 1;
+        }
+        int status = run_replay(replay_path, replay_paced, out);
+        if (out != stdout) fclose(out);
+        pool_shutdown();
+        shared_slots_detach();
+        return status;
+    }
+
+    // Started after loading so the trace begins from the loaded state
+    if (capture_path != NULL && !replica_mode) {
+        if (capture_open(capture_path) != 0) {
+            term_printf("Cannot write the trace %s\n", capture_path);
+            return 1;
+        }
+        atexit(capture_close);
+    }
+
+    if (replica_mode) {
+        if (serve_port == 0) {
+            term_printf("--replica needs --serve <port> to answer queries\n");
+            return 1;
+        }
+        session_server(serve_port);
+        return 0;
+    }
+
+    if (replicate_port > 0 && replication_listen(replicate_port) != 0) {
+        term_printf("Cannot listen for replicas on port %d\n", replicate_port);
+        return 1;
+    }
+
+    // A control-room view only: nothing is changed or saved
+    if (dashboard_only) {
+        slot_dashboard();
+        shared_slots_detach();
+        return 0;
+    }
+
+    if (script_path != NULL) {
+        FILE *input = strcmp(script_path, "-") == 0 ? stdin : fopen(script_path, "r");
+        if (input == NULL) {
+            fprintf(stderr, "Cannot open script %s\n", script_path);
+            return 1;
+        }
+        int failed = run_script(input);
+        if (input != stdin) fclose(input);
+        save_data();
+        pool_shutdown();
+        shared_slots_detach();
+        record_store_close();
+        return failed > 0 ? 2 : 0;
+    }
+
+    // --loadgen 0: the simulated kiosks call this process's engine directly
+    if (loadgen_port == 0) {
+        int status = run_load_generator(0, loadgen_clients, loadgen_seconds, loadgen_think_ms, loadgen_mix);
+        save_data();
+        pool_shutdown();
+        shared_slots_detach();
+        record_store_close();
+        return status;
+    }
+
+    if (anpr_path != NULL) {
+        anpr_tail_mode(anpr_path);
+        save_data();
+        pool_shutdown();
+        shared_slots_detach();
+        record_store_close();
+        return 0;
+    }
+
+    if (serve_port > 0) {
+        session_server(serve_port);
+        save_data();
+        pool_shutdown();
+        shared_slots_detach();
+        record_store_close();
+        return 0;
+    }
+
     main_menu();
     save_data();
+    pool_shutdown();
+    shared_slots_detach();
+    record_store_close();
     return 0;
 }
 
 // System Initialization
 void initialize_system() {
-    if (slot_count == 0) {
+    pricing_load();
+    if (slot_count == 0 && !shared_slots_live) {
         initialize_slots();
     }
 }
@@ -236,7 +1607,7 @@ void initialize_slots() {
         strcpy(slots[slot_count].status, "available");
         slots[slot_count].vehicle_id = 0;
         slots[slot_count].user_id = 0;
-        strcpy(slots[slot_count].reserved_time, "");
+        slots[slot_count].reserved_time = 0;
         slot_count++;
     }
 
@@ -247,7 +1618,7 @@ void initialize_slots() {
         strcpy(slots[slot_count].status, "available");
         slots[slot_count].vehicle_id = 0;
         slots[slot_count].user_id = 0;
-        strcpy(slots[slot_count].reserved_time, "");
+        slots[slot_count].reserved_time = 0;
         slot_count++;
     }
 
@@ -258,29 +1629,36 @@ void initialize_slots() {
         strcpy(slots[slot_count].status, "available");
         slots[slot_count].vehicle_id = 0;
         slots[slot_count].user_id = 0;
-        strcpy(slots[slot_count].reserved_time, "");
+        slots[slot_count].reserved_time = 0;
         slot_count++;
     }
+    slot_counts_rebuild();
 }
 
 // File Handling Functions - Load Data from Text Files
 void load_data() {
     FILE *file;
+    double started = monotonic_us();
+    double phase_started;
+    char when[TIME_TEXT_SIZE], ended[TIME_TEXT_SIZE]; // timestamps as stored in the files
 
     printCentered("Loading system data...", LIGHTCYAN);
-    printf("\n");
+    term_printf("\n");
 
     // Load users from users.txt
+    phase_started = monotonic_us();
     file = fopen("users.txt", "r");
     if (file != NULL) {
-        while (fscanf(file, "%d %s %s %s %s %s %d",
+        while (fscanf(file, "%d %s %s %s %s %19s %d",
                 &users[user_count].user_id, users[user_count].name,
                 users[user_count].phone, users[user_count].email,
-                users[user_count].password, users[user_count].reg_date,
+                users[user_count].password, when,
                 &users[user_count].is_active) == 7) {
+            users[user_count].reg_date = parse_time(when);
             user_count++;
             if (user_count >= MAX_USERS) break;
         }
+        startup_phase_record("load_users", ftell(file), user_count, phase_started);
         fclose(file);
         char msg[100];
         sprintf(msg, "Loaded %d users from users.txt", user_count);
@@ -290,15 +1668,18 @@ void load_data() {
     }
 
     // Load vehicles from vehicles.txt
+    phase_started = monotonic_us();
     file = fopen("vehicles.txt", "r");
     if (file != NULL) {
-        while (fscanf(file, "%d %d %s %s %s %s",
+        while (fscanf(file, "%d %d %s %s %s %19s",
                 &vehicles[vehicle_count].vehicle_id, &vehicles[vehicle_count].user_id,
                 vehicles[vehicle_count].type, vehicles[vehicle_count].license_plate,
-                vehicles[vehicle_count].color, vehicles[vehicle_count].reg_date) == 6) {
+                vehicles[vehicle_count].color, when) == 6) {
+            vehicles[vehicle_count].reg_date = parse_time(when);
             vehicle_count++;
             if (vehicle_count >= MAX_VEHICLES) break;
         }
+        startup_phase_record("load_vehicles", ftell(file), vehicle_count, phase_started);
         fclose(file);
         char msg[100];
         sprintf(msg, "Loaded %d vehicles from vehicles.txt", vehicle_count);
@@ -307,43 +1688,56 @@ void load_data() {
         printCentered("vehicles.txt not found - starting with empty vehicle database", YELLOW);
     }
 
-    // Load slots from slots.txt (only if not already initialized)
-    if (slot_count == 0) {
-        file = fopen("slots.txt", "r");
-        if (file != NULL) {
-            while (fscanf(file, "%d %s %s %d %s %d",
-                    &slots[slot_count].slot_id, slots[slot_count].type,
-                    slots[slot_count].status, &slots[slot_count].vehicle_id,
-                    slots[slot_count].reserved_time, &slots[slot_count].user_id) == 6) {
-                slot_count++;
-                if (slot_count >= MAX_SLOTS) break;
-            }
-            fclose(file);
-            char msg[100];
-            sprintf(msg, "Loaded %d slots from slots.txt", slot_count);
-            printCentered(msg, LIGHTGREEN);
-        } else {
-            printCentered("slots.txt not found - initializing default slots", YELLOW);
-            initialize_slots();
+    // Load slots from slots.txt (replaces the default layout when present).
+    // A live shared slot table is newer than any file, so it is kept.
+    phase_started = monotonic_us();
+    file = shared_slots_live ? NULL : fopen("slots.txt", "r");
+    if (shared_slots_live) {
+        char msg[100];
+        sprintf(msg, "Using %d live slots from shared memory", slot_count);
+        printCentered(msg, LIGHTGREEN);
+    } else if (file != NULL) {
+        slot_count = 0;
+        while (fscanf(file, "%d %s %s %d %19s %d",
+                &slots[slot_count].slot_id, slots[slot_count].type,
+                slots[slot_count].status, &slots[slot_count].vehicle_id,
+                when, &slots[slot_count].user_id) == 6) {
+            slots[slot_count].reserved_time = parse_time(when); // "-" becomes 0
+            slot_count++;
+            if (slot_count >= MAX_SLOTS) break;
         }
+        startup_phase_record("load_slots", ftell(file), slot_count, phase_started);
+        fclose(file);
+        phase_started = monotonic_us();
+        slot_counts_rebuild();
+        startup_phase_record("slot_counts", 0, slot_count, phase_started);
+        char msg[100];
+        sprintf(msg, "Loaded %d slots from slots.txt", slot_count);
+        printCentered(msg, LIGHTGREEN);
+    } else if (slot_count == 0) {
+        printCentered("slots.txt not found - initializing default slots", YELLOW);
+        initialize_slots();
     }
 
     // Load reservations from reservations.txt
+    phase_started = monotonic_us();
     file = fopen("reservations.txt", "r");
     if (file != NULL) {
-        while (fscanf(file, "%d %d %d %d %s %s %s %lf %lf",
+        while (fscanf(file, "%d %d %d %d %19s %19s %s %lf %lf",
                 &reservations[reservation_count].reservation_id,
                 &reservations[reservation_count].user_id,
                 &reservations[reservation_count].slot_id,
                 &reservations[reservation_count].vehicle_id,
-                reservations[reservation_count].start_time,
-                reservations[reservation_count].end_time,
+                when, ended,
                 reservations[reservation_count].status,
                 &reservations[reservation_count].duration_hours,
                 &reservations[reservation_count].total_amount) == 9) {
+            reservations[reservation_count].start_time = parse_time(when);
+            reservations[reservation_count].end_time = parse_time(ended);
             reservation_count++;
             if (reservation_count >= MAX_RESERVATIONS) break;
         }
+        startup_phase_record("load_reservations", ftell(file), reservation_count, phase_started);
         fclose(file);
         char msg[100];
         sprintf(msg, "Loaded %d reservations from reservations.txt", reservation_count);
@@ -353,19 +1747,22 @@ void load_data() {
     }
 
     // Load payments from payments.txt
+    phase_started = monotonic_us();
     file = fopen("payments.txt", "r");
     if (file != NULL) {
-        while (fscanf(file, "%d %d %d %lf %s %s %s",
+        while (fscanf(file, "%d %d %d %lf %s %19s %s",
                 &payments[payment_count].payment_id,
                 &payments[payment_count].user_id,
                 &payments[payment_count].reservation_id,
                 &payments[payment_count].amount,
                 payments[payment_count].method,
-                payments[payment_count].payment_date,
+                when,
                 payments[payment_count].status) == 7) {
+            payments[payment_count].payment_date = parse_time(when);
             payment_count++;
             if (payment_count >= MAX_PAYMENTS) break;
         }
+        startup_phase_record("load_payments", ftell(file), payment_count, phase_started);
         fclose(file);
         char msg[100];
         sprintf(msg, "Loaded %d payments from payments.txt", payment_count);
@@ -374,49 +1771,70 @@ void load_data() {
         printCentered("payments.txt not found - starting with empty payment database", YELLOW);
     }
 
-    printf("\n");
+    // Apply committed journal batches written after the last snapshot
+    double replay_started = monotonic_us();
+    int replayed = journal_replay();
+    latency_record(METRIC_JOURNAL_REPLAY, replay_started, 0);
+    startup_phase_record("journal_replay", journal_replay_bytes, replayed, replay_started);
+    if (replayed > 0) {
+        char msg[100];
+        sprintf(msg, "Replayed %d journal batches from %s", replayed, JOURNAL_FILE);
+        printCentered(msg, LIGHTGREEN);
+    }
+    latency_record(METRIC_LOAD_DATA, started, 0);
+    snapshot_saved_ms = monotonic_ms();
+
+    term_printf("\n");
+    if (headless_mode) {
+        printCentered("Data loading complete.", LIGHTCYAN);
+        return;
+    }
     printCentered("Data loading complete. Press any key to continue...", LIGHTCYAN);
-    getch();
+    phase_started = monotonic_us();
+    term_getch();
+    startup_phase_record("wait_for_key", 0, 0, phase_started);
 }
 
 // File Handling Functions - Save Data to Text Files
 void save_data() {
     FILE *file;
+    double started = monotonic_us();
+    char when[TIME_TEXT_SIZE], ended[TIME_TEXT_SIZE];
 
     printCentered("Saving system data...", LIGHTCYAN);
-    printf("\n");
+    term_printf("\n");
 
     // Save users to users.txt
-    file = fopen("users.txt", "w");
+    file = record_store_mode ? NULL : fopen("users.txt", "w");
     if (file != NULL) {
         for (int i = 0; i < user_count; i++) {
             fprintf(file, "%d %s %s %s %s %s %d\n",
                     users[i].user_id, users[i].name, users[i].phone,
-                    users[i].email, users[i].password, users[i].reg_date,
-                    users[i].is_active);
+                    users[i].email, users[i].password,
+                    format_time(users[i].reg_date, when), users[i].is_active);
         }
         fclose(file);
         char msg[100];
         sprintf(msg, "Saved %d users to users.txt", user_count);
         printCentered(msg, LIGHTGREEN);
-    } else {
+    } else if (!record_store_mode) {
         printCentered("Error: Could not save users.txt", LIGHTRED);
     }
 
     // Save vehicles to vehicles.txt
-    file = fopen("vehicles.txt", "w");
+    file = record_store_mode ? NULL : fopen("vehicles.txt", "w");
     if (file != NULL) {
         for (int i = 0; i < vehicle_count; i++) {
             fprintf(file, "%d %d %s %s %s %s\n",
                     vehicles[i].vehicle_id, vehicles[i].user_id,
                     vehicles[i].type, vehicles[i].license_plate,
-                    vehicles[i].color, vehicles[i].reg_date);
+                    vehicles[i].color, format_time(vehicles[i].reg_date, when));
         }
         fclose(file);
         char msg[100];
         sprintf(msg, "Saved %d vehicles to vehicles.txt", vehicle_count);
         printCentered(msg, LIGHTGREEN);
-    } else {
+    } else if (!record_store_mode) {
         printCentered("Error: Could not save vehicles.txt", LIGHTRED);
     }
 
@@ -426,7 +1844,8 @@ void save_data() {
         for (int i = 0; i < slot_count; i++) {
             fprintf(file, "%d %s %s %d %s %d\n",
                     slots[i].slot_id, slots[i].type, slots[i].status,
-                    slots[i].vehicle_id, slots[i].reserved_time, slots[i].user_id);
+                    slots[i].vehicle_id,
+                    format_time(slots[i].reserved_time, when), slots[i].user_id);
         }
         fclose(file);
         char msg[100];
@@ -437,13 +1856,14 @@ void save_data() {
     }
 
     // Save reservations to reservations.txt
-    file = fopen("reservations.txt", "w");
+    file = record_store_mode ? NULL : fopen("reservations.txt", "w");
     if (file != NULL) {
         for (int i = 0; i < reservation_count; i++) {
             fprintf(file, "%d %d %d %d %s %s %s %.2f %.2f\n",
                     reservations[i].reservation_id, reservations[i].user_id,
                     reservations[i].slot_id, reservations[i].vehicle_id,
-                    reservations[i].start_time, reservations[i].end_time,
+                    format_time(reservations[i].start_time, when),
+                    format_time(reservations[i].end_time, ended),
                     reservations[i].status, reservations[i].duration_hours,
                     reservations[i].total_amount);
         }
@@ -451,35 +1871,44 @@ void save_data() {
         char msg[100];
         sprintf(msg, "Saved %d reservations to reservations.txt", reservation_count);
         printCentered(msg, LIGHTGREEN);
-    } else {
+    } else if (!record_store_mode) {
         printCentered("Error: Could not save reservations.txt", LIGHTRED);
     }
 
     // Save payments to payments.txt
-    file = fopen("payments.txt", "w");
+    file = record_store_mode ? NULL : fopen("payments.txt", "w");
     if (file != NULL) {
         for (int i = 0; i < payment_count; i++) {
             fprintf(file, "%d %d %d %.2f %s %s %s\n",
                     payments[i].payment_id, payments[i].user_id,
                     payments[i].reservation_id, payments[i].amount,
-                    payments[i].method, payments[i].payment_date,
+                    payments[i].method, format_time(payments[i].payment_date, when),
                     payments[i].status);
         }
         fclose(file);
         char msg[100];
         sprintf(msg, "Saved %d payments to payments.txt", payment_count);
         printCentered(msg, LIGHTGREEN);
-    } else {
+    } else if (!record_store_mode) {
         printCentered("Error: Could not save payments.txt", LIGHTRED);
     }
 
-    printf("\n");
+    if (record_store_mode) {
+        printCentered("Users, vehicles, reservations and payments are kept in the record store", LIGHTGREEN);
+    }
+
+    // The snapshot now holds every journaled change
+    journal_checkpoint();
+    latency_record(METRIC_SAVE_DATA, started, 0);
+    snapshot_saved_ms = monotonic_ms();
+
+    term_printf("\n");
     printCentered("All data saved successfully!", LIGHTCYAN);
 }
 
 // Utility Functions
 void clear_screen() {
-    system(CLEAR_SCREEN);
+    term_clear();
 }
 
 void print_header() {
@@ -491,33 +1920,31 @@ void print_header() {
 }
 
 void pause_screen() {
-    printf("\n");
+    term_printf("\n");
     printCentered("Press any key to continue...", LIGHTGRAY);
-    getch();
+    term_getch();
 }
 
-int validate_phone(char *phone) {
+// Returns a description of what is wrong, or NULL for a valid number
+const char *phone_problem(const char *phone) {
     if (strlen(phone) != 11) {
-        printCentered("Phone number must be exactly 11 digits!", LIGHTRED);
-        return 0;
+        return "Phone number must be exactly 11 digits!";
     }
 
     for (int i = 0; i < 11; i++) {
-        if (!isdigit(phone[i])) {
-            printCentered("Phone number must contain only digits!", LIGHTRED);
-            return 0;
+        if (!isdigit((unsigned char)phone[i])) {
+            return "Phone number must contain only digits!";
         }
     }
-    return 1;
+    return NULL;
 }
 
-int validate_email(char *email) {
+const char *email_problem(const char *email) {
     int at_count = 0, dot_count = 0;
     int len = strlen(email);
 
     if (len < 5) {
-        printCentered("Email too short!", LIGHTRED);
-        return 0;
+        return "Email too short!";
     }
 
     for (int i = 0; i < len; i++) {
@@ -526,60 +1953,255 @@ int validate_email(char *email) {
     }
 
     if (at_count != 1 || dot_count < 1) {
-        printCentered("Invalid email format!", LIGHTRED);
+        return "Invalid email format!";
+    }
+    return NULL;
+}
+
+int validate_phone(char *phone) {
+    const char *problem = phone_problem(phone);
+    if (problem != NULL) {
+        printCentered(problem, LIGHTRED);
         return 0;
     }
     return 1;
 }
 
-void get_current_time(char *time_str) {
-    time_t now;
-    struct tm *local;
-
-    time(&now);
-    local = localtime(&now);
-
-    sprintf(time_str, "%04d-%02d-%02d_%02d:%02d:%02d",
-            local->tm_year + 1900,
-            local->tm_mon + 1,
-            local->tm_mday,
-            local->tm_hour,
-            local->tm_min,
-            local->tm_sec);
+int validate_email(char *email) {
+    const char *problem = email_problem(email);
+    if (problem != NULL) {
+        printCentered(problem, LIGHTRED);
+        return 0;
+    }
+    return 1;
 }
 
-double calculate_duration(char *start_time, char *end_time) {
-    return 1.0;
+// Engine Clock
+// Every engine timestamp comes from now_epoch(). --clock swaps the system
+// clock for a simulated one, so overstays, hold expiry and time-of-day
+// pricing can be exercised without waiting:
+//   real                 the system clock (default)
+//   fixed[@<time>]       stands still; moved only by clock_advance
+//   <rate>x[@<time>]     runs <rate> times faster than real time
+// <time> is YYYY-MM-DD_HH:MM:SS; without it the clock starts at the real time.
+// Latencies are always measured on the real monotonic clock.
+long long now_epoch() {
+    if (clock_mode == CLOCK_FIXED) return clock_origin;
+    if (clock_mode == CLOCK_ACCELERATED) {
+        return clock_origin + (long long)((monotonic_us() - clock_origin_us) * clock_rate / 1e6);
+    }
+    return (long long)time(NULL);
 }
 
-void mask_password(char *password) {
-    int i = 0;
-    char ch;
-
-    while ((ch = getch()) != '\r') { // Enter key
-        if (ch == '\b' && i > 0) { // Backspace
-            printf("\b \b");
-            i--;
-        } else if (ch != '\b' && i < MAX_STRING - 1) {
-            password[i++] = ch;
-            printf("*");
-        }
+// Returns 0, or -1 for a spec it does not understand
+int clock_configure(const char *spec) {
+    char mode[32];
+    const char *at = strchr(spec, '@');
+    long long origin = at != NULL ? parse_time(at + 1) : (long long)time(NULL);
+    int length = at != NULL ? (int)(at - spec) : (int)strlen(spec);
+    double rate;
+    char unit;
+
+    if (origin <= 0 || length >= (int)sizeof(mode)) return -1;
+    memcpy(mode, spec, length);
+    mode[length] = '\0';
+    if (strcmp(mode, "real") == 0 && at == NULL) {
+        clock_mode = CLOCK_REAL;
+    } else if (strcmp(mode, "fixed") == 0) {
+        clock_mode = CLOCK_FIXED;
+    } else if (sscanf(mode, "%lf%c", &rate, &unit) == 2 && unit == 'x' && rate > 0) {
+        clock_mode = CLOCK_ACCELERATED;
+        clock_rate = rate;
+    } else {
+        return -1;
     }
-    password[i] = '\0';
-    printf("\n");
+    clock_origin = origin;
+    clock_origin_us = monotonic_us();
+    return 0;
 }
 
-int get_next_user_id() {
-    int max_id = 0;
-    for (int i = 0; i < user_count; i++) {
-        if (users[i].user_id > max_id) {
-            max_id = users[i].user_id;
-        }
-    }
-    return max_id + 1;
+// Moves a simulated clock forward and fires the timers that fall due.
+// The real clock cannot be moved: returns ENGINE_ERR_STATE.
+int clock_advance(long long seconds) {
+    if (clock_mode == CLOCK_REAL) return ENGINE_ERR_STATE;
+    if (seconds < 0) return ENGINE_ERR_INVALID;
+    clock_origin += seconds;
+    timers_advance(now_epoch());
+    return ENGINE_OK;
 }
 
-int get_next_vehicle_id() {
+// Timestamps
+// Engine timestamps are epoch seconds. They are turned into the
+// "YYYY-MM-DD_HH:MM:SS" text of the data files only for display and export.
+// The calendar math is done here; the zone database is asked only for the
+// UTC offset, once per day seen (localtime and mktime re-read the zone file
+// on every call). The text of the last second formatted is reused as is.
+// Days from 1970-01-01 to a proleptic Gregorian date
+static long long days_from_civil(int year, int month, int day) {
+    year -= month <= 2;
+    long long era = (year >= 0 ? year : year - 399) / 400;
+    int year_of_era = year - (int)(era * 400);
+    int day_of_year = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    int day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + day_of_era - 719468;
+}
+
+// Inverse of days_from_civil
+static void civil_from_days(long long days, int *year, int *month, int *day) {
+    days += 719468;
+    long long era = (days >= 0 ? days : days - 146096) / 146097;
+    int day_of_era = (int)(days - era * 146097);
+    int year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    int day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    int month_index = (5 * day_of_year + 2) / 153;
+    *day = day_of_year - (153 * month_index + 2) / 5 + 1;
+    *month = month_index < 10 ? month_index + 3 : month_index - 9;
+    *year = (int)(year_of_era + era * 400) + (*month <= 2);
+}
+
+static long long floor_div(long long value, long long divisor) {
+    return value >= 0 ? value / divisor : -((-value + divisor - 1) / divisor);
+}
+
+// Seconds the local clock is ahead of UTC at `when`, from the zone database
+static long long utc_offset_lookup(long long when) {
+    time_t seconds = (time_t)when;
+    struct tm local;
+#ifdef _WIN32
+    localtime_s(&local, &seconds);
+#else
+    localtime_r(&seconds, &local);
+#endif
+    return days_from_civil(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday) * 86400 +
+           local.tm_hour * 3600 + local.tm_min * 60 + local.tm_sec - when;
+}
+
+// Same, cached per UTC day. Days with a daylight-saving change are not cached.
+// Each entry packs the day and offset into one word, read and written
+// atomically, so pool workers can share the cache without a lock.
+static long long utc_offset_at(long long when) {
+    static long long cached[ZONE_CACHE_DAYS]; // day << 20 | (offset + 2^19), 0 when empty
+    long long day = floor_div(when, 86400);
+    int slot = (int)(day & (ZONE_CACHE_DAYS - 1));
+
+    long long entry = __atomic_load_n(&cached[slot], __ATOMIC_RELAXED);
+    if (entry != 0 && floor_div(entry, 1 << 20) == day) return entry - day * (1 << 20) - (1 << 19);
+    long long offset = utc_offset_lookup(day * 86400);
+    if (utc_offset_lookup(day * 86400 + 86399) != offset) return utc_offset_lookup(when);
+    __atomic_store_n(&cached[slot], day * (1 << 20) + offset + (1 << 19), __ATOMIC_RELAXED);
+    return offset;
+}
+
+// Value of `count` decimal digits at text, -1 if any is not a digit
+static int text_digits(const char *text, int count) {
+    int value = 0;
+    for (int i = 0; i < count; i++) {
+        if (text[i] < '0' || text[i] > '9') return -1;
+        value = value * 10 + (text[i] - '0');
+    }
+    return value;
+}
+
+static void put_digits(char *text, int value, int count) {
+    for (int i = count - 1; i >= 0; i--) {
+        text[i] = '0' + value % 10;
+        value /= 10;
+    }
+}
+
+// Writes the text for `when` to out (TIME_TEXT_SIZE bytes); "-" for 0
+char *format_time(long long when, char *out) {
+    static long long cached_second = -1;
+    static char cached_text[TIME_TEXT_SIZE];
+    int year, month, day;
+
+    if (when <= 0) {
+        strcpy(out, "-");
+        return out;
+    }
+    if (when != cached_second) {
+        long long local = when + utc_offset_at(when);
+        long long days = floor_div(local, 86400);
+        int seconds = (int)(local - days * 86400);
+        civil_from_days(days, &year, &month, &day);
+        put_digits(cached_text, year, 4);
+        cached_text[4] = '-';
+        put_digits(cached_text + 5, month, 2);
+        cached_text[7] = '-';
+        put_digits(cached_text + 8, day, 2);
+        cached_text[10] = '_';
+        put_digits(cached_text + 11, seconds / 3600, 2);
+        cached_text[13] = ':';
+        put_digits(cached_text + 14, seconds / 60 % 60, 2);
+        cached_text[16] = ':';
+        put_digits(cached_text + 17, seconds % 60, 2);
+        cached_text[19] = '\0';
+        cached_second = when;
+    }
+    strcpy(out, cached_text);
+    return out;
+}
+
+void get_current_time(char *time_str) {
+    format_time(now_epoch(), time_str);
+}
+
+// Inverse of format_time; 0 for "-" or text not in that format
+long long parse_time(const char *time_str) {
+    if (strlen(time_str) != TIME_TEXT_SIZE - 1 || time_str[4] != '-' || time_str[7] != '-' ||
+        time_str[10] != '_' || time_str[13] != ':' || time_str[16] != ':') {
+        return 0;
+    }
+    int year = text_digits(time_str, 4), month = text_digits(time_str + 5, 2);
+    int day = text_digits(time_str + 8, 2), hour = text_digits(time_str + 11, 2);
+    int minute = text_digits(time_str + 14, 2), second = text_digits(time_str + 17, 2);
+    if (year < 0 || month < 1 || month > 12 || day < 1 || day > 31 || hour < 0 || hour > 23 ||
+        minute < 0 || minute > 59 || second < 0 || second > 60) {
+        return 0;
+    }
+
+    // The wall-clock time read as UTC, moved back by the zone offset.
+    // The second lookup settles times next to a daylight-saving change.
+    long long wall = days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+    long long guess = wall - utc_offset_at(wall);
+    return wall - utc_offset_at(guess);
+}
+
+// Hours from start_time to end_time, or to now while end_time is 0
+double calculate_duration(long long start_time, long long end_time) {
+    long long end = end_time > 0 ? end_time : now_epoch();
+    if (start_time <= 0 || end < start_time) return 0;
+    return (end - start_time) / 3600.0;
+}
+
+void mask_password(char *password) {
+    int i = 0;
+    char ch;
+
+    while ((ch = term_getch()) != '\r') { // Enter key
+        if (ch == '\b' && i > 0) { // Backspace
+            term_printf("\b \b");
+            i--;
+        } else if (ch != '\b' && i < MAX_STRING - 1) {
+            password[i++] = ch;
+            term_printf("*");
+        }
+    }
+    password[i] = '\0';
+    term_printf("\n");
+}
+
+int get_next_user_id() {
+    int max_id = 0;
+    for (int i = 0; i < user_count; i++) {
+        if (users[i].user_id > max_id) {
+            max_id = users[i].user_id;
+        }
+    }
+    return max_id + 1;
+}
+
+int get_next_vehicle_id() {
     int max_id = 0;
     for (int i = 0; i < vehicle_count; i++) {
         if (vehicles[i].vehicle_id > max_id) {
@@ -627,23 +2249,23 @@ void main_menu() {
     while (1) {
         clear_screen();
         print_header();
-        printf("\n");
+        term_printf("\n");
 
         printCentered("MAIN MENU", LIGHTCYAN);
         printCentered("Please select an option:", LIGHTGREEN);
-        printf("\n");
+        term_printf("\n");
 
         printCentered("1. Register Customer", LIGHTGREEN);
         printCentered("2. User Login", LIGHTBLUE);
         printCentered("3. Admin Login", LIGHTMAGENTA);
         printCentered("4. Exit System", LIGHTRED);
 
-        printf("\n");
+        term_printf("\n");
         setColor(YELLOW);
-        printf("%*s", (CONSOLE_WIDTH - 15) / 2, "");
-        printf("Enter choice: ");
+        term_printf("%*s", (CONSOLE_WIDTH - 15) / 2, "");
+        term_printf("Enter choice: ");
         resetColor();
-        scanf("%d", &choice);
+        term_scanf("%d", &choice);
 
         switch (choice) {
             case 1:
@@ -656,13 +2278,13 @@ void main_menu() {
                 admin_login();
                 break;
             case 4:
-                printf("\n");
+                term_printf("\n");
                 printCentered("Thank you for using SMART PARK System!", LIGHTCYAN);
                 printCentered("Have a great day!", YELLOW);
                 save_data();
                 exit(0);
             default:
-                printf("\n");
+                term_printf("\n");
                 printCentered("Invalid choice! Please try again.", LIGHTRED);
                 pause_screen();
         }
@@ -673,13 +2295,14 @@ void user_menu() {
     int choice;
 
     while (1) {
+        record_store_refresh();
         clear_screen();
         print_header();
-        printf("\n");
+        term_printf("\n");
 
         printCentered("USER DASHBOARD", LIGHTCYAN);
         printCentered("Welcome to your personal parking hub!", LIGHTGREEN);
-        printf("\n");
+        term_printf("\n");
 
         printCentered("1. Update Profile", YELLOW);
         printCentered("2. Add Vehicle", LIGHTBLUE);
@@ -694,12 +2317,12 @@ void user_menu() {
         printCentered("11. Generate My Report", LIGHTGREEN);
         printCentered("12. Logout", DARKGRAY);
 
-        printf("\n");
+        term_printf("\n");
         setColor(YELLOW);
-        printf("%*s", (CONSOLE_WIDTH - 15) / 2, "");
-        printf("Enter choice: ");
+        term_printf("%*s", (CONSOLE_WIDTH - 15) / 2, "");
+        term_printf("Enter choice: ");
         resetColor();
-        scanf("%d", &choice);
+        term_scanf("%d", &choice);
 
         switch (choice) {
             case 1:
@@ -741,7 +2364,7 @@ void user_menu() {
                 pause_screen();
                 return;
             default:
-                printf("\n");
+                term_printf("\n");
                 printCentered("Invalid choice! Please try again.", LIGHTRED);
                 pause_screen();
         }
@@ -754,11 +2377,11 @@ void admin_menu() {
     while (1) {
         clear_screen();
         print_header();
-        printf("\n");
+        term_printf("\n");
 
         printCentered("ADMIN DASHBOARD", LIGHTRED);
         printCentered("System Administration Portal", YELLOW);
-        printf("\n");
+        term_printf("\n");
 
         printCentered("1. View All Users", LIGHTBLUE);
         printCentered("2. Search Users", LIGHTGREEN);
@@ -768,14 +2391,17 @@ void admin_menu() {
         printCentered("6. Slot Usage Report", MAGENTA);
         printCentered("7. Generate Daily Report", WHITE);
         printCentered("8. Check System Overstays", LIGHTMAGENTA);
-        printCentered("9. Logout", DARKGRAY);
+        printCentered("9. Live Slot Map", LIGHTGREEN);
+        printCentered("10. Latency Statistics", LIGHTCYAN);
+        printCentered("11. Memory Usage", LIGHTBLUE);
+        printCentered("12. Logout", DARKGRAY);
 
-        printf("\n");
+        term_printf("\n");
         setColor(YELLOW);
-        printf("%*s", (CONSOLE_WIDTH - 15) / 2, "");
-        printf("Enter choice: ");
+        term_printf("%*s", (CONSOLE_WIDTH - 15) / 2, "");
+        term_printf("Enter choice: ");
         resetColor();
-        scanf("%d", &choice);
+        term_scanf("%d", &choice);
 
         switch (choice) {
             case 1:
@@ -803,12 +2429,21 @@ void admin_menu() {
                 check_overstay();
                 break;
             case 9:
+                slot_dashboard();
+                break;
+            case 10:
+                admin_latency_report();
+                break;
+            case 11:
+                admin_memory_report();
+                break;
+            case 12:
                 is_admin = 0;
                 printCentered("Admin logged out successfully!", LIGHTGREEN);
                 pause_screen();
                 return;
             default:
-                printf("\n");
+                term_printf("\n");
                 printCentered("Invalid choice! Please try again.", LIGHTRED);
                 pause_screen();
         }
@@ -819,69 +2454,68 @@ void admin_menu() {
 void user_register() {
     clear_screen();
     print_header();
-    printf("\n");
+    term_printf("\n");
     printCentered("CUSTOMER REGISTRATION", LIGHTGREEN);
     printCentered("Create your SMART PARK account", LIGHTCYAN);
-    printf("\n");
+    term_printf("\n");
 
     User new_user;
-    new_user.user_id = get_next_user_id();
-    new_user.is_active = 1;
 
     setColor(WHITE);
-    printf("%*s", (CONSOLE_WIDTH - 25) / 2, "");
-    printf("Enter your full name: ");
+    term_printf("%*s", (CONSOLE_WIDTH - 25) / 2, "");
+    term_printf("Enter your full name: ");
     resetColor();
-    scanf("%s", new_user.name);
+    term_scanf("%s", new_user.name);
 
     // Phone number validation
     do {
         setColor(WHITE);
-        printf("%*s", (CONSOLE_WIDTH - 35) / 2, "");
-        printf("Enter phone number (11 digits): ");
+        term_printf("%*s", (CONSOLE_WIDTH - 35) / 2, "");
+        term_printf("Enter phone number (11 digits): ");
         resetColor();
-        scanf("%s", new_user.phone);
+        term_scanf("%s", new_user.phone);
     } while (!validate_phone(new_user.phone));
 
     // Email validation
     do {
         setColor(WHITE);
-        printf("%*s", (CONSOLE_WIDTH - 25) / 2, "");
-        printf("Enter email address: ");
+        term_printf("%*s", (CONSOLE_WIDTH - 25) / 2, "");
+        term_printf("Enter email address: ");
         resetColor();
-        scanf("%s", new_user.email);
+        term_scanf("%s", new_user.email);
     } while (!validate_email(new_user.email));
 
     setColor(WHITE);
-    printf("%*s", (CONSOLE_WIDTH - 30) / 2, "");
-    printf("Create a secure password: ");
+    term_printf("%*s", (CONSOLE_WIDTH - 30) / 2, "");
+    term_printf("Create a secure password: ");
     resetColor();
     mask_password(new_user.password);
 
-    get_current_time(new_user.reg_date);
-
-    // Check if phone or email already exists
-    for (int i = 0; i < user_count; i++) {
-        if (strcmp(users[i].phone, new_user.phone) == 0) {
-            printf("\n");
-            printCentered("Phone number already registered!", LIGHTRED);
-            printCentered("Please use a different phone number.", YELLOW);
-            pause_screen();
-            return;
-        }
-        if (strcmp(users[i].email, new_user.email) == 0) {
-            printf("\n");
-            printCentered("Email already registered!", LIGHTRED);
-            printCentered("Please use a different email address.", YELLOW);
-            pause_screen();
-            return;
-        }
+    int result = engine_register_user(new_user.name, new_user.phone, new_user.email, new_user.password);
+    if (result == ENGINE_ERR_DUPLICATE_PHONE) {
+        term_printf("\n");
+        printCentered("Phone number already registered!", LIGHTRED);
+        printCentered("Please use a different phone number.", YELLOW);
+        pause_screen();
+        return;
     }
+    if (result == ENGINE_ERR_DUPLICATE_EMAIL) {
+        term_printf("\n");
+        printCentered("Email already registered!", LIGHTRED);
+        printCentered("Please use a different email address.", YELLOW);
+        pause_screen();
+        return;
+    }
+    if (result < 0) {
+        term_printf("\n");
+        printCentered("Registration failed!", LIGHTRED);
+        printCentered(engine_error_text(result), YELLOW);
+        pause_screen();
+        return;
+    }
+    new_user = users[result];
 
-    users[user_count] = new_user;
-    user_count++;
-
-    printf("\n");
+    term_printf("\n");
     printCenteredLine('=', LIGHTGREEN);
     printCentered("REGISTRATION SUCCESSFUL!", LIGHTGREEN);
     printCenteredLine('=', LIGHTGREEN);
@@ -900,45 +2534,43 @@ void user_register() {
 void user_login() {
     clear_screen();
     print_header();
-    printf("\n");
+    term_printf("\n");
     printCentered("CUSTOMER LOGIN", LIGHTBLUE);
     printCentered("Access your SMART PARK account", LIGHTCYAN);
-    printf("\n");
+    term_printf("\n");
 
     char phone[20], password[MAX_STRING];
 
     setColor(WHITE);
-    printf("%*s", (CONSOLE_WIDTH - 25) / 2, "");
-    printf("Enter phone number: ");
+    term_printf("%*s", (CONSOLE_WIDTH - 25) / 2, "");
+    term_printf("Enter phone number: ");
     resetColor();
-    scanf("%s", phone);
+    term_scanf("%s", phone);
 
     setColor(WHITE);
-    printf("%*s", (CONSOLE_WIDTH - 20) / 2, "");
-    printf("Enter password: ");
+    term_printf("%*s", (CONSOLE_WIDTH - 20) / 2, "");
+    term_printf("Enter password: ");
     resetColor();
     mask_password(password);
 
-    for (int i = 0; i < user_count; i++) {
-        if (strcmp(users[i].phone, phone) == 0 &&
-            strcmp(users[i].password, password) == 0 &&
-            users[i].is_active == 1) {
-            current_user_id = users[i].user_id;
-            printf("\n");
-            printCenteredLine('=', LIGHTGREEN);
-            printCentered("LOGIN SUCCESSFUL!", LIGHTGREEN);
-            printCenteredLine('=', LIGHTGREEN);
-            char welcome_msg[100];
-            sprintf(welcome_msg, "Welcome back, %s!", users[i].name);
-            printCentered(welcome_msg, LIGHTCYAN);
-            printCentered("Redirecting to your dashboard...", YELLOW);
-            pause_screen();
-            user_menu();
-            return;
-        }
+    int user_id = engine_login(phone, password);
+    if (user_id != -1) {
+        int i = find_user_index(user_id);
+        current_user_id = user_id;
+        term_printf("\n");
+        printCenteredLine('=', LIGHTGREEN);
+        printCentered("LOGIN SUCCESSFUL!", LIGHTGREEN);
+        printCenteredLine('=', LIGHTGREEN);
+        char welcome_msg[100];
+        sprintf(welcome_msg, "Welcome back, %s!", users[i].name);
+        printCentered(welcome_msg, LIGHTCYAN);
+        printCentered("Redirecting to your dashboard...", YELLOW);
+        pause_screen();
+        user_menu();
+        return;
     }
 
-    printf("\n");
+    term_printf("\n");
     printCentered("LOGIN FAILED!", LIGHTRED);
     printCentered("Invalid credentials or account deactivated!", YELLOW);
     printCentered("Please check your phone number and password.", LIGHTCYAN);
@@ -948,28 +2580,28 @@ void user_login() {
 void admin_login() {
     clear_screen();
     print_header();
-    printf("\n");
+    term_printf("\n");
     printCentered("ADMINISTRATOR LOGIN", LIGHTRED);
     printCentered("SMART PARK System Administration", YELLOW);
-    printf("\n");
+    term_printf("\n");
 
     char username[MAX_STRING], password[MAX_STRING];
 
     setColor(WHITE);
-    printf("%*s", (CONSOLE_WIDTH - 25) / 2, "");
-    printf("Enter admin username: ");
+    term_printf("%*s", (CONSOLE_WIDTH - 25) / 2, "");
+    term_printf("Enter admin username: ");
     resetColor();
-    scanf("%s", username);
+    term_scanf("%s", username);
 
     setColor(WHITE);
-    printf("%*s", (CONSOLE_WIDTH - 25) / 2, "");
-    printf("Enter admin password: ");
+    term_printf("%*s", (CONSOLE_WIDTH - 25) / 2, "");
+    term_printf("Enter admin password: ");
     resetColor();
     mask_password(password);
 
     if (strcmp(username, "sajib") == 0 && strcmp(password, "12345") == 0) {
         is_admin = 1;
-        printf("\n");
+        term_printf("\n");
         printCenteredLine('=', LIGHTGREEN);
         printCentered("ADMIN LOGIN SUCCESSFUL!", LIGHTGREEN);
         printCenteredLine('=', LIGHTGREEN);
@@ -978,7 +2610,7 @@ void admin_login() {
         pause_screen();
         admin_menu();
     } else {
-        printf("\n");
+        term_printf("\n");
         printCentered("ACCESS DENIED!", LIGHTRED);
         printCentered("Invalid administrator credentials!", YELLOW);
         printCentered("Contact system admin for assistance.", LIGHTCYAN);
@@ -990,10 +2622,10 @@ void admin_login() {
 void update_profile() {
     clear_screen();
     print_header();
-    printf("\n");
+    term_printf("\n");
     printCentered("UPDATE PROFILE", YELLOW);
     printCentered("Modify your account information", LIGHTCYAN);
-    printf("\n");
+    term_printf("\n");
 
     int user_index = -1;
     for (int i = 0; i < user_count; i++) {
@@ -1012,19 +2644,19 @@ void update_profile() {
     printCenteredLine('-', LIGHTCYAN);
     printCentered("CURRENT PROFILE INFORMATION", LIGHTCYAN);
     printCenteredLine('-', LIGHTCYAN);
-    char info[200];
+    char info[200], when[TIME_TEXT_SIZE];
     sprintf(info, "Name: %s", users[user_index].name);
     printCentered(info, WHITE);
     sprintf(info, "Phone: %s", users[user_index].phone);
     printCentered(info, WHITE);
     sprintf(info, "Email: %s", users[user_index].email);
     printCentered(info, WHITE);
-    sprintf(info, "Member since: %s", users[user_index].reg_date);
+    sprintf(info, "Member since: %s", format_time(users[user_index].reg_date, when));
     printCentered(info, LIGHTGRAY);
 
-    printf("\n");
+    term_printf("\n");
     printCentered("What would you like to update?", WHITE);
-    printf("\n");
+    term_printf("\n");
     printCentered("1. Update Name", LIGHTGREEN);
     printCentered("2. Update Phone", LIGHTGREEN);
     printCentered("3. Update Email", LIGHTGREEN);
@@ -1033,64 +2665,68 @@ void update_profile() {
 
     int choice;
     setColor(WHITE);
-    printf("%*s", (CONSOLE_WIDTH - 15) / 2, "");
-    printf("Enter choice: ");
+    term_printf("%*s", (CONSOLE_WIDTH - 15) / 2, "");
+    term_printf("Enter choice: ");
     resetColor();
-    scanf("%d", &choice);
+    term_scanf("%d", &choice);
 
     switch (choice) {
         case 1:
-            printf("\n");
+            term_printf("\n");
             setColor(WHITE);
-            printf("%*s", (CONSOLE_WIDTH - 20) / 2, "");
-            printf("Enter new name: ");
+            term_printf("%*s", (CONSOLE_WIDTH - 20) / 2, "");
+            term_printf("Enter new name: ");
             resetColor();
-            scanf("%s", users[user_index].name);
-            printf("\n");
+            term_scanf("%s", users[user_index].name);
+            term_printf("\n");
             printCentered("Name updated successfully!", LIGHTGREEN);
+            record_store_put('U', user_index);
             save_data();
             break;
         case 2:
-            printf("\n");
+            term_printf("\n");
             do {
                 setColor(WHITE);
-                printf("%*s", (CONSOLE_WIDTH - 30) / 2, "");
-                printf("Enter new phone (11 digits): ");
+                term_printf("%*s", (CONSOLE_WIDTH - 30) / 2, "");
+                term_printf("Enter new phone (11 digits): ");
                 resetColor();
-                scanf("%s", users[user_index].phone);
+                term_scanf("%s", users[user_index].phone);
             } while (!validate_phone(users[user_index].phone));
-            printf("\n");
+            term_printf("\n");
             printCentered("Phone number updated successfully!", LIGHTGREEN);
+            record_store_put('U', user_index);
             save_data();
             break;
         case 3:
-            printf("\n");
+            term_printf("\n");
             do {
                 setColor(WHITE);
-                printf("%*s", (CONSOLE_WIDTH - 20) / 2, "");
-                printf("Enter new email: ");
+                term_printf("%*s", (CONSOLE_WIDTH - 20) / 2, "");
+                term_printf("Enter new email: ");
                 resetColor();
-                scanf("%s", users[user_index].email);
+                term_scanf("%s", users[user_index].email);
             } while (!validate_email(users[user_index].email));
-            printf("\n");
+            term_printf("\n");
             printCentered("Email address updated successfully!", LIGHTGREEN);
+            record_store_put('U', user_index);
             save_data();
             break;
         case 4:
-            printf("\n");
+            term_printf("\n");
             setColor(WHITE);
-            printf("%*s", (CONSOLE_WIDTH - 25) / 2, "");
-            printf("Enter new password: ");
+            term_printf("%*s", (CONSOLE_WIDTH - 25) / 2, "");
+            term_printf("Enter new password: ");
             resetColor();
             mask_password(users[user_index].password);
-            printf("\n");
+            term_printf("\n");
             printCentered("Password changed successfully!", LIGHTGREEN);
+            record_store_put('U', user_index);
             save_data();
             break;
         case 5:
             return;
         default:
-            printf("\n");
+            term_printf("\n");
             printCentered("Invalid selection!", LIGHTRED);
     }
 
@@ -1100,28 +2736,26 @@ void update_profile() {
 void add_vehicle() {
     clear_screen();
     print_header();
-    printf("\n");
+    term_printf("\n");
     printCentered("ADD VEHICLE", LIGHTBLUE);
     printCentered("Register a new vehicle to your account", LIGHTCYAN);
-    printf("\n");
+    term_printf("\n");
 
     Vehicle new_vehicle;
-    new_vehicle.vehicle_id = get_next_vehicle_id();
-    new_vehicle.user_id = current_user_id;
 
     printCentered("Select your vehicle type:", WHITE);
-    printf("\n");
+    term_printf("\n");
     printCentered("1. Bike/Motorcycle", LIGHTGREEN);
     printCentered("2. Car/SUV", LIGHTBLUE);
     printCentered("3. Truck/Van", YELLOW);
 
     int type_choice;
-    printf("\n");
+    term_printf("\n");
     setColor(WHITE);
-    printf("%*s", (CONSOLE_WIDTH - 15) / 2, "");
-    printf("Enter choice: ");
+    term_printf("%*s", (CONSOLE_WIDTH - 15) / 2, "");
+    term_printf("Enter choice: ");
     resetColor();
-    scanf("%d", &type_choice);
+    term_scanf("%d", &type_choice);
 
     switch (type_choice) {
         case 1:
@@ -1134,31 +2768,37 @@ void add_vehicle() {
             strcpy(new_vehicle.type, "truck");
             break;
         default:
-            printf("\n");
+            term_printf("\n");
             printCentered("Invalid vehicle type selection!", LIGHTRED);
             pause_screen();
             return;
     }
 
-    printf("\n");
+    term_printf("\n");
     setColor(WHITE);
-    printf("%*s", (CONSOLE_WIDTH - 25) / 2, "");
-    printf("Enter license plate: ");
+    term_printf("%*s", (CONSOLE_WIDTH - 25) / 2, "");
+    term_printf("Enter license plate: ");
     resetColor();
-    scanf("%s", new_vehicle.license_plate);
+    term_scanf("%s", new_vehicle.license_plate);
 
     setColor(WHITE);
-    printf("%*s", (CONSOLE_WIDTH - 25) / 2, "");
-    printf("Enter vehicle color: ");
+    term_printf("%*s", (CONSOLE_WIDTH - 25) / 2, "");
+    term_printf("Enter vehicle color: ");
     resetColor();
-    scanf("%s", new_vehicle.color);
-
-    get_current_time(new_vehicle.reg_date);
-
-    vehicles[vehicle_count] = new_vehicle;
-    vehicle_count++;
+    term_scanf("%s", new_vehicle.color);
+
+    int result = engine_add_vehicle(current_user_id, new_vehicle.type,
+                                    new_vehicle.license_plate, new_vehicle.color);
+    if (result < 0) {
+        term_printf("\n");
+        printCentered("Vehicle registration failed!", LIGHTRED);
+        printCentered(engine_error_text(result), YELLOW);
+        pause_screen();
+        return;
+    }
+    new_vehicle = vehicles[result];
 
-    printf("\n");
+    term_printf("\n");
     printCenteredLine('=', LIGHTGREEN);
     printCentered("VEHICLE REGISTERED SUCCESSFULLY!", LIGHTGREEN);
     printCenteredLine('=', LIGHTGREEN);
@@ -1181,18 +2821,18 @@ void add_vehicle() {
 void view_vehicles() {
     clear_screen();
     print_header();
-    printf("\n");
+    term_printf("\n");
     printCentered("MY REGISTERED VEHICLES", LIGHTGREEN);
     printCentered("Your vehicle fleet overview", LIGHTCYAN);
-    printf("\n");
+    term_printf("\n");
 
     int found = 0;
     setColor(LIGHTCYAN);
-    printf("%*s%-10s %-10s %-15s %-15s %-20s\n",
+    term_printf("%*s%-10s %-10s %-15s %-15s %-20s\n",
            (CONSOLE_WIDTH - 70) / 2, "", "ID", "Type", "License", "Color", "Registered");
-    printf("%*s", (CONSOLE_WIDTH - 70) / 2, "");
-    for (int i = 0; i < 70; i++) printf("=");
-    printf("\n");
+    term_printf("%*s", (CONSOLE_WIDTH - 70) / 2, "");
+    for (int i = 0; i < 70; i++) term_printf("=");
+    term_printf("\n");
     resetColor();
 
     for (int i = 0; i < vehicle_count; i++) {
@@ -1205,7 +2845,7 @@ void view_vehicles() {
             } else {
                 setColor(YELLOW);
             }
-            printf("%*s%-10d %-10s %-15s %-15s %-20s\n",
+            term_printf("%*s%-10d %-10s %-15s %-15s %-20s\n",
                    (CONSOLE_WIDTH - 70) / 2, "",
                    vehicles[i].vehicle_id, vehicles[i].type,
                    vehicles[i].license_plate, vehicles[i].color,
@@ -1216,11 +2856,11 @@ void view_vehicles() {
     resetColor();
 
     if (!found) {
-        printf("\n");
+        term_printf("\n");
         printCentered("No vehicles registered yet!", YELLOW);
         printCentered("Add your first vehicle to start parking!", LIGHTCYAN);
     } else {
-        printf("\n");
+        term_printf("\n");
         char total_msg[50];
         int vehicle_count_user = 0;
         for (int i = 0; i < vehicle_count; i++) {
@@ -1236,14 +2876,14 @@ void view_vehicles() {
 void view_available_slots() {
     clear_screen();
     print_header();
-    printf("\n");
+    term_printf("\n");
     printCentered("AVAILABLE PARKING SLOTS", LIGHTCYAN);
     printCentered("Real-time slot availability", LIGHTGREEN);
-    printf("\n");
+    term_printf("\n");
 
     printCentered("SLOT STATUS LEGEND:", WHITE);
     printCentered("A = Available  O = Occupied  R = Reserved", LIGHTGRAY);
-    printf("\n");
+    term_printf("\n");
 
     print_colored_slots();
 
@@ -1258,7 +2898,7 @@ void view_available_slots() {
         }
     }
 
-    printf("\n");
+    term_printf("\n");
     printCenteredLine('-', YELLOW);
     printCentered("AVAILABILITY SUMMARY", YELLOW);
     printCenteredLine('-', YELLOW);
@@ -1270,96 +2910,96 @@ void view_available_slots() {
     sprintf(summary, "Truck Slots: %d/%d Available", truck_available, TRUCK_SLOTS);
     printCentered(summary, LIGHTGREEN);
 
-    printf("\n");
+    term_printf("\n");
     printCenteredLine('-', LIGHTCYAN);
     printCentered("HOURLY RATES", LIGHTCYAN);
     printCenteredLine('-', LIGHTCYAN);
-    sprintf(summary, "Bike: $%.2f/hour", BIKE_PRICE);
-    printCentered(summary, WHITE);
-    sprintf(summary, "Car: $%.2f/hour", CAR_PRICE);
-    printCentered(summary, WHITE);
-    sprintf(summary, "Truck: $%.2f/hour", TRUCK_PRICE);
-    printCentered(summary, WHITE);
+    static const char *rate_labels[3] = {"Bike", "Car", "Truck"};
+    for (int type = 0; type < 3; type++) {
+        double rate = pricing_quote(type);
+        sprintf(summary, "%s: $%.2f/hour (%d%% full)", rate_labels[type], rate, slot_type_occupancy(type));
+        printCentered(summary, rate > pricing.base[type] ? YELLOW : WHITE);
+    }
 
     pause_screen();
 }
 
 void print_colored_slots() {
-    printf("\n");
+    term_printf("\n");
     printCentered("BIKE/MOTORCYCLE SLOTS (1-40)", YELLOW);
-    printf("\n");
+    term_printf("\n");
 
     for (int i = 0; i < BIKE_SLOTS; i++) {
         if (i % 10 == 0) {
-            printf("%*s", (CONSOLE_WIDTH - 40) / 2, "");
+            term_printf("%*s", (CONSOLE_WIDTH - 40) / 2, "");
         }
 
         if (strcmp(slots[i].status, "available") == 0) {
             setColor(LIGHTGREEN);
-            printf("A%02d ", slots[i].slot_id);
+            term_printf("A%02d ", slots[i].slot_id);
         } else if (strcmp(slots[i].status, "occupied") == 0) {
             setColor(LIGHTRED);
-            printf("O%02d ", slots[i].slot_id);
+            term_printf("O%02d ", slots[i].slot_id);
         } else {
             setColor(LIGHTBLUE);
-            printf("R%02d ", slots[i].slot_id);
+            term_printf("R%02d ", slots[i].slot_id);
         }
 
         if ((i + 1) % 10 == 0) {
             resetColor();
-            printf("\n");
+            term_printf("\n");
         }
     }
 
-    printf("\n");
+    term_printf("\n");
     printCentered("CAR/SUV SLOTS (41-80)", YELLOW);
-    printf("\n");
+    term_printf("\n");
 
     for (int i = BIKE_SLOTS; i < BIKE_SLOTS + CAR_SLOTS; i++) {
         if ((i - BIKE_SLOTS) % 10 == 0) {
-            printf("%*s", (CONSOLE_WIDTH - 40) / 2, "");
+            term_printf("%*s", (CONSOLE_WIDTH - 40) / 2, "");
         }
 
         if (strcmp(slots[i].status, "available") == 0) {
             setColor(LIGHTGREEN);
-            printf("A%02d ", slots[i].slot_id);
+            term_printf("A%02d ", slots[i].slot_id);
         } else if (strcmp(slots[i].status, "occupied") == 0) {
             setColor(LIGHTRED);
-            printf("O%02d ", slots[i].slot_id);
+            term_printf("O%02d ", slots[i].slot_id);
         } else {
             setColor(LIGHTBLUE);
-            printf("R%02d ", slots[i].slot_id);
+            term_printf("R%02d ", slots[i].slot_id);
         }
 
         if ((i - BIKE_SLOTS + 1) % 10 == 0) {
             resetColor();
-            printf("\n");
+            term_printf("\n");
         }
     }
 
-    printf("\n");
+    term_printf("\n");
     printCentered("TRUCK/VAN SLOTS (81-100)", YELLOW);
-    printf("\n");
+    term_printf("\n");
 
     for (int i = BIKE_SLOTS + CAR_SLOTS; i < slot_count; i++) {
         if ((i - BIKE_SLOTS - CAR_SLOTS) % 10 == 0) {
-            printf("%*s", (CONSOLE_WIDTH - 40) / 2, "");
+            term_printf("%*s", (CONSOLE_WIDTH - 40) / 2, "");
         }
 
         if (strcmp(slots[i].status, "available") == 0) {
             setColor(LIGHTGREEN);
-            printf("A%02d ", slots[i].slot_id);
+            term_printf("A%02d ", slots[i].slot_id);
         } else if (strcmp(slots[i].status, "occupied") == 0) {
             setColor(LIGHTRED);
-            printf("O%02d ", slots[i].slot_id);
+            term_printf("O%02d ", slots[i].slot_id);
         } else {
             setColor(LIGHTBLUE);
-            printf("R%02d ", slots[i].slot_id);
+            term_printf("R%02d ", slots[i].slot_id);
         }
 
         if ((i - BIKE_SLOTS - CAR_SLOTS + 1) % 10 == 0) {
             resetColor();
-            printf("\n");
+            term_printf("\n");
         }
     }
     resetColor();
@@ -1378,10 +3018,10 @@ void print_colored_slots() {
 void reserve_slot() {
     clear_screen();
     print_header();
-    printf("\n");
+    term_printf("\n");
     printCentered("RESERVE PARKING SLOT", MAGENTA);
     printCentered("Secure your parking space instantly", LIGHTCYAN);
-    printf("\n");
+    term_printf("\n");
 
     // Show user's vehicles
     printCenteredLine('-', LIGHTCYAN);
@@ -1403,7 +3043,7 @@ void reserve_slot() {
     }
 
     if (vehicle_found == 0) {
-        printf("\n");
+        term_printf("\n");
         printCentered("NO VEHICLES REGISTERED!", YELLOW);
         printCentered("Please add a vehicle first to make reservations.", LIGHTCYAN);
         pause_screen();
@@ -1413,14 +3053,14 @@ void reserve_slot() {
     int vehicle_choice;
     char prompt[100];
     sprintf(prompt, "Select vehicle (1-%d): ", vehicle_found);
-    printf("\n");
+    term_printf("\n");
     setColor(WHITE);
-    printf("%*s%s", (CONSOLE_WIDTH - strlen(prompt)) / 2, "", prompt);
+    term_printf("%*s%s", (CONSOLE_WIDTH - strlen(prompt)) / 2, "", prompt);
     resetColor();
-    scanf("%d", &vehicle_choice);
+    term_scanf("%d", &vehicle_choice);
 
     if (vehicle_choice < 1 || vehicle_choice > vehicle_found) {
-        printf("\n");
+        term_printf("\n");
         printCentered("Invalid vehicle selection!", LIGHTRED);
         pause_screen();
         return;
@@ -1430,7 +3070,7 @@ void reserve_slot() {
     char *vehicle_type = vehicles[selected_vehicle_index].type;
 
     // Show available slots for this vehicle type
-    printf("\n");
+    term_printf("\n");
     printCenteredLine('-', LIGHTGREEN);
     char available_msg[100];
     sprintf(available_msg, "AVAILABLE %s SLOTS",
@@ -1440,28 +3080,28 @@ void reserve_slot() {
     printCenteredLine('-', LIGHTGREEN);
 
     int available_slots[100], available_count = 0;
-    printf("\n");
+    term_printf("\n");
 
     for (int i = 0; i < slot_count; i++) {
         if (strcmp(slots[i].type, vehicle_type) == 0 &&
             strcmp(slots[i].status, "available") == 0) {
             if (available_count % 10 == 0) {
-                printf("%*s", (CONSOLE_WIDTH - 40) / 2, "");
+                term_printf("%*s", (CONSOLE_WIDTH - 40) / 2, "");
             }
             setColor(LIGHTGREEN);
-            printf("%02d ", slots[i].slot_id);
+            term_printf("%02d ", slots[i].slot_id);
             resetColor();
             if ((available_count + 1) % 10 == 0) {
-                printf("\n");
+                term_printf("\n");
             }
             available_slots[available_count] = i;
             available_count++;
         }
     }
-    if (available_count % 10 != 0) printf("\n");
+    if (available_count % 10 != 0) term_printf("\n");
 
     if (available_count == 0) {
-        printf("\n");
+        term_printf("\n");
         char no_slots_msg[100];
         sprintf(no_slots_msg, "NO AVAILABLE %s SLOTS!",
                 strcmp(vehicle_type, "bike") == 0 ? "BIKE" :
@@ -1473,24 +3113,24 @@ void reserve_slot() {
     }
 
     int slot_id;
-    printf("\n");
+    term_printf("\n");
     setColor(WHITE);
-    printf("%*s", (CONSOLE_WIDTH - 35) / 2, "");
-    printf("Enter slot number to reserve: ");
+    term_printf("%*s", (CONSOLE_WIDTH - 45) / 2, "");
+    term_printf("Enter slot number to reserve (0 = nearest): ");
     resetColor();
-    scanf("%d", &slot_id);
+    term_scanf("%d", &slot_id);
 
-    // Find and reserve the slot
+    // Find and reserve the slot; 0 leaves the choice to the engine
     int slot_index = -1;
-    for (int i = 0; i < available_count; i++) {
+    for (int i = 0; i < available_count && slot_id != 0; i++) {
         if (slots[available_slots[i]].slot_id == slot_id) {
             slot_index = available_slots[i];
             break;
         }
     }
 
-    if (slot_index == -1) {
-        printf("\n");
+    if (slot_index == -1 && slot_id != 0) {
+        term_printf("\n");
         printCentered("Invalid slot number or slot not available!", LIGHTRED);
         printCentered("Please select from the available slots shown above.", YELLOW);
         pause_screen();
@@ -1499,49 +3139,33 @@ void reserve_slot() {
 
     double duration;
     setColor(WHITE);
-    printf("%*s", (CONSOLE_WIDTH - 35) / 2, "");
-    printf("Enter parking duration (hours): ");
+    term_printf("%*s", (CONSOLE_WIDTH - 35) / 2, "");
+    term_printf("Enter parking duration (hours): ");
     resetColor();
-    scanf("%lf", &duration);
+    term_scanf("%lf", &duration);
 
     if (duration <= 0 || duration > 24) {
-        printf("\n");
+        term_printf("\n");
         printCentered("Invalid duration! Please enter 1-24 hours.", LIGHTRED);
         pause_screen();
         return;
     }
 
-    // Create reservation
-    Reservation new_reservation;
-    new_reservation.reservation_id = get_next_reservation_id();
-    new_reservation.user_id = current_user_id;
-    new_reservation.slot_id = slot_id;
-    new_reservation.vehicle_id = vehicles[selected_vehicle_index].vehicle_id;
-    new_reservation.duration_hours = duration;
-
-    get_current_time(new_reservation.start_time);
-    strcpy(new_reservation.end_time, "");
-    strcpy(new_reservation.status, "active");
-
-    // Calculate amount
-    double rate;
-    if (strcmp(vehicle_type, "bike") == 0) rate = BIKE_PRICE;
-    else if (strcmp(vehicle_type, "car") == 0) rate = CAR_PRICE;
-    else rate = TRUCK_PRICE;
-
-    new_reservation.total_amount = duration * rate;
-
-    // Update slot status
-    strcpy(slots[slot_index].status, "reserved");
-    slots[slot_index].vehicle_id = vehicles[selected_vehicle_index].vehicle_id;
-    slots[slot_index].user_id = current_user_id;
-    strcpy(slots[slot_index].reserved_time, new_reservation.start_time);
-
-    // Add reservation
-    reservations[reservation_count] = new_reservation;
-    reservation_count++;
+    // Create reservation and mark the slot reserved
+    int vehicle_id = vehicles[selected_vehicle_index].vehicle_id;
+    int result = slot_id == 0 ? engine_reserve_nearest(current_user_id, vehicle_id, LEVEL_ANY, duration)
+                              : engine_reserve(current_user_id, vehicle_id, slot_id, duration);
+    if (result < 0) {
+        term_printf("\n");
+        printCentered("Reservation failed!", LIGHTRED);
+        printCentered(engine_error_text(result), YELLOW);
+        pause_screen();
+        return;
+    }
+    Reservation new_reservation = reservations[result];
+    double rate = new_reservation.total_amount / new_reservation.duration_hours; // as quoted at booking
 
-    printf("\n");
+    term_printf("\n");
     printCenteredLine('=', LIGHTGREEN);
     printCentered("RESERVATION CONFIRMED!", LIGHTGREEN);
     printCenteredLine('=', LIGHTGREEN);
@@ -1549,7 +3173,10 @@ void reserve_slot() {
     char res_details[200];
     sprintf(res_details, "Reservation ID: %d", new_reservation.reservation_id);
     printCentered(res_details, LIGHTCYAN);
-    sprintf(res_details, "Slot Number: %d (%s)", slot_id, vehicle_type);
+    char location[64];
+    sprintf(res_details, "Slot Number: %d (%s)", new_reservation.slot_id, vehicle_type);
+    printCentered(res_details, WHITE);
+    sprintf(res_details, "Location: %s", slot_location(find_slot_index(new_reservation.slot_id), location));
     printCentered(res_details, WHITE);
     sprintf(res_details, "Vehicle: %s (%s)",
             vehicles[selected_vehicle_index].license_plate,
@@ -1561,11 +3188,16 @@ void reserve_slot() {
     printCentered(res_details, WHITE);
     sprintf(res_details, "Total Amount: $%.2f", new_reservation.total_amount);
     printCentered(res_details, YELLOW);
-    sprintf(res_details, "Reserved Time: %s", new_reservation.start_time);
+    char when[TIME_TEXT_SIZE];
+    sprintf(res_details, "Reserved Time: %s", format_time(new_reservation.start_time, when));
     printCentered(res_details, LIGHTGRAY);
 
-    printf("\n");
+    term_printf("\n");
     printCentered("NEXT STEP: Please proceed to payment to secure your slot!", LIGHTCYAN);
+    if (hold_ttl_seconds > 0) {
+        sprintf(res_details, "Unpaid reservations are released after %d minutes.", hold_ttl_seconds / 60);
+        printCentered(res_details, YELLOW);
+    }
 
     // Save data immediately after reservation
     save_data();
@@ -1575,10 +3207,10 @@ void reserve_slot() {
 void cancel_reservation() {
     clear_screen();
     print_header();
-    printf("\n");
+    term_printf("\n");
     printCentered("CANCEL RESERVATION", LIGHTRED);
     printCentered("Cancel your active parking reservations", LIGHTCYAN);
-    printf("\n");
+    term_printf("\n");
 
     // Show user's active reservations
     printCenteredLine('-', LIGHTCYAN);
@@ -1590,11 +3222,11 @@ void cancel_reservation() {
     for (int i = 0; i < reservation_count; i++) {
         if (reservations[i].user_id == current_user_id &&
             strcmp(reservations[i].status, "active") == 0) {
-            char res_info[200];
+            char res_info[200], when[TIME_TEXT_SIZE];
             sprintf(res_info, "%d. Reservation ID: %d - Slot %d - $%.2f (%.1fh) - %s",
                    reservation_found + 1, reservations[i].reservation_id,
                    reservations[i].slot_id, reservations[i].total_amount,
-                   reservations[i].duration_hours, reservations[i].start_time);
+                   reservations[i].duration_hours, format_time(reservations[i].start_time, when));
             printCentered(res_info, LIGHTCYAN);
             user_reservations[reservation_found] = i;
             reservation_found++;
@@ -1602,7 +3234,7 @@ void cancel_reservation() {
     }
 
     if (reservation_found == 0) {
-        printf("\n");
+        term_printf("\n");
         printCentered("NO ACTIVE RESERVATIONS FOUND!", YELLOW);
         printCentered("You don't have any reservations to cancel.", LIGHTCYAN);
         pause_screen();
@@ -1612,14 +3244,14 @@ void cancel_reservation() {
     int choice;
     char cancel_prompt[100];
     sprintf(cancel_prompt, "Select reservation to cancel (1-%d): ", reservation_found);
-    printf("\n");
+    term_printf("\n");
     setColor(WHITE);
-    printf("%*s%s", (CONSOLE_WIDTH - strlen(cancel_prompt)) / 2, "", cancel_prompt);
+    term_printf("%*s%s", (CONSOLE_WIDTH - strlen(cancel_prompt)) / 2, "", cancel_prompt);
     resetColor();
-    scanf("%d", &choice);
+    term_scanf("%d", &choice);
 
     if (choice < 1 || choice > reservation_found) {
-        printf("\n");
+        term_printf("\n");
         printCentered("Invalid selection!", LIGHTRED);
         pause_screen();
         return;
@@ -1628,7 +3260,7 @@ void cancel_reservation() {
     int reservation_index = user_reservations[choice - 1];
 
     // Confirmation
-    printf("\n");
+    term_printf("\n");
     printCenteredLine('-', YELLOW);
     printCentered("CANCELLATION CONFIRMATION", YELLOW);
     printCenteredLine('-', YELLOW);
@@ -1641,30 +3273,18 @@ void cancel_reservation() {
     printCentered(confirm_info, WHITE);
 
     char confirm;
-    printf("\n");
+    term_printf("\n");
     setColor(YELLOW);
-    printf("%*s", (CONSOLE_WIDTH - 35) / 2, "");
-    printf("Confirm cancellation? (y/n): ");
+    term_printf("%*s", (CONSOLE_WIDTH - 35) / 2, "");
+    term_printf("Confirm cancellation? (y/n): ");
     resetColor();
-    scanf(" %c", &confirm);
+    term_scanf(" %c", &confirm);
 
     if (confirm == 'y' || confirm == 'Y') {
-        // Update reservation status
-        strcpy(reservations[reservation_index].status, "cancelled");
-        get_current_time(reservations[reservation_index].end_time);
-
-        // Free up the slot
-        for (int i = 0; i < slot_count; i++) {
-            if (slots[i].slot_id == reservations[reservation_index].slot_id) {
-                strcpy(slots[i].status, "available");
-                slots[i].vehicle_id = 0;
-                slots[i].user_id = 0;
-                strcpy(slots[i].reserved_time, "");
-                break;
-            }
-        }
+        // Update reservation status and free up the slot
+        engine_cancel(current_user_id, reservations[reservation_index].reservation_id);
 
-        printf("\n");
+        term_printf("\n");
         printCenteredLine('=', LIGHTGREEN);
         printCentered("RESERVATION CANCELLED SUCCESSFULLY!", LIGHTGREEN);
         printCenteredLine('=', LIGHTGREEN);
@@ -1673,7 +3293,7 @@ void cancel_reservation() {
         // Save data immediately after cancellation
         save_data();
     } else {
-        printf("\n");
+        term_printf("\n");
         printCentered("Cancellation aborted. Your reservation remains active.", LIGHTCYAN);
     }
 
@@ -1684,10 +3304,10 @@ void cancel_reservation() {
 void make_payment() {
     clear_screen();
     print_header();
-    printf("\n");
+    term_printf("\n");
     printCentered("MAKE PAYMENT", YELLOW);
     printCentered("Complete your parking payment", LIGHTCYAN);
-    printf("\n");
+    term_printf("\n");
 
     // Show unpaid reservations
     printCenteredLine('-', LIGHTCYAN);
@@ -1700,16 +3320,7 @@ void make_payment() {
         if (reservations[i].user_id == current_user_id &&
             strcmp(reservations[i].status, "active") == 0) {
             // Check if payment already made
-            int payment_made = 0;
-            for (int j = 0; j < payment_count; j++) {
-                if (payments[j].reservation_id == reservations[i].reservation_id &&
-                    strcmp(payments[j].status, "completed") == 0) {
-                    payment_made = 1;
-                    break;
-                }
-            }
-
-            if (!payment_made) {
+            if (!reservation_is_paid(reservations[i].reservation_id)) {
                 char unpaid_info[200];
                 sprintf(unpaid_info, "%d. Reservation ID: %d - Slot %d - $%.2f (%.1fh)",
                        unpaid_count + 1, reservations[i].reservation_id,
@@ -1723,7 +3334,7 @@ void make_payment() {
     }
 
     if (unpaid_count == 0) {
-        printf("\n");
+        term_printf("\n");
         printCentered("NO PENDING PAYMENTS!", LIGHTGREEN);
         printCentered("All your reservations are fully paid.", LIGHTCYAN);
         pause_screen();
@@ -1733,14 +3344,14 @@ void make_payment() {
     int choice;
     char payment_prompt[100];
     sprintf(payment_prompt, "Select reservation to pay (1-%d): ", unpaid_count);
-    printf("\n");
+    term_printf("\n");
     setColor(WHITE);
-    printf("%*s%s", (CONSOLE_WIDTH - strlen(payment_prompt)) / 2, "", payment_prompt);
+    term_printf("%*s%s", (CONSOLE_WIDTH - strlen(payment_prompt)) / 2, "", payment_prompt);
     resetColor();
-    scanf("%d", &choice);
+    term_scanf("%d", &choice);
 
     if (choice < 1 || choice > unpaid_count) {
-        printf("\n");
+        term_printf("\n");
         printCentered("Invalid selection!", LIGHTRED);
         pause_screen();
         return;
@@ -1748,7 +3359,7 @@ void make_payment() {
 
     int reservation_index = unpaid_reservations[choice - 1];
 
-    printf("\n");
+    term_printf("\n");
     printCenteredLine('-', YELLOW);
     printCentered("PAYMENT METHODS", YELLOW);
     printCenteredLine('-', YELLOW);
@@ -1758,12 +3369,12 @@ void make_payment() {
     printCentered("4. Nagad Mobile Payment", CYAN);
 
     int method_choice;
-    printf("\n");
+    term_printf("\n");
     setColor(WHITE);
-    printf("%*s", (CONSOLE_WIDTH - 25) / 2, "");
-    printf("Select payment method: ");
+    term_printf("%*s", (CONSOLE_WIDTH - 25) / 2, "");
+    term_printf("Select payment method: ");
     resetColor();
-    scanf("%d", &method_choice);
+    term_scanf("%d", &method_choice);
 
     char payment_method[20];
     char method_display[30];
@@ -1785,14 +3396,14 @@ void make_payment() {
             strcpy(method_display, "Nagad Mobile Payment");
             break;
         default:
-            printf("\n");
+            term_printf("\n");
             printCentered("Invalid payment method!", LIGHTRED);
             pause_screen();
             return;
     }
 
     // Payment confirmation
-    printf("\n");
+    term_printf("\n");
     printCenteredLine('-', YELLOW);
     printCentered("PAYMENT CONFIRMATION", YELLOW);
     printCenteredLine('-', YELLOW);
@@ -1805,42 +3416,33 @@ void make_payment() {
     printCentered(payment_info, WHITE);
 
     char confirm;
-    printf("\n");
+    term_printf("\n");
     setColor(YELLOW);
-    printf("%*s", (CONSOLE_WIDTH - 35) / 2, "");
-    printf("Confirm payment? (y/n): ");
+    term_printf("%*s", (CONSOLE_WIDTH - 35) / 2, "");
+    term_printf("Confirm payment? (y/n): ");
     resetColor();
-    scanf(" %c", &confirm);
+    term_scanf(" %c", &confirm);
 
     if (confirm != 'y' && confirm != 'Y') {
-        printf("\n");
+        term_printf("\n");
         printCentered("Payment cancelled.", LIGHTCYAN);
         pause_screen();
         return;
     }
 
-    // Create payment record
-    Payment new_payment;
-    new_payment.payment_id = get_next_payment_id();
-    new_payment.user_id = current_user_id;
-    new_payment.reservation_id = reservations[reservation_index].reservation_id;
-    new_payment.amount = reservations[reservation_index].total_amount;
-    strcpy(new_payment.method, payment_method);
-    strcpy(new_payment.status, "completed");
-    get_current_time(new_payment.payment_date);
-
-    payments[payment_count] = new_payment;
-    payment_count++;
-
-    // Update slot to occupied
-    for (int i = 0; i < slot_count; i++) {
-        if (slots[i].slot_id == reservations[reservation_index].slot_id) {
-            strcpy(slots[i].status, "occupied");
-            break;
-        }
+    // Create payment record and mark the slot occupied
+    int result = engine_pay(current_user_id, reservations[reservation_index].reservation_id,
+                            payment_method);
+    if (result < 0) {
+        term_printf("\n");
+        printCentered("Payment failed!", LIGHTRED);
+        printCentered(engine_error_text(result), YELLOW);
+        pause_screen();
+        return;
     }
+    Payment new_payment = payments[result];
 
-    printf("\n");
+    term_printf("\n");
     printCenteredLine('=', LIGHTGREEN);
     printCentered("PAYMENT SUCCESSFUL!", LIGHTGREEN);
     printCenteredLine('=', LIGHTGREEN);
@@ -1852,10 +3454,11 @@ void make_payment() {
     printCentered(success_details, WHITE);
     sprintf(success_details, "Payment Method: %s", method_display);
     printCentered(success_details, WHITE);
-    sprintf(success_details, "Transaction Date: %s", new_payment.payment_date);
+    char when[TIME_TEXT_SIZE];
+    sprintf(success_details, "Transaction Date: %s", format_time(new_payment.payment_date, when));
     printCentered(success_details, LIGHTGRAY);
 
-    printf("\n");
+    term_printf("\n");
     printCentered("Your parking slot is now ACTIVE and ready to use!", LIGHTCYAN);
     printCentered("Thank you for choosing SMART PARK!", YELLOW);
 
@@ -1868,21 +3471,21 @@ void make_payment() {
 void view_payment_history() {
     clear_screen();
     print_header();
-    printf("\n");
+    term_printf("\n");
     printCentered("PAYMENT HISTORY", LIGHTCYAN);
     printCentered("Your complete transaction history", LIGHTGREEN);
-    printf("\n");
+    term_printf("\n");
 
     int found = 0;
     double total_paid = 0;
 
     setColor(LIGHTCYAN);
-    printf("%*s%-8s %-12s %-10s %-15s %-20s %-12s\n",
+    term_printf("%*s%-8s %-12s %-10s %-15s %-20s %-12s\n",
            (CONSOLE_WIDTH - 77) / 2, "",
            "Pay ID", "Reservation", "Amount", "Method", "Date", "Status");
-    printf("%*s", (CONSOLE_WIDTH - 77) / 2, "");
-    for (int i = 0; i < 77; i++) printf("=");
-    printf("\n");
+    term_printf("%*s", (CONSOLE_WIDTH - 77) / 2, "");
+    for (int i = 0; i < 77; i++) term_printf("=");
+    term_printf("\n");
     resetColor();
 
     for (int i = 0; i < payment_count; i++) {
@@ -1893,7 +3496,7 @@ void view_payment_history() {
             } else {
                 setColor(YELLOW);
             }
-            printf("%*s%-8d %-12d $%-9.2f %-15s %-20s %-12s\n",
+            term_printf("%*s%-8d %-12d $%-9.2f %-15s %-20s %-12s\n",
                    (CONSOLE_WIDTH - 77) / 2, "",
                    payments[i].payment_id, payments[i].reservation_id,
                    payments[i].amount, payments[i].method,
@@ -1904,11 +3507,11 @@ void view_payment_history() {
     resetColor();
 
     if (!found) {
-        printf("\n");
+        term_printf("\n");
         printCentered("NO PAYMENT HISTORY FOUND!", YELLOW);
         printCentered("Make your first reservation to start using SMART PARK!", LIGHTCYAN);
     } else {
-        printf("\n");
+        term_printf("\n");
         printCenteredLine('-', LIGHTCYAN);
         char total_info[100];
         sprintf(total_info, "Total Amount Paid: $%.2f", total_paid);
@@ -1931,21 +3534,21 @@ void view_payment_history() {
 void view_booking_history() {
     clear_screen();
     print_header();
-    printf("\n");
+    term_printf("\n");
     printCentered("BOOKING HISTORY", WHITE);
     printCentered("Complete record of all your reservations", LIGHTGREEN);
-    printf("\n");
+    term_printf("\n");
 
     int found = 0;
     int active_count = 0, completed_count = 0, cancelled_count = 0;
 
     setColor(LIGHTCYAN);
-    printf("%*s%-8s %-6s %-8s %-18s %-18s %-10s %-8s\n",
+    term_printf("%*s%-8s %-6s %-8s %-18s %-18s %-10s %-8s\n",
            (CONSOLE_WIDTH - 80) / 2, "",
            "Res ID", "Slot", "Vehicle", "Start Time", "End Time", "Status", "Amount");
-    printf("%*s", (CONSOLE_WIDTH - 80) / 2, "");
-    for (int i = 0; i < 80; i++) printf("=");
-    printf("\n");
+    term_printf("%*s", (CONSOLE_WIDTH - 80) / 2, "");
+    for (int i = 0; i < 80; i++) term_printf("=");
+    term_printf("\n");
     resetColor();
 
     for (int i = 0; i < reservation_count; i++) {
@@ -1961,17 +3564,18 @@ void view_booking_history() {
                 cancelled_count++;
             }
 
-            char end_time_display[20];
-            if (strlen(reservations[i].end_time) == 0) {
+            char start_time_display[TIME_TEXT_SIZE], end_time_display[TIME_TEXT_SIZE];
+            format_time(reservations[i].start_time, start_time_display);
+            if (reservations[i].end_time == 0) {
                 strcpy(end_time_display, "Ongoing");
             } else {
-                strcpy(end_time_display, reservations[i].end_time);
+                format_time(reservations[i].end_time, end_time_display);
             }
 
-            printf("%*s%-8d %-6d %-8d %-18s %-18s %-10s $%-7.2f\n",
+            term_printf("%*s%-8d %-6d %-8d %-18s %-18s %-10s $%-7.2f\n",
                    (CONSOLE_WIDTH - 80) / 2, "",
                    reservations[i].reservation_id, reservations[i].slot_id,
-                   reservations[i].vehicle_id, reservations[i].start_time,
+                   reservations[i].vehicle_id, start_time_display,
                    end_time_display, reservations[i].status,
                    reservations[i].total_amount);
             found = 1;
@@ -1980,11 +3584,11 @@ void view_booking_history() {
     resetColor();
 
     if (!found) {
-        printf("\n");
+        term_printf("\n");
         printCentered("NO BOOKING HISTORY FOUND!", YELLOW);
         printCentered("Start your parking journey by making your first reservation!", LIGHTCYAN);
     } else {
-        printf("\n");
+        term_printf("\n");
         printCenteredLine('-', LIGHTCYAN);
         printCentered("BOOKING SUMMARY", LIGHTCYAN);
         printCenteredLine('-', LIGHTCYAN);
@@ -2003,23 +3607,25 @@ void view_booking_history() {
 void check_overstay() {
     clear_screen();
     print_header();
-    printf("\n");
+    term_printf("\n");
     printCentered("OVERSTAY ALERTS", LIGHTRED);
     if (is_admin) {
         printCentered("System-wide overstay monitoring", LIGHTCYAN);
     } else {
         printCentered("Your parking duration alerts", LIGHTCYAN);
     }
-    printf("\n");
+    term_printf("\n");
 
     int alerts_found = 0;
+    time_t now = (time_t)now_epoch();
 
-    for (int i = 0; i < reservation_count; i++) {
-        if ((is_admin || reservations[i].user_id == current_user_id) &&
-            strcmp(reservations[i].status, "active") == 0) {
-
-            // Simplified overstay detection - assume 2.5 hours passed
-            double hours_passed = 2.5;
+    // Only reservations whose timer has fired are looked at
+    timers_advance(now);
+    for (int k = 0; k < overstay_count; k++) {
+        int i = overstay_list[k];
+        if (is_admin || reservations[i].user_id == current_user_id) {
+            long long start = reservations[i].start_time;
+            double hours_passed = start > 0 ? (now - start) / 3600.0 : reservations[i].duration_hours;
 
             if (hours_passed > reservations[i].duration_hours) {
                 double overstay_hours = hours_passed - reservations[i].duration_hours;
@@ -2040,35 +3646,27 @@ void check_overstay() {
                 sprintf(alert_info, "Overstay Time: %.1f hours", overstay_hours);
                 printCentered(alert_info, LIGHTRED);
 
-                // Calculate additional charges
-                double base_rate;
-                for (int j = 0; j < slot_count; j++) {
-                    if (slots[j].slot_id == reservations[i].slot_id) {
-                        if (strcmp(slots[j].type, "bike") == 0) base_rate = BIKE_PRICE;
-                        else if (strcmp(slots[j].type, "car") == 0) base_rate = CAR_PRICE;
-                        else base_rate = TRUCK_PRICE;
-                        break;
-                    }
-                }
-                double additional_charge = overstay_hours * base_rate * 1.5; // 1.5x penalty
+                // Overstay hours are charged at the tariff for those hours, continuing
+                // the stay's tiers, with a 1.5x penalty
+                int slot_index = find_slot_index(reservations[i].slot_id);
+                int type = slot_index != -1 ? slot_type_code(slots[slot_index].type) : 0;
+                if (start == -1) start = now;
+                double additional_charge = 1.5 * (pricing_stay_cost(type, start, hours_passed) -
+                                                  pricing_stay_cost(type, start, reservations[i].duration_hours));
                 sprintf(alert_info, "Additional Penalty: $%.2f (1.5x rate)", additional_charge);
                 printCentered(alert_info, YELLOW);
 
-                if (is_admin) {
-                    for (int j = 0; j < user_count; j++) {
-                        if (users[j].user_id == reservations[i].user_id) {
-                            sprintf(alert_info, "Customer: %s", users[j].name);
-                            printCentered(alert_info, LIGHTCYAN);
-                            sprintf(alert_info, "Contact: %s", users[j].phone);
-                            printCentered(alert_info, LIGHTCYAN);
-                            break;
-                        }
-                    }
+                int user_index = find_user_index(reservations[i].user_id);
+                if (is_admin && user_index != -1) {
+                    sprintf(alert_info, "Customer: %s", users[user_index].name);
+                    printCentered(alert_info, LIGHTCYAN);
+                    sprintf(alert_info, "Contact: %s", users[user_index].phone);
+                    printCentered(alert_info, LIGHTCYAN);
                 }
 
-                printf("\n");
+                term_printf("\n");
                 printCenteredLine('-', LIGHTCYAN);
-                printf("\n");
+                term_printf("\n");
                 alerts_found = 1;
             }
         }
@@ -2091,43 +3689,20 @@ void check_overstay() {
 void generate_user_report() {
     clear_screen();
     print_header();
-    printf("\n");
+    term_printf("\n");
     printCentered("MY SMART PARK REPORT", LIGHTGREEN);
     printCentered("Your complete parking statistics", LIGHTCYAN);
-    printf("\n");
-
-    int total_bookings = 0, active_bookings = 0, cancelled_bookings = 0, completed_bookings = 0;
-    double total_spent = 0.0;
-    int vehicle_count_user = 0;
-
-    // Count user's bookings
-    for (int i = 0; i < reservation_count; i++) {
-        if (reservations[i].user_id == current_user_id) {
-            total_bookings++;
-            if (strcmp(reservations[i].status, "active") == 0) {
-                active_bookings++;
-            } else if (strcmp(reservations[i].status, "cancelled") == 0) {
-                cancelled_bookings++;
-            } else if (strcmp(reservations[i].status, "completed") == 0) {
-                completed_bookings++;
-            }
-        }
-    }
+    term_printf("\n");
 
-    // Count user's spending
-    for (int i = 0; i < payment_count; i++) {
-        if (payments[i].user_id == current_user_id &&
-            strcmp(payments[i].status, "completed") == 0) {
-            total_spent += payments[i].amount;
-        }
-    }
+    ReportTotals totals;
+    compute_report_totals(current_user_id, &totals);
 
-    // Count user's vehicles
-    for (int i = 0; i < vehicle_count; i++) {
-        if (vehicles[i].user_id == current_user_id) {
-            vehicle_count_user++;
-        }
-    }
+    int total_bookings = totals.total_reservations;
+    int active_bookings = totals.active_reservations;
+    int cancelled_bookings = totals.cancelled_reservations;
+    int completed_bookings = totals.completed_reservations;
+    double total_spent = totals.total_revenue;
+    int vehicle_count_user = totals.total_vehicles;
 
     printCenteredLine('=', YELLOW);
     printCentered("YOUR PARKING STATISTICS", YELLOW);
@@ -2149,7 +3724,7 @@ void generate_user_report() {
     sprintf(stats, "Registered Vehicles: %d", vehicle_count_user);
     printCentered(stats, LIGHTCYAN);
 
-    printf("\n");
+    term_printf("\n");
     printCenteredLine('-', LIGHTCYAN);
     printCentered("FINANCIAL SUMMARY", LIGHTCYAN);
     printCenteredLine('-', LIGHTCYAN);
@@ -2162,7 +3737,7 @@ void generate_user_report() {
     printCentered(stats, YELLOW);
 
     // Calculate loyalty status
-    printf("\n");
+    term_printf("\n");
     printCenteredLine('-', MAGENTA);
     if (total_spent >= 500) {
         printCentered("LOYALTY STATUS: PLATINUM MEMBER", YELLOW);
@@ -2192,10 +3767,10 @@ void generate_user_report() {
 void admin_view_users() {
     clear_screen();
     print_header();
-    printf("\n");
+    term_printf("\n");
     printCentered("USER MANAGEMENT DASHBOARD", LIGHTBLUE);
     printCentered("Complete overview of all registered customers", LIGHTCYAN);
-    printf("\n");
+    term_printf("\n");
 
     if (user_count == 0) {
         printCenteredLine('!', YELLOW);
@@ -2207,12 +3782,12 @@ void admin_view_users() {
     }
 
     setColor(LIGHTCYAN);
-    printf("%*s%-8s %-18s %-13s %-25s %-18s %-8s\n",
+    term_printf("%*s%-8s %-18s %-13s %-25s %-18s %-8s\n",
            (CONSOLE_WIDTH - 90) / 2, "",
            "ID", "Name", "Phone", "Email", "Reg Date", "Status");
-    printf("%*s", (CONSOLE_WIDTH - 90) / 2, "");
-    for (int i = 0; i < 90; i++) printf("=");
-    printf("\n");
+    term_printf("%*s", (CONSOLE_WIDTH - 90) / 2, "");
+    for (int i = 0; i < 90; i++) term_printf("=");
+    term_printf("\n");
     resetColor();
 
     for (int i = 0; i < user_count; i++) {
@@ -2221,7 +3796,7 @@ void admin_view_users() {
         } else {
             setColor(LIGHTRED);
         }
-        printf("%*s%-8d %-18s %-13s %-25s %-18s %-8s\n",
+        term_printf("%*s%-8d %-18s %-13s %-25s %-18s %-8s\n",
                (CONSOLE_WIDTH - 90) / 2, "",
                users[i].user_id, users[i].name, users[i].phone,
                users[i].email, users[i].reg_date,
@@ -2234,7 +3809,7 @@ void admin_view_users() {
         if (users[i].is_active) active_count++;
     }
 
-    printf("\n");
+    term_printf("\n");
     printCenteredLine('-', LIGHTCYAN);
     printCentered("USER STATISTICS", LIGHTCYAN);
     printCenteredLine('-', LIGHTCYAN);
@@ -2254,10 +3829,10 @@ void admin_view_users() {
 void admin_search_users() {
     clear_screen();
     print_header();
-    printf("\n");
+    term_printf("\n");
     printCentered("ADVANCED USER SEARCH", LIGHTGREEN);
     printCentered("Find customers by various criteria", LIGHTCYAN);
-    printf("\n");
+    term_printf("\n");
 
     printCenteredLine('-', WHITE);
     printCentered("SEARCH OPTIONS", WHITE);
@@ -2268,44 +3843,44 @@ void admin_search_users() {
     printCentered("4. Search by User ID", LIGHTGREEN);
 
     int choice;
-    printf("\n");
+    term_printf("\n");
     setColor(WHITE);
-    printf("%*s", (CONSOLE_WIDTH - 15) / 2, "");
-    printf("Enter choice: ");
+    term_printf("%*s", (CONSOLE_WIDTH - 15) / 2, "");
+    term_printf("Enter choice: ");
     resetColor();
-    scanf("%d", &choice);
+    term_scanf("%d", &choice);
 
     char search_term[MAX_STRING];
     int search_id = 0;
 
-    printf("\n");
+    term_printf("\n");
     if (choice == 4) {
         setColor(WHITE);
-        printf("%*s", (CONSOLE_WIDTH - 18) / 2, "");
-        printf("Enter User ID: ");
+        term_printf("%*s", (CONSOLE_WIDTH - 18) / 2, "");
+        term_printf("Enter User ID: ");
         resetColor();
-        scanf("%d", &search_id);
+        term_scanf("%d", &search_id);
     } else {
         setColor(WHITE);
-        printf("%*s", (CONSOLE_WIDTH - 20) / 2, "");
-        printf("Enter search term: ");
+        term_printf("%*s", (CONSOLE_WIDTH - 20) / 2, "");
+        term_printf("Enter search term: ");
         resetColor();
-        scanf("%s", search_term);
+        term_scanf("%s", search_term);
     }
 
     int found = 0;
-    printf("\n");
+    term_printf("\n");
     printCenteredLine('-', LIGHTCYAN);
     printCentered("SEARCH RESULTS", LIGHTCYAN);
     printCenteredLine('-', LIGHTCYAN);
 
     setColor(LIGHTCYAN);
-    printf("%*s%-8s %-18s %-13s %-25s %-18s %-8s\n",
+    term_printf("%*s%-8s %-18s %-13s %-25s %-18s %-8s\n",
            (CONSOLE_WIDTH - 90) / 2, "",
            "ID", "Name", "Phone", "Email", "Reg Date", "Status");
-    printf("%*s", (CONSOLE_WIDTH - 90) / 2, "");
-    for (int i = 0; i < 90; i++) printf("=");
-    printf("\n");
+    term_printf("%*s", (CONSOLE_WIDTH - 90) / 2, "");
+    for (int i = 0; i < 90; i++) term_printf("=");
+    term_printf("\n");
     resetColor();
 
     for (int i = 0; i < user_count; i++) {
@@ -2332,7 +3907,7 @@ void admin_search_users() {
             } else {
                 setColor(LIGHTRED);
             }
-            printf("%*s%-8d %-18s %-13s %-25s %-18s %-8s\n",
+            term_printf("%*s%-8d %-18s %-13s %-25s %-18s %-8s\n",
                    (CONSOLE_WIDTH - 90) / 2, "",
                    users[i].user_id, users[i].name, users[i].phone,
                    users[i].email, users[i].reg_date,
@@ -2343,11 +3918,11 @@ void admin_search_users() {
     resetColor();
 
     if (!found) {
-        printf("\n");
+        term_printf("\n");
         printCentered("NO MATCHING USERS FOUND!", YELLOW);
         printCentered("Try different search criteria or check spelling.", LIGHTCYAN);
     } else {
-        printf("\n");
+        term_printf("\n");
         printCentered("Search completed successfully.", LIGHTGREEN);
     }
 
@@ -2357,17 +3932,17 @@ void admin_search_users() {
 void admin_delete_user() {
     clear_screen();
     print_header();
-    printf("\n");
+    term_printf("\n");
     printCentered("USER DEACTIVATION PORTAL", LIGHTRED);
     printCentered("Safely deactivate customer accounts", YELLOW);
-    printf("\n");
+    term_printf("\n");
 
     int user_id;
     setColor(WHITE);
-    printf("%*s", (CONSOLE_WIDTH - 35) / 2, "");
-    printf("Enter User ID to deactivate: ");
+    term_printf("%*s", (CONSOLE_WIDTH - 35) / 2, "");
+    term_printf("Enter User ID to deactivate: ");
     resetColor();
-    scanf("%d", &user_id);
+    term_scanf("%d", &user_id);
 
     int user_index = -1;
     for (int i = 0; i < user_count; i++) {
@@ -2378,14 +3953,14 @@ void admin_delete_user() {
     }
 
     if (user_index == -1) {
-        printf("\n");
+        term_printf("\n");
         printCentered("USER NOT FOUND!", LIGHTRED);
         printCentered("Please verify the User ID and try again.", YELLOW);
         pause_screen();
         return;
     }
 
-    printf("\n");
+    term_printf("\n");
     printCenteredLine('-', LIGHTCYAN);
     printCentered("USER ACCOUNT DETAILS", LIGHTCYAN);
     printCenteredLine('-', LIGHTCYAN);
@@ -2398,7 +3973,8 @@ void admin_delete_user() {
     printCentered(details, WHITE);
     sprintf(details, "Email Address: %s", users[user_index].email);
     printCentered(details, WHITE);
-    sprintf(details, "Registration Date: %s", users[user_index].reg_date);
+    char when[TIME_TEXT_SIZE];
+    sprintf(details, "Registration Date: %s", format_time(users[user_index].reg_date, when));
     printCentered(details, LIGHTGRAY);
     sprintf(details, "Current Status: %s", users[user_index].is_active ? "ACTIVE" : "INACTIVE");
     if (users[user_index].is_active) {
@@ -2408,7 +3984,7 @@ void admin_delete_user() {
     }
 
     if (!users[user_index].is_active) {
-        printf("\n");
+        term_printf("\n");
         printCentered("This user is already deactivated!", YELLOW);
         pause_screen();
         return;
@@ -2424,7 +4000,7 @@ void admin_delete_user() {
     }
 
     if (active_reservations > 0) {
-        printf("\n");
+        term_printf("\n");
         printCenteredLine('!', YELLOW);
         char warning[100];
         sprintf(warning, "WARNING: User has %d active reservation(s)!", active_reservations);
@@ -2434,37 +4010,27 @@ void admin_delete_user() {
     }
 
     char confirm;
-    printf("\n");
+    term_printf("\n");
     setColor(YELLOW);
-    printf("%*s", (CONSOLE_WIDTH - 50) / 2, "");
-    printf("Confirm user deactivation? (y/n): ");
+    term_printf("%*s", (CONSOLE_WIDTH - 50) / 2, "");
+    term_printf("Confirm user deactivation? (y/n): ");
     resetColor();
-    scanf(" %c", &confirm);
+    term_scanf(" %c", &confirm);
 
     if (confirm == 'y' || confirm == 'Y') {
         users[user_index].is_active = 0;
+        record_store_put('U', user_index);
 
         // Cancel active reservations
         for (int i = 0; i < reservation_count; i++) {
             if (reservations[i].user_id == user_id &&
                 strcmp(reservations[i].status, "active") == 0) {
-                strcpy(reservations[i].status, "cancelled");
-                get_current_time(reservations[i].end_time);
-
-                // Free up slots
-                for (int j = 0; j < slot_count; j++) {
-                    if (slots[j].slot_id == reservations[i].slot_id) {
-                        strcpy(slots[j].status, "available");
-                        slots[j].vehicle_id = 0;
-                        slots[j].user_id = 0;
-                        strcpy(slots[j].reserved_time, "");
-                        break;
-                    }
-                }
+                // Cancel and free up the slot
+                engine_cancel(-1, reservations[i].reservation_id);
             }
         }
 
-        printf("\n");
+        term_printf("\n");
         printCenteredLine('=', LIGHTGREEN);
         printCentered("USER DEACTIVATED SUCCESSFULLY!", LIGHTGREEN);
         printCenteredLine('=', LIGHTGREEN);
@@ -2475,7 +4041,7 @@ void admin_delete_user() {
         printCentered("User account is now inactive but data is preserved.", LIGHTCYAN);
         save_data();
     } else {
-        printf("\n");
+        term_printf("\n");
         printCentered("Deactivation cancelled. User remains active.", LIGHTCYAN);
     }
 
@@ -2485,17 +4051,17 @@ void admin_delete_user() {
 void admin_view_user_history() {
     clear_screen();
     print_header();
-    printf("\n");
+    term_printf("\n");
     printCentered("CUSTOMER PROFILE ANALYZER", YELLOW);
     printCentered("Comprehensive customer activity report", LIGHTCYAN);
-    printf("\n");
+    term_printf("\n");
 
     int user_id;
     setColor(WHITE);
-    printf("%*s", (CONSOLE_WIDTH - 35) / 2, "");
-    printf("Enter User ID for analysis: ");
+    term_printf("%*s", (CONSOLE_WIDTH - 35) / 2, "");
+    term_printf("Enter User ID for analysis: ");
     resetColor();
-    scanf("%d", &user_id);
+    term_scanf("%d", &user_id);
 
     int user_index = -1;
     for (int i = 0; i < user_count; i++) {
@@ -2506,29 +4072,29 @@ void admin_view_user_history() {
     }
 
     if (user_index == -1) {
-        printf("\n");
+        term_printf("\n");
         printCentered("CUSTOMER NOT FOUND!", LIGHTRED);
         printCentered("Please verify the User ID.", YELLOW);
         pause_screen();
         return;
     }
 
-    printf("\n");
+    term_printf("\n");
     printCenteredLine('=', LIGHTCYAN);
     printCentered("CUSTOMER PROFILE", LIGHTCYAN);
     printCenteredLine('=', LIGHTCYAN);
-    char user_info[200];
+    char user_info[200], when[TIME_TEXT_SIZE];
     sprintf(user_info, "%s (ID: %d)", users[user_index].name, users[user_index].user_id);
     printCentered(user_info, LIGHTGREEN);
     sprintf(user_info, "Contact: %s | Email: %s", users[user_index].phone, users[user_index].email);
     printCentered(user_info, WHITE);
     sprintf(user_info, "Member Since: %s | Status: %s",
-           users[user_index].reg_date,
+           format_time(users[user_index].reg_date, when),
            users[user_index].is_active ? "ACTIVE" : "INACTIVE");
     printCentered(user_info, LIGHTGRAY);
 
     // Vehicle Analysis
-    printf("\n");
+    term_printf("\n");
     printCenteredLine('-', LIGHTGREEN);
     printCentered("REGISTERED VEHICLES", LIGHTGREEN);
     printCenteredLine('-', LIGHTGREEN);
@@ -2540,7 +4106,7 @@ void admin_view_user_history() {
             char vehicle_info[200];
             sprintf(vehicle_info, "%s %s (%s) - ID: %d - Reg: %s",
                    vehicles[i].type, vehicles[i].license_plate, vehicles[i].color,
-                   vehicles[i].vehicle_id, vehicles[i].reg_date);
+                   vehicles[i].vehicle_id, format_time(vehicles[i].reg_date, when));
 
             if (strcmp(vehicles[i].type, "bike") == 0) {
                 printCentered(vehicle_info, LIGHTGREEN);
@@ -2565,7 +4131,7 @@ void admin_view_user_history() {
     }
 
     // Reservation Analysis
-    printf("\n");
+    term_printf("\n");
     printCenteredLine('-', LIGHTBLUE);
     printCentered("RESERVATION HISTORY", LIGHTBLUE);
     printCenteredLine('-', LIGHTBLUE);
@@ -2579,7 +4145,7 @@ void admin_view_user_history() {
             sprintf(res_info, "ID: %d | Slot %d | $%.2f | %.1fh | %s | %s",
                    reservations[i].reservation_id, reservations[i].slot_id,
                    reservations[i].total_amount, reservations[i].duration_hours,
-                   reservations[i].status, reservations[i].start_time);
+                   reservations[i].status, format_time(reservations[i].start_time, when));
 
             if (strcmp(reservations[i].status, "active") == 0) {
                 printCentered(res_info, LIGHTGREEN);
@@ -2607,7 +4173,7 @@ void admin_view_user_history() {
     }
 
     // Payment Analysis
-    printf("\n");
+    term_printf("\n");
     printCenteredLine('-', MAGENTA);
     printCentered("PAYMENT HISTORY", MAGENTA);
     printCenteredLine('-', MAGENTA);
@@ -2620,7 +4186,7 @@ void admin_view_user_history() {
             char pay_info[200];
             sprintf(pay_info, "ID: %d | $%.2f via %s | %s | %s",
                    payments[i].payment_id, payments[i].amount,
-                   payments[i].method, payments[i].status, payments[i].payment_date);
+                   payments[i].method, payments[i].status, format_time(payments[i].payment_date, when));
 
             if (strcmp(payments[i].status, "completed") == 0) {
                 printCentered(pay_info, LIGHTGREEN);
@@ -2644,7 +4210,7 @@ void admin_view_user_history() {
         printCentered(pay_summary, LIGHTGREEN);
 
         // Customer value analysis
-        printf("\n");
+        term_printf("\n");
         printCenteredLine('-', YELLOW);
         if (total_paid >= 500) {
             printCentered("CUSTOMER TIER: PLATINUM (Premium Customer)", YELLOW);
@@ -2664,10 +4230,10 @@ void admin_view_user_history() {
 void admin_view_all_vehicles() {
     clear_screen();
     print_header();
-    printf("\n");
+    term_printf("\n");
     printCentered("VEHICLE REGISTRY SYSTEM", LIGHTCYAN);
     printCentered("Complete database of all registered vehicles", LIGHTGREEN);
-    printf("\n");
+    term_printf("\n");
 
     if (vehicle_count == 0) {
         printCenteredLine('!', YELLOW);
@@ -2679,12 +4245,12 @@ void admin_view_all_vehicles() {
     }
 
     setColor(LIGHTCYAN);
-    printf("%*s%-6s %-8s %-12s %-10s %-15s %-12s %-15s\n",
+    term_printf("%*s%-6s %-8s %-12s %-10s %-15s %-12s %-15s\n",
            (CONSOLE_WIDTH - 78) / 2, "",
            "V-ID", "Type", "License", "Color", "Owner", "Phone", "Registered");
-    printf("%*s", (CONSOLE_WIDTH - 78) / 2, "");
-    for (int i = 0; i < 78; i++) printf("=");
-    printf("\n");
+    term_printf("%*s", (CONSOLE_WIDTH - 78) / 2, "");
+    for (int i = 0; i < 78; i++) term_printf("=");
+    term_printf("\n");
     resetColor();
 
     int bike_count = 0, car_count = 0, truck_count = 0;
@@ -2692,6 +4258,7 @@ void admin_view_all_vehicles() {
     for (int i = 0; i < vehicle_count; i++) {
         char owner_name[MAX_STRING] = "Unknown";
         char owner_phone[20] = "Unknown";
+        char when[TIME_TEXT_SIZE];
 
         for (int j = 0; j < user_count; j++) {
             if (users[j].user_id == vehicles[i].user_id) {
@@ -2713,15 +4280,15 @@ void admin_view_all_vehicles() {
             truck_count++;
         }
 
-        printf("%*s%-6d %-8s %-12s %-10s %-15s %-12s %-15s\n",
+        term_printf("%*s%-6d %-8s %-12s %-10s %-15s %-12s %-15s\n",
                (CONSOLE_WIDTH - 78) / 2, "",
                vehicles[i].vehicle_id, vehicles[i].type,
                vehicles[i].license_plate, vehicles[i].color,
-               owner_name, owner_phone, vehicles[i].reg_date);
+               owner_name, owner_phone, format_time(vehicles[i].reg_date, when));
     }
     resetColor();
 
-    printf("\n");
+    term_printf("\n");
     printCenteredLine('-', LIGHTCYAN);
     printCentered("VEHICLE FLEET ANALYSIS", LIGHTCYAN);
     printCenteredLine('-', LIGHTCYAN);
@@ -2750,10 +4317,10 @@ void admin_view_all_vehicles() {
 void admin_slot_usage_report() {
     clear_screen();
     print_header();
-    printf("\n");
+    term_printf("\n");
     printCentered("PARKING INFRASTRUCTURE ANALYTICS", MAGENTA);
     printCentered("Real-time slot utilization and efficiency metrics", LIGHTCYAN);
-    printf("\n");
+    term_printf("\n");
 
     int bike_available = 0, bike_occupied = 0, bike_reserved = 0;
     int car_available = 0, car_occupied = 0, car_reserved = 0;
@@ -2788,7 +4355,7 @@ void admin_slot_usage_report() {
             bike_occupied * BIKE_PRICE);
     printCentered(stats, LIGHTCYAN);
 
-    printf("\n");
+    term_printf("\n");
     printCenteredLine('=', LIGHTBLUE);
     printCentered("CAR/SUV PARKING ZONE", LIGHTBLUE);
     printCenteredLine('=', LIGHTBLUE);
@@ -2801,7 +4368,7 @@ void admin_slot_usage_report() {
             car_occupied * CAR_PRICE);
     printCentered(stats, LIGHTCYAN);
 
-    printf("\n");
+    term_printf("\n");
     printCenteredLine('=', YELLOW);
     printCentered("TRUCK/VAN PARKING ZONE", YELLOW);
     printCenteredLine('=', YELLOW);
@@ -2814,7 +4381,7 @@ void admin_slot_usage_report() {
             truck_occupied * TRUCK_PRICE);
     printCentered(stats, LIGHTCYAN);
 
-    printf("\n");
+    term_printf("\n");
     printCenteredLine('-', MAGENTA);
     printCentered("OVERALL FACILITY PERFORMANCE", MAGENTA);
     printCenteredLine('-', MAGENTA);
@@ -2840,7 +4407,7 @@ void admin_slot_usage_report() {
     printCentered(stats, YELLOW);
 
     // Performance indicators
-    printf("\n");
+    term_printf("\n");
     double occupancy_rate = ((double)total_occupied / total_slots) * 100;
     if (occupancy_rate >= 80) {
         printCentered("STATUS: EXCELLENT UTILIZATION", LIGHTGREEN);
@@ -2862,10 +4429,10 @@ void admin_slot_usage_report() {
 void admin_generate_daily_report() {
     clear_screen();
     print_header();
-    printf("\n");
+    term_printf("\n");
     printCentered("SMART PARK EXECUTIVE DASHBOARD", WHITE);
     printCentered("Comprehensive Business Intelligence Report", LIGHTGREEN);
-    printf("\n");
+    term_printf("\n");
 
     char today[20];
     get_current_time(today);
@@ -2874,38 +4441,20 @@ void admin_generate_daily_report() {
     printCentered(report_title, LIGHTGRAY);
     printCenteredLine('=', LIGHTCYAN);
 
-    // Calculate all metrics
-    int total_users = user_count;
-    int active_users = 0;
-    int total_vehicles = vehicle_count;
-    int active_reservations = 0;
-    int completed_reservations = 0;
-    int cancelled_reservations = 0;
-    int completed_payments = 0;
-    double total_revenue = 0.0;
-
-    for (int i = 0; i < user_count; i++) {
-        if (users[i].is_active) active_users++;
-    }
-
-    for (int i = 0; i < reservation_count; i++) {
-        if (strcmp(reservations[i].status, "active") == 0) {
-            active_reservations++;
-        } else if (strcmp(reservations[i].status, "completed") == 0) {
-            completed_reservations++;
-        } else if (strcmp(reservations[i].status, "cancelled") == 0) {
-            cancelled_reservations++;
-        }
-    }
+    // Calculate all metrics in one parallel pass over every table
+    ReportTotals totals;
+    compute_report_totals(-1, &totals);
 
-    for (int i = 0; i < payment_count; i++) {
-        if (strcmp(payments[i].status, "completed") == 0) {
-            completed_payments++;
-            total_revenue += payments[i].amount;
-        }
-    }
+    int total_users = totals.total_users;
+    int active_users = totals.active_users;
+    int total_vehicles = totals.total_vehicles;
+    int active_reservations = totals.active_reservations;
+    int completed_reservations = totals.completed_reservations;
+    int cancelled_reservations = totals.cancelled_reservations;
+    int completed_payments = totals.completed_payments;
+    double total_revenue = totals.total_revenue;
 
-    printf("\n");
+    term_printf("\n");
     printCenteredLine('-', LIGHTBLUE);
     printCentered("CUSTOMER BASE ANALYTICS", LIGHTBLUE);
     printCenteredLine('-', LIGHTBLUE);
@@ -2921,16 +4470,11 @@ void admin_generate_daily_report() {
             total_users > 0 ? ((double)active_users/total_users)*100 : 0);
     printCentered(metrics, LIGHTCYAN);
 
-    printf("\n");
+    term_printf("\n");
     printCenteredLine('-', LIGHTGREEN);
     printCentered("VEHICLE FLEET OVERVIEW", LIGHTGREEN);
     printCenteredLine('-', LIGHTGREEN);
-    int bikes = 0, cars = 0, trucks = 0;
-    for (int i = 0; i < vehicle_count; i++) {
-        if (strcmp(vehicles[i].type, "bike") == 0) bikes++;
-        else if (strcmp(vehicles[i].type, "car") == 0) cars++;
-        else trucks++;
-    }
+    int bikes = totals.bikes, cars = totals.cars, trucks = totals.trucks;
 
     sprintf(metrics, "Total Registered Vehicles: %d", total_vehicles);
     printCentered(metrics, WHITE);
@@ -2944,7 +4488,7 @@ void admin_generate_daily_report() {
             (bikes > 0 && cars > 0 && trucks > 0) ? "Excellent" : "Good");
     printCentered(metrics, LIGHTGREEN);
 
-    printf("\n");
+    term_printf("\n");
     printCenteredLine('-', MAGENTA);
     printCentered("BOOKING & RESERVATION METRICS", MAGENTA);
     printCenteredLine('-', MAGENTA);
@@ -2960,7 +4504,7 @@ void admin_generate_daily_report() {
             total_users > 0 ? (double)total_reservations/total_users : 0);
     printCentered(metrics, LIGHTGREEN);
 
-    printf("\n");
+    term_printf("\n");
     printCenteredLine('-', YELLOW);
     printCentered("FINANCIAL PERFORMANCE", YELLOW);
     printCenteredLine('-', YELLOW);
@@ -2976,39 +4520,22 @@ void admin_generate_daily_report() {
     printCentered(metrics, LIGHTCYAN);
 
     // Payment method analysis
-    int cash_payments = 0, card_payments = 0, mobile_payments = 0;
-    double cash_amount = 0, card_amount = 0, mobile_amount = 0;
-
-    for (int i = 0; i < payment_count; i++) {
-        if (strcmp(payments[i].status, "completed") == 0) {
-            if (strcmp(payments[i].method, "cash") == 0) {
-                cash_payments++;
-                cash_amount += payments[i].amount;
-            } else if (strcmp(payments[i].method, "card") == 0) {
-                card_payments++;
-                card_amount += payments[i].amount;
-            } else {
-                mobile_payments++;
-                mobile_amount += payments[i].amount;
-            }
-        }
-    }
+    int cash_payments = totals.cash_payments, card_payments = totals.card_payments;
+    int mobile_payments = totals.mobile_payments;
+    double cash_amount = totals.cash_amount, card_amount = totals.card_amount;
+    double mobile_amount = totals.mobile_amount;
 
     sprintf(metrics, "Payment Methods: Cash: %d ($%.2f) | Card: %d ($%.2f) | Mobile: %d ($%.2f)",
             cash_payments, cash_amount, card_payments, card_amount, mobile_payments, mobile_amount);
     printCentered(metrics, LIGHTBLUE);
 
     // Calculate current facility utilization
-    int total_occupied = 0, total_reserved = 0;
-    for (int i = 0; i < slot_count; i++) {
-        if (strcmp(slots[i].status, "occupied") == 0) total_occupied++;
-        else if (strcmp(slots[i].status, "reserved") == 0) total_reserved++;
-    }
+    int total_occupied = totals.total_occupied, total_reserved = totals.total_reserved;
 
     double current_utilization = ((double)(total_occupied + total_reserved) / slot_count) * 100;
     double revenue_efficiency = ((double)total_occupied / slot_count) * 100;
 
-    printf("\n");
+    term_printf("\n");
     printCenteredLine('-', LIGHTCYAN);
     printCentered("OPERATIONAL EFFICIENCY", LIGHTCYAN);
     printCenteredLine('-', LIGHTCYAN);
@@ -3021,7 +4548,7 @@ void admin_generate_daily_report() {
     printCentered(metrics, LIGHTCYAN);
 
     // Business performance indicators.
-    printf("\n");
+    term_printf("\n");
     printCenteredLine('*', YELLOW);
     if (current_utilization >= 70 && total_revenue >= 1000) {
         printCentered("BUSINESS STATUS: EXCELLENT PERFORMANCE", LIGHTGREEN);
@@ -3038,7 +4565,7 @@ void admin_generate_daily_report() {
     }
     printCenteredLine('*', YELLOW);
 
-    printf("\n");
+    term_printf("\n");
     printCenteredLine('=', LIGHTCYAN);
     printCentered("END OF EXECUTIVE REPORT", LIGHTCYAN);
     sprintf(metrics, "SMART PARK System v2.0 | Report ID: %s", today);
@@ -3047,3 +4574,6003 @@ void admin_generate_daily_report() {
 
     pause_screen();
 }
+
+// Work-Stealing Task Pool
+int pool_cpu_count() {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    int count = (int)info.dwNumberOfProcessors;
+#else
+    int count = (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+    if (count < 1) count = 1;
+    if (count > POOL_MAX_WORKERS) count = POOL_MAX_WORKERS;
+    return count;
+}
+
+static int deque_push(TaskDeque *dq, Task task) {
+    int pushed = 0;
+    pool_mutex_lock(&dq->lock);
+    if (dq->tail - dq->head < POOL_DEQUE_SIZE) {
+        dq->tasks[dq->tail % POOL_DEQUE_SIZE] = task;
+        dq->tail++;
+        pushed = 1;
+    }
+    pool_mutex_unlock(&dq->lock);
+    return pushed;
+}
+
+// Owner end: newest task first, it is the one most likely still in cache
+static int deque_pop(TaskDeque *dq, Task *task) {
+    int popped = 0;
+    pool_mutex_lock(&dq->lock);
+    if (dq->tail > dq->head) {
+        dq->tail--;
+        *task = dq->tasks[dq->tail % POOL_DEQUE_SIZE];
+        popped = 1;
+    }
+    if (dq->tail == dq->head) dq->head = dq->tail = 0;
+    pool_mutex_unlock(&dq->lock);
+    return popped;
+}
+
+// Thief end: oldest task first
+static int deque_steal(TaskDeque *dq, Task *task) {
+    int stolen = 0;
+    pool_mutex_lock(&dq->lock);
+    if (dq->tail > dq->head) {
+        *task = dq->tasks[dq->head % POOL_DEQUE_SIZE];
+        dq->head++;
+        stolen = 1;
+    }
+    if (dq->tail == dq->head) dq->head = dq->tail = 0;
+    pool_mutex_unlock(&dq->lock);
+    return stolen;
+}
+
+static int pool_take_task(TaskPool *pool, Task *task) {
+    int self = pool_worker_index;
+    int found = 0;
+
+    if (self >= 0 && deque_pop(&pool->deques[self], task)) {
+        found = 1;
+    } else {
+        int start = self >= 0 ? self + 1 : 0;
+        for (int k = 0; k < pool->worker_count && !found; k++) {
+            int victim = (start + k) % pool->worker_count;
+            if (victim != self && deque_steal(&pool->deques[victim], task)) {
+                found = 1;
+            }
+        }
+    }
+
+    if (found) {
+        pool_mutex_lock(&pool->lock);
+        pool->queued--;
+        pool_mutex_unlock(&pool->lock);
+    }
+    return found;
+}
+
+static void pool_run_task(TaskPool *pool, Task task) {
+    task.fn(task.arg);
+    pool_mutex_lock(&pool->lock);
+    task.group->pending--;
+    if (task.group->pending == 0) {
+        pool_cond_broadcast(&pool->done_cond);
+    }
+    pool_mutex_unlock(&pool->lock);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI pool_worker_main(LPVOID arg) {
+#else
+static void *pool_worker_main(void *arg) {
+#endif
+    TaskPool *pool = task_pool;
+    pool_worker_index = (int)(size_t)arg;
+
+    while (1) {
+        Task task;
+        if (pool_take_task(pool, &task)) {
+            pool_run_task(pool, task);
+            continue;
+        }
+
+        pool_mutex_lock(&pool->lock);
+        while (pool->queued == 0 && !pool->shutdown) {
+            pool_cond_wait(&pool->work_cond, &pool->lock);
+        }
+        int stop = pool->shutdown && pool->queued == 0;
+        pool_mutex_unlock(&pool->lock);
+        if (stop) break;
+    }
+    return 0;
+}
+
+// Lazily start one worker per CPU; returns NULL if threads are unavailable
+TaskPool *pool_get() {
+    if (task_pool != NULL) return task_pool;
+
+    TaskPool *pool = (TaskPool *)calloc(1, sizeof(TaskPool));
+    if (pool == NULL) return NULL;
+
+    int wanted = pool_cpu_count();
+    pool_mutex_init(&pool->lock);
+    pool_cond_init(&pool->work_cond);
+    pool_cond_init(&pool->done_cond);
+    for (int i = 0; i < wanted; i++) {
+        pool_mutex_init(&pool->deques[i].lock);
+    }
+    task_pool = pool;
+
+    for (int i = 0; i < wanted; i++) {
+#ifdef _WIN32
+        pool->threads[i] = CreateThread(NULL, 0, pool_worker_main, (LPVOID)(size_t)i, 0, NULL);
+        if (pool->threads[i] == NULL) break;
+#else
+        if (pthread_create(&pool->threads[i], NULL, pool_worker_main, (void *)(size_t)i) != 0) break;
+#endif
+        pool->worker_count++;
+    }
+
+    if (pool->worker_count == 0) {
+        task_pool = NULL;
+        free(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+void pool_submit(TaskPool *pool, TaskGroup *group, TaskFunc fn, void *arg) {
+    Task task;
+    task.fn = fn;
+    task.arg = arg;
+    task.group = group;
+
+    pool_mutex_lock(&pool->lock);
+    int target = pool_worker_index;
+    if (target < 0) {
+        target = pool->next_deque;
+        pool->next_deque = (pool->next_deque + 1) % pool->worker_count;
+    }
+    group->pending++;
+    pool->queued++; // counted before the push so a thief's decrement never runs first
+    pool_mutex_unlock(&pool->lock);
+
+    if (!deque_push(&pool->deques[target], task)) {
+        // Deque full: run inline instead of blocking the submitter
+        pool_mutex_lock(&pool->lock);
+        pool->queued--;
+        pool_mutex_unlock(&pool->lock);
+        pool_run_task(pool, task);
+        return;
+    }
+
+    pool_mutex_lock(&pool->lock);
+    pool_cond_broadcast(&pool->work_cond);
+    pool_mutex_unlock(&pool->lock);
+}
+
+// The waiting thread helps drain the queues before it sleeps
+void pool_wait(TaskPool *pool, TaskGroup *group) {
+    while (1) {
+        pool_mutex_lock(&pool->lock);
+        int pending = group->pending;
+        pool_mutex_unlock(&pool->lock);
+        if (pending == 0) return;
+
+        Task task;
+        if (pool_take_task(pool, &task)) {
+            pool_run_task(pool, task);
+            continue;
+        }
+
+        pool_mutex_lock(&pool->lock);
+        while (group->pending > 0) {
+            pool_cond_wait(&pool->done_cond, &pool->lock);
+        }
+        pool_mutex_unlock(&pool->lock);
+        return;
+    }
+}
+
+void pool_shutdown() {
+    TaskPool *pool = task_pool;
+    if (pool == NULL) return;
+
+    pool_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pool_cond_broadcast(&pool->work_cond);
+    pool_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->worker_count; i++) {
+#ifdef _WIN32
+        WaitForSingleObject(pool->threads[i], INFINITE);
+        CloseHandle(pool->threads[i]);
+#else
+        pthread_join(pool->threads[i], NULL);
+#endif
+    }
+    task_pool = NULL;
+    free(pool);
+}
+
+static void run_range_task(void *arg) {
+    RangeTask *task = (RangeTask *)arg;
+    task->fn(task->ctx, task->begin, task->end, task->chunk_index);
+}
+
+// Split [0, total) into chunks of chunk_rows and run them on the pool.
+// Small ranges run inline on the calling thread.
+void parallel_for(int total, int chunk_rows, RangeFunc fn, void *ctx) {
+    if (chunk_rows < 1) chunk_rows = 1;
+    int chunks = (total + chunk_rows - 1) / chunk_rows;
+    TaskPool *pool = chunks > 1 ? pool_get() : NULL;
+    RangeTask *tasks = pool != NULL ? (RangeTask *)malloc(chunks * sizeof(RangeTask)) : NULL;
+
+    if (tasks == NULL) {
+        for (int c = 0; c < chunks; c++) {
+            int end = (c + 1) * chunk_rows;
+            fn(ctx, c * chunk_rows, end < total ? end : total, c);
+        }
+        return;
+    }
+
+    TaskGroup group = {0};
+    for (int c = 0; c < chunks; c++) {
+        tasks[c].fn = fn;
+        tasks[c].ctx = ctx;
+        tasks[c].begin = c * chunk_rows;
+        tasks[c].end = (c + 1) * chunk_rows < total ? (c + 1) * chunk_rows : total;
+        tasks[c].chunk_index = c;
+        pool_submit(pool, &group, run_range_task, &tasks[c]);
+    }
+    pool_wait(pool, &group);
+    free(tasks);
+}
+
+// Parallel Report Aggregation
+typedef struct {
+    int filter_user_id; // -1 for system-wide reports
+    ReportTotals *partials;
+} ReportScan;
+
+// Clip a global row range to one table laid out at [base, base + count)
+static void scan_bounds(int begin, int end, int base, int count, int *lo, int *hi) {
+    *lo = begin - base;
+    *hi = end - base;
+    if (*lo < 0) *lo = 0;
+    if (*hi > count) *hi = count;
+}
+
+// One chunk of the virtual row space users | vehicles | reservations | payments | slots
+static void report_scan_range(void *ctx, int begin, int end, int chunk_index) {
+    ReportScan *scan = (ReportScan *)ctx;
+    ReportTotals *t = &scan->partials[chunk_index];
+    int filter = scan->filter_user_id;
+    int base = 0, lo, hi;
+
+    memset(t, 0, sizeof(ReportTotals));
+
+    scan_bounds(begin, end, base, user_count, &lo, &hi);
+    for (int i = lo; i < hi; i++) {
+        if (filter != -1 && users[i].user_id != filter) continue;
+        t->total_users++;
+        if (users[i].is_active) t->active_users++;
+    }
+    base += user_count;
+
+    scan_bounds(begin, end, base, vehicle_count, &lo, &hi);
+    for (int i = lo; i < hi; i++) {
+        if (filter != -1 && vehicles[i].user_id != filter) continue;
+        t->total_vehicles++;
+        if (strcmp(vehicles[i].type, "bike") == 0) t->bikes++;
+        else if (strcmp(vehicles[i].type, "car") == 0) t->cars++;
+        else t->trucks++;
+    }
+    base += vehicle_count;
+
+    scan_bounds(begin, end, base, reservation_count, &lo, &hi);
+    for (int i = lo; i < hi; i++) {
+        if (filter != -1 && reservations[i].user_id != filter) continue;
+        t->total_reservations++;
+        if (strcmp(reservations[i].status, "active") == 0) t->active_reservations++;
+        else if (strcmp(reservations[i].status, "completed") == 0) t->completed_reservations++;
+        else if (strcmp(reservations[i].status, "cancelled") == 0 ||
+                 strcmp(reservations[i].status, "expired") == 0) t->cancelled_reservations++;
+    }
+    base += reservation_count;
+
+    scan_bounds(begin, end, base, payment_count, &lo, &hi);
+    for (int i = lo; i < hi; i++) {
+        if (filter != -1 && payments[i].user_id != filter) continue;
+        t->total_payments++;
+        if (strcmp(payments[i].status, "completed") != 0) continue;
+        t->completed_payments++;
+        t->total_revenue += payments[i].amount;
+        if (strcmp(payments[i].method, "cash") == 0) {
+            t->cash_payments++;
+            t->cash_amount += payments[i].amount;
+        } else if (strcmp(payments[i].method, "card") == 0) {
+            t->card_payments++;
+            t->card_amount += payments[i].amount;
+        } else {
+            t->mobile_payments++;
+            t->mobile_amount += payments[i].amount;
+        }
+    }
+    base += payment_count;
+
+    scan_bounds(begin, end, base, slot_count, &lo, &hi);
+    for (int i = lo; i < hi; i++) {
+        if (strcmp(slots[i].status, "occupied") == 0) t->total_occupied++;
+        else if (strcmp(slots[i].status, "reserved") == 0) t->total_reserved++;
+    }
+}
+
+static void report_totals_merge(ReportTotals *into, const ReportTotals *part) {
+    into->total_users += part->total_users;
+    into->active_users += part->active_users;
+    into->total_vehicles += part->total_vehicles;
+    into->bikes += part->bikes;
+    into->cars += part->cars;
+    into->trucks += part->trucks;
+    into->total_reservations += part->total_reservations;
+    into->active_reservations += part->active_reservations;
+    into->completed_reservations += part->completed_reservations;
+    into->cancelled_reservations += part->cancelled_reservations;
+    into->total_payments += part->total_payments;
+    into->completed_payments += part->completed_payments;
+    into->total_revenue += part->total_revenue;
+    into->cash_payments += part->cash_payments;
+    into->card_payments += part->card_payments;
+    into->mobile_payments += part->mobile_payments;
+    into->cash_amount += part->cash_amount;
+    into->card_amount += part->card_amount;
+    into->mobile_amount += part->mobile_amount;
+    into->total_occupied += part->total_occupied;
+    into->total_reserved += part->total_reserved;
+}
+
+// Single pass over all tables, split into chunks and reduced in chunk order
+// so floating point totals do not depend on scheduling
+void compute_report_totals(int filter_user_id, ReportTotals *totals) {
+    int total_rows = user_count + vehicle_count + reservation_count + payment_count + slot_count;
+    int chunks = (total_rows + REPORT_CHUNK_ROWS - 1) / REPORT_CHUNK_ROWS;
+    ReportTotals local_partial;
+    ReportScan scan;
+    double started = monotonic_us();
+
+    memset(totals, 0, sizeof(ReportTotals));
+    if (chunks == 0) return;
+
+    scan.filter_user_id = filter_user_id;
+    scan.partials = chunks > 1 ? (ReportTotals *)malloc(chunks * sizeof(ReportTotals)) : &local_partial;
+    if (scan.partials == NULL) {
+        // Out of memory: fall back to one serial chunk
+        scan.partials = &local_partial;
+        report_scan_range(&scan, 0, total_rows, 0);
+        *totals = local_partial;
+        return;
+    }
+
+    parallel_for(total_rows, REPORT_CHUNK_ROWS, report_scan_range, &scan);
+
+    for (int c = 0; c < chunks; c++) {
+        report_totals_merge(totals, &scan.partials[c]);
+    }
+    if (scan.partials != &local_partial) free(scan.partials);
+    latency_record(METRIC_REPORT, started, 0);
+}
+
+// Slot State and Journal Functions
+void sleep_ms(int ms) {
+#ifdef _WIN32
+    Sleep(ms);
+#else
+    usleep(ms * 1000);
+#endif
+}
+
+// Ids are handed out sequentially, so row id - 1 is checked before scanning
+int find_slot_index(int slot_id) {
+    if (slot_id >= 1 && slot_id <= slot_count && slots[slot_id - 1].slot_id == slot_id) {
+        return slot_id - 1;
+    }
+    for (int i = 0; i < slot_count; i++) {
+        if (slots[i].slot_id == slot_id) return i;
+    }
+    return -1;
+}
+
+int find_reservation_index(int reservation_id) {
+    if (reservation_id >= 1 && reservation_id <= reservation_count &&
+        reservations[reservation_id - 1].reservation_id == reservation_id) {
+        return reservation_id - 1;
+    }
+    for (int i = 0; i < reservation_count; i++) {
+        if (reservations[i].reservation_id == reservation_id) return i;
+    }
+    return -1;
+}
+
+// Every slot transition goes through here so it can be journaled
+void set_slot_state(int slot_index, const char *status, int vehicle_id, int user_id, long long reserved_time) {
+    Slot *slot = &slots[slot_index];
+    char when[TIME_TEXT_SIZE];
+    slot_table_lock();
+    slot_counts_move(slot, status);
+    strcpy(slot->status, status);
+    slot->vehicle_id = vehicle_id;
+    slot->user_id = user_id;
+    slot->reserved_time = reserved_time;
+    if (shared_slots != NULL) {
+        __atomic_store_n(&shared_slots->state[slot_index], slot_state_code(status), __ATOMIC_RELEASE);
+    }
+    slot_events->slots[slot_events->head & (SLOT_EVENT_RING - 1)] = slot_index;
+    __atomic_add_fetch(&slot_events->head, 1, __ATOMIC_RELEASE);
+    slot_table_unlock();
+    journal_append("S %d %s %d %d %s\n", slot->slot_id, status, vehicle_id, user_id,
+                   format_time(reserved_time, when));
+}
+
+void set_reservation_status(int reservation_index, const char *status, long long end_time) {
+    Reservation *res = &reservations[reservation_index];
+    char when[TIME_TEXT_SIZE];
+    strcpy(res->status, status);
+    res->end_time = end_time;
+    record_store_put('N', reservation_index);
+    reservation_timers_track(reservation_index);
+    journal_append("R %d %s %s\n", res->reservation_id, status, format_time(end_time, when));
+}
+
+// Records are formatted straight into the buffer at their full length, so
+// a long row never loses its newline and runs into the next record.
+void journal_append(const char *format, ...) {
+    va_list args, sizing;
+    va_start(args, format);
+    va_copy(sizing, args);
+    int len = vsnprintf(NULL, 0, format, sizing);
+    va_end(sizing);
+
+    if (len >= 0 && journal_length + len + 1 > journal_capacity) {
+        int new_capacity = journal_capacity > 0 ? journal_capacity * 2 : 4096;
+        while (new_capacity < journal_length + len + 1) new_capacity *= 2;
+        char *grown = (char *)realloc(journal_buffer, new_capacity);
+        if (grown == NULL) len = -1;
+        else {
+            journal_buffer = grown;
+            journal_capacity = new_capacity;
+        }
+    }
+    if (len >= 0) {
+        vsnprintf(journal_buffer + journal_length, len + 1, format, args);
+        journal_length += len;
+        journal_pending_records++;
+    }
+    va_end(args);
+}
+
+// Write all buffered records plus a commit marker with a single write.
+// Replay ignores records that are not followed by their marker.
+int journal_commit() {
+    if (journal_pending_records == 0) return 1;
+
+    journal_seq++;
+    journal_append("C %d %d\n", journal_seq, journal_pending_records);
+
+    if (journal_file == NULL) {
+        journal_file = fopen(JOURNAL_FILE, "a");
+        if (journal_file == NULL) return 0;
+    }
+    double started = monotonic_us();
+    int ok = fwrite(journal_buffer, 1, journal_length, journal_file) == (size_t)journal_length &&
+             fflush(journal_file) == 0;
+    latency_record(METRIC_JOURNAL_WRITE, started, !ok);
+    if (journal_sync) {
+        started = monotonic_us();
+#ifdef _WIN32
+        _commit(_fileno(journal_file));
+#else
+        fsync(fileno(journal_file));
+#endif
+        latency_record(METRIC_JOURNAL_FSYNC, started, 0);
+    }
+    if (replica_link_count > 0) {
+        started = monotonic_us();
+        replication_ship(journal_buffer, journal_length);
+        latency_record(METRIC_REPLICATION_SHIP, started, 0);
+    }
+
+    journal_records_since_checkpoint += journal_pending_records;
+    journal_commit_ms = monotonic_ms();
+    journal_length = 0;
+    journal_pending_records = 0;
+    return ok;
+}
+
+// Called once the snapshot files are written: the journal starts over
+void journal_checkpoint() {
+    if (journal_file != NULL) {
+        fclose(journal_file);
+    }
+    journal_file = fopen(JOURNAL_FILE, "w");
+    journal_length = 0;
+    journal_pending_records = 0;
+    journal_records_since_checkpoint = 0;
+}
+
+static void table_apply_record(const char *line) {
+    int id, vehicle_id, user_id;
+    char status[20], when[TIME_TEXT_SIZE], ended[TIME_TEXT_SIZE];
+
+    // Inserts are skipped when the snapshot already holds the row
+    if (line[0] == 'U' && user_count < MAX_USERS) {
+        User *u = &users[user_count];
+        if (sscanf(line, "U %d %99s %19s %99s %99s %19s %d", &u->user_id, u->name, u->phone,
+                   u->email, u->password, when, &u->is_active) == 7 &&
+            find_user_index(u->user_id) == -1) {
+            u->reg_date = parse_time(when);
+            user_count++;
+        }
+        return;
+    }
+    if (line[0] == 'V' && vehicle_count < MAX_VEHICLES) {
+        Vehicle *v = &vehicles[vehicle_count];
+        if (sscanf(line, "V %d %d %19s %19s %19s %19s", &v->vehicle_id, &v->user_id, v->type,
+                   v->license_plate, v->color, when) == 6 &&
+            find_vehicle_index(v->vehicle_id) == -1) {
+            v->reg_date = parse_time(when);
+            vehicle_count++;
+        }
+        return;
+    }
+    if (line[0] == 'N' && reservation_count < MAX_RESERVATIONS) {
+        Reservation *r = &reservations[reservation_count];
+        if (sscanf(line, "N %d %d %d %d %19s %19s %19s %lf %lf", &r->reservation_id, &r->user_id,
+                   &r->slot_id, &r->vehicle_id, when, ended, r->status,
+                   &r->duration_hours, &r->total_amount) == 9 &&
+            find_reservation_index(r->reservation_id) == -1) {
+            r->start_time = parse_time(when);
+            r->end_time = parse_time(ended);
+            reservation_count++;
+            reservation_paid[reservation_count - 1] = 0;
+            reservation_timers_track(reservation_count - 1);
+        }
+        return;
+    }
+    if (line[0] == 'P' && payment_count < MAX_PAYMENTS) {
+        Payment *p = &payments[payment_count];
+        if (sscanf(line, "P %d %d %d %lf %19s %19s %19s", &p->payment_id, &p->user_id,
+                   &p->reservation_id, &p->amount, p->method, when, p->status) == 7) {
+            int exists = 0;
+            p->payment_date = parse_time(when);
+            for (int i = 0; i < payment_count && !exists; i++) {
+                exists = payments[i].payment_id == p->payment_id;
+            }
+            if (!exists) {
+                payment_count++;
+                reservation_timers_paid(p->reservation_id);
+            }
+        }
+        return;
+    }
+
+    if (sscanf(line, "S %d %19s %d %d %19s", &id, status, &vehicle_id, &user_id, when) == 5) {
+        int index = find_slot_index(id);
+        if (index == -1 || shared_slots_live) return;
+        slot_counts_move(&slots[index], status);
+        strcpy(slots[index].status, status);
+        slots[index].vehicle_id = vehicle_id;
+        slots[index].user_id = user_id;
+        slots[index].reserved_time = parse_time(when);
+    } else if (sscanf(line, "R %d %19s %19s", &id, status, when) == 3) {
+        int index = find_reservation_index(id);
+        if (index == -1) return;
+        strcpy(reservations[index].status, status);
+        reservations[index].end_time = parse_time(when);
+        reservation_timers_track(index);
+    }
+}
+
+// Rows of the record store are authoritative, so only slot records replay
+static void journal_apply_record(const char *line) {
+    if (record_store_mode && line[0] != 'S') return;
+    table_apply_record(line);
+}
+
+// One table row in journal record form, as used by snapshots and the record store
+int format_table_record(char kind, int index, char *line) {
+    char when[TIME_TEXT_SIZE], ended[TIME_TEXT_SIZE];
+    if (kind == 'U') {
+        User *u = &users[index];
+        return sprintf(line, "U %d %s %s %s %s %s %d\n", u->user_id, u->name, u->phone,
+                       u->email, u->password, format_time(u->reg_date, when), u->is_active);
+    }
+    if (kind == 'V') {
+        Vehicle *v = &vehicles[index];
+        return sprintf(line, "V %d %d %s %s %s %s\n", v->vehicle_id, v->user_id, v->type,
+                       v->license_plate, v->color, format_time(v->reg_date, when));
+    }
+    if (kind == 'N') {
+        Reservation *r = &reservations[index];
+        return sprintf(line, "N %d %d %d %d %s %s %s %.2f %.2f\n", r->reservation_id, r->user_id,
+                       r->slot_id, r->vehicle_id, format_time(r->start_time, when),
+                       format_time(r->end_time, ended), r->status, r->duration_hours, r->total_amount);
+    }
+    if (kind == 'P') {
+        Payment *p = &payments[index];
+        return sprintf(line, "P %d %d %d %.2f %s %s %s\n", p->payment_id, p->user_id,
+                       p->reservation_id, p->amount, p->method, format_time(p->payment_date, when),
+                       p->status);
+    }
+    Slot *slot = &slots[index];
+    return sprintf(line, "S %d %s %d %d %s\n", slot->slot_id, slot->status, slot->vehicle_id,
+                   slot->user_id, format_time(slot->reserved_time, when));
+}
+
+// Cuts the journal back to its first `length` bytes
+static void journal_truncate(long length) {
+#ifdef _WIN32
+    int fd = _open(JOURNAL_FILE, _O_RDWR);
+    if (fd < 0) return;
+    _chsize(fd, length);
+    _close(fd);
+#else
+    if (truncate(JOURNAL_FILE, length) != 0) return;
+#endif
+}
+
+// Returns the number of committed batches applied. Replay stops at the
+// first batch whose record count differs from its marker. Whatever follows
+// the last good marker is cut off, so the next commit cannot adopt it.
+int journal_replay() {
+    FILE *file = fopen(JOURNAL_FILE, "r");
+    if (file == NULL) return 0;
+
+    char line[RECORD_SIZE]; // the longest record still fits a record-store row
+    long batch_start = ftell(file);
+    int batches = 0, records = 0;
+
+    while (fgets(line, sizeof(line), file) != NULL) {
+        int seq, count;
+        if (sscanf(line, "C %d %d", &seq, &count) != 2) {
+            records++;
+            continue;
+        }
+        if (count != records) break; // records lost or torn inside the batch
+
+        // Commit marker found: apply the batch that precedes it
+        long batch_end = ftell(file);
+        fseek(file, batch_start, SEEK_SET);
+        while (ftell(file) < batch_end && fgets(line, sizeof(line), file) != NULL) {
+            journal_apply_record(line);
+        }
+        batch_start = batch_end;
+        records = 0;
+        if (seq > journal_seq) journal_seq = seq;
+        batches++;
+    }
+    fseek(file, 0, SEEK_END);
+    journal_replay_bytes = ftell(file);
+    fclose(file);
+    if (journal_replay_bytes > batch_start) journal_truncate(batch_start);
+    return batches;
+}
+
+// ANPR Camera Ingestion
+// ENTRY moves the slot of the vehicle's active reservation from reserved to
+// occupied. Paying already holds the slot as occupied, so an ENTRY on an
+// occupied slot held by the same vehicle is the normal reserve, pay, drive
+// in flow and counts as applied without changing the slot. EXIT frees the
+// slot and completes the reservation.
+static unsigned int plate_hash(const char *plate) {
+    unsigned int hash = 5381;
+    while (*plate) {
+        hash = hash * 33 + (unsigned char)toupper((unsigned char)*plate);
+        plate++;
+    }
+    return hash;
+}
+
+// Vehicles are only ever appended, so the index just picks up new rows
+static void plate_index_refresh() {
+    while (plate_index_count < vehicle_count) {
+        const char *plate = vehicles[plate_index_count].license_plate;
+        unsigned int pos = plate_hash(plate) & (PLATE_INDEX_SIZE - 1);
+        while (plate_index[pos] != 0 &&
+               strcasecmp(vehicles[plate_index[pos] - 1].license_plate, plate) != 0) {
+            pos = (pos + 1) & (PLATE_INDEX_SIZE - 1);
+        }
+        plate_index[pos] = plate_index_count + 1; // newest registration wins
+        plate_index_count++;
+    }
+}
+
+int find_vehicle_by_plate(const char *plate) {
+    plate_index_refresh();
+    unsigned int pos = plate_hash(plate) & (PLATE_INDEX_SIZE - 1);
+    while (plate_index[pos] != 0) {
+        if (strcasecmp(vehicles[plate_index[pos] - 1].license_plate, plate) == 0) {
+            return plate_index[pos] - 1;
+        }
+        pos = (pos + 1) & (PLATE_INDEX_SIZE - 1);
+    }
+    return -1;
+}
+
+// Apply a burst of camera reads. Plates are resolved for the whole batch
+// first, active reservations are matched in one pass over the table, and
+// the resulting slot transitions are committed to the journal once.
+int ingest_plate_events(const PlateEvent *events, int count, IngestStats *stats) {
+    int vehicle_of[ANPR_BATCH_MAX];
+    int res_of_vehicle[ANPR_BATCH_MAX * 2]; // small open-addressing map vehicle_id -> reservation
+    int key_of_vehicle[ANPR_BATCH_MAX * 2];
+    const int map_size = ANPR_BATCH_MAX * 2;
+    double started = monotonic_us();
+
+    memset(stats, 0, sizeof(IngestStats));
+    if (count > ANPR_BATCH_MAX) count = ANPR_BATCH_MAX;
+
+    for (int i = 0; i < map_size; i++) key_of_vehicle[i] = 0;
+
+    // Resolve plates and register the vehicles we need reservations for
+    for (int e = 0; e < count; e++) {
+        vehicle_of[e] = find_vehicle_by_plate(events[e].plate);
+        if (vehicle_of[e] == -1) continue;
+        int vehicle_id = vehicles[vehicle_of[e]].vehicle_id;
+        int pos = (unsigned int)vehicle_id * 2654435761u % map_size;
+        while (key_of_vehicle[pos] != 0 && key_of_vehicle[pos] != vehicle_id) {
+            pos = (pos + 1) % map_size;
+        }
+        key_of_vehicle[pos] = vehicle_id;
+        res_of_vehicle[pos] = -1;
+    }
+
+    // One scan of the reservation table matches every vehicle in the batch
+    for (int i = 0; i < reservation_count; i++) {
+        if (strcmp(reservations[i].status, "active") != 0) continue;
+        int vehicle_id = reservations[i].vehicle_id;
+        int pos = (unsigned int)vehicle_id * 2654435761u % map_size;
+        while (key_of_vehicle[pos] != 0 && key_of_vehicle[pos] != vehicle_id) {
+            pos = (pos + 1) % map_size;
+        }
+        if (key_of_vehicle[pos] == vehicle_id) res_of_vehicle[pos] = i;
+    }
+
+    for (int e = 0; e < count; e++) {
+        if (vehicle_of[e] == -1) {
+            stats->unknown_plate++;
+            continue;
+        }
+        int vehicle_id = vehicles[vehicle_of[e]].vehicle_id;
+        int pos = (unsigned int)vehicle_id * 2654435761u % map_size;
+        while (key_of_vehicle[pos] != vehicle_id) pos = (pos + 1) % map_size;
+
+        int res_index = res_of_vehicle[pos];
+        int slot_index = res_index != -1 ? find_slot_index(reservations[res_index].slot_id) : -1;
+        if (slot_index == -1) {
+            stats->no_reservation++;
+            continue;
+        }
+
+        Slot *slot = &slots[slot_index];
+        if (!events[e].is_exit) {
+            // Entry: reserved -> occupied; a paid slot is occupied already
+            if (strcmp(slot->status, "reserved") == 0) {
+                set_slot_state(slot_index, "occupied", slot->vehicle_id, slot->user_id, slot->reserved_time);
+                stats->applied++;
+            } else if (strcmp(slot->status, "occupied") == 0 && slot->vehicle_id == vehicle_id) {
+                stats->applied++;
+            } else {
+                stats->ignored++;
+            }
+        } else {
+            // Exit: slot back to the free pool, reservation completed
+            if (strcmp(slot->status, "available") != 0) {
+                set_slot_state(slot_index, "available", 0, 0, 0);
+                set_reservation_status(res_index, "completed", events[e].event_time);
+                res_of_vehicle[pos] = -1;
+                stats->applied++;
+            } else {
+                stats->ignored++;
+            }
+        }
+    }
+
+    journal_commit();
+    latency_record(METRIC_ANPR_BATCH, started, 0);
+    if (capture_file != NULL) capture_plates(events, count, started, stats->applied);
+    return stats->applied;
+}
+
+// Parse "ENTRY <plate> [time]" or "EXIT <plate> [time]"; returns 0 for other lines
+static int parse_plate_event(const char *line, PlateEvent *event) {
+    char kind[16], when[20];
+    int fields = sscanf(line, "%15s %19s %19s", kind, event->plate, when);
+    if (fields < 2) return 0;
+
+    if (strcasecmp(kind, "ENTRY") == 0 || strcasecmp(kind, "IN") == 0) {
+        event->is_exit = 0;
+    } else if (strcasecmp(kind, "EXIT") == 0 || strcasecmp(kind, "OUT") == 0) {
+        event->is_exit = 1;
+    } else {
+        return 0;
+    }
+
+    event->event_time = fields == 3 ? parse_time(when) : 0;
+    if (event->event_time == 0) event->event_time = now_epoch();
+    return 1;
+}
+
+static void anpr_flush_batch(PlateEvent *batch, int *batch_count, int *batch_number) {
+    if (*batch_count == 0) return;
+
+    IngestStats stats;
+    ingest_plate_events(batch, *batch_count, &stats);
+    (*batch_number)++;
+    printf("Batch %d: %d events | applied %d | unknown plate %d | no reservation %d | ignored %d\n",
+           *batch_number, *batch_count, stats.applied, stats.unknown_plate,
+           stats.no_reservation, stats.ignored);
+    fflush(stdout);
+    *batch_count = 0;
+
+    if (journal_records_since_checkpoint >= JOURNAL_CHECKPOINT_RECORDS) {
+        save_data();
+    }
+}
+
+// Follow a FIFO or a growing file of camera reads until a QUIT line.
+// A batch is applied when it fills up or when the input goes quiet.
+void anpr_tail_mode(const char *path) {
+#ifdef _WIN32
+    int fd = open(path, O_RDONLY);
+#else
+    int fd = open(path, O_RDONLY | O_NONBLOCK);
+#endif
+    if (fd < 0) {
+        printf("Cannot open ANPR event source: %s\n", path);
+        return;
+    }
+
+    PlateEvent batch[ANPR_BATCH_MAX];
+    int batch_count = 0, batch_number = 0;
+    char buffer[8192];
+    int used = 0, running = 1;
+
+    printf("Reading ANPR events from %s (send QUIT to stop)\n", path);
+    fflush(stdout);
+
+    while (running) {
+        int n = read(fd, buffer + used, sizeof(buffer) - 1 - used);
+        if (n <= 0) {
+            // Nothing new: apply what we have and wait for more reads
+            anpr_flush_batch(batch, &batch_count, &batch_number);
+            latency_tick();
+            metrics_tick();
+            timers_advance(now_epoch());
+            sleep_ms(ANPR_POLL_MS);
+            continue;
+        }
+        used += n;
+        buffer[used] = '\0';
+
+        char *line = buffer;
+        char *newline;
+        while ((newline = strchr(line, '\n')) != NULL) {
+            *newline = '\0';
+            if (strncmp(line, "QUIT", 4) == 0) {
+                running = 0;
+                break;
+            }
+            if (parse_plate_event(line, &batch[batch_count])) {
+                batch_count++;
+                if (batch_count == ANPR_BATCH_MAX) {
+                    anpr_flush_batch(batch, &batch_count, &batch_number);
+                }
+            }
+            line = newline + 1;
+        }
+
+        // Keep a partial trailing line for the next read
+        used = (int)strlen(line);
+        memmove(buffer, line, used);
+        if (used == (int)sizeof(buffer) - 1) used = 0; // overlong line, drop it
+    }
+
+    anpr_flush_batch(batch, &batch_count, &batch_number);
+    close(fd);
+}
+
+// Engine Operations
+// Non-interactive core of the booking flows. Each call validates its input,
+// updates the tables and journals the change; callers decide how to report
+// the result and when to persist.
+const char *engine_error_text(int code) {
+    switch (code) {
+        case ENGINE_ERR_NOT_FOUND: return "Record not found";
+        case ENGINE_ERR_DUPLICATE_PHONE: return "Phone number already registered";
+        case ENGINE_ERR_DUPLICATE_EMAIL: return "Email already registered";
+        case ENGINE_ERR_FULL: return "Table is full";
+        case ENGINE_ERR_INVALID: return "Invalid input";
+        case ENGINE_ERR_UNAVAILABLE: return "Slot not available";
+        case ENGINE_ERR_STATE: return "Operation not allowed in current state";
+        default: return "OK";
+    }
+}
+
+static void copy_field(char *dst, int size, const char *src) {
+    int len = (int)strlen(src);
+    if (len > size - 1) len = size - 1;
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+}
+
+int find_user_index(int user_id) {
+    if (user_id >= 1 && user_id <= user_count && users[user_id - 1].user_id == user_id) {
+        return user_id - 1;
+    }
+    for (int i = 0; i < user_count; i++) {
+        if (users[i].user_id == user_id) return i;
+    }
+    return -1;
+}
+
+int find_vehicle_index(int vehicle_id) {
+    if (vehicle_id >= 1 && vehicle_id <= vehicle_count && vehicles[vehicle_id - 1].vehicle_id == vehicle_id) {
+        return vehicle_id - 1;
+    }
+    for (int i = 0; i < vehicle_count; i++) {
+        if (vehicles[i].vehicle_id == vehicle_id) return i;
+    }
+    return -1;
+}
+
+// The rate a booking made now would be charged
+double slot_hourly_rate(const char *type) {
+    return pricing_quote(slot_type_code(type));
+}
+
+int reservation_is_paid(int reservation_id) {
+    for (int j = 0; j < payment_count; j++) {
+        if (payments[j].reservation_id == reservation_id &&
+            strcmp(payments[j].status, "completed") == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Returns the new user's index or an ENGINE_ERR_* code
+static int register_user_row(const char *name, const char *phone, const char *email, const char *password) {
+    if (name[0] == '\0' || password[0] == '\0' ||
+        phone_problem(phone) != NULL || email_problem(email) != NULL) {
+        return ENGINE_ERR_INVALID;
+    }
+    for (int i = 0; i < user_count; i++) {
+        if (strcmp(users[i].phone, phone) == 0) return ENGINE_ERR_DUPLICATE_PHONE;
+        if (strcmp(users[i].email, email) == 0) return ENGINE_ERR_DUPLICATE_EMAIL;
+    }
+    if (user_count >= MAX_USERS) return ENGINE_ERR_FULL;
+
+    User *user = &users[user_count];
+    user->user_id = get_next_user_id();
+    copy_field(user->name, sizeof(user->name), name);
+    copy_field(user->phone, sizeof(user->phone), phone);
+    copy_field(user->email, sizeof(user->email), email);
+    copy_field(user->password, sizeof(user->password), password);
+    user->reg_date = now_epoch();
+    user->is_active = 1;
+    user_count++;
+
+    char when[TIME_TEXT_SIZE];
+    journal_append("U %d %s %s %s %s %s %d\n", user->user_id, user->name, user->phone,
+                   user->email, user->password, format_time(user->reg_date, when), user->is_active);
+    return user_count - 1;
+}
+
+// With the record store, appends hold the file's header lock so ids and
+// duplicate checks see rows added by other processes
+int engine_register_user(const char *name, const char *phone, const char *email, const char *password) {
+    double started = monotonic_us();
+    record_store_begin_append('U');
+    int result = register_user_row(name, phone, email, password);
+    if (result >= 0) record_store_put('U', result);
+    record_store_end_append('U');
+    latency_record(METRIC_REGISTER, started, result < 0);
+    if (capture_file != NULL) capture_call(TRACE_REGISTER, started, result, "ssss", name, phone, email, password);
+    return result;
+}
+
+// Returns the user id for valid credentials of an active account, -1 otherwise
+int engine_login(const char *phone, const char *password) {
+    double started = monotonic_us();
+    int user_id = -1;
+    record_store_pull('U');
+    for (int i = 0; i < user_count; i++) {
+        if (strcmp(users[i].phone, phone) == 0 &&
+            strcmp(users[i].password, password) == 0 &&
+            users[i].is_active == 1) {
+            user_id = users[i].user_id;
+            break;
+        }
+    }
+    latency_record(METRIC_LOGIN, started, user_id < 0);
+    if (capture_file != NULL) capture_call(TRACE_LOGIN, started, user_id, "ss", phone, password);
+    return user_id;
+}
+
+static int add_vehicle_row(int user_id, const char *type, const char *plate, const char *color) {
+    if (strcmp(type, "bike") != 0 && strcmp(type, "car") != 0 && strcmp(type, "truck") != 0) {
+        return ENGINE_ERR_INVALID;
+    }
+    if (plate[0] == '\0' || find_user_index(user_id) == -1) return ENGINE_ERR_INVALID;
+    if (vehicle_count >= MAX_VEHICLES) return ENGINE_ERR_FULL;
+
+    Vehicle *vehicle = &vehicles[vehicle_count];
+    vehicle->vehicle_id = get_next_vehicle_id();
+    vehicle->user_id = user_id;
+    copy_field(vehicle->type, sizeof(vehicle->type), type);
+    copy_field(vehicle->license_plate, sizeof(vehicle->license_plate), plate);
+    copy_field(vehicle->color, sizeof(vehicle->color), color[0] ? color : "-");
+    vehicle->reg_date = now_epoch();
+    vehicle_count++;
+
+    char when[TIME_TEXT_SIZE];
+    journal_append("V %d %d %s %s %s %s\n", vehicle->vehicle_id, vehicle->user_id, vehicle->type,
+                   vehicle->license_plate, vehicle->color, format_time(vehicle->reg_date, when));
+    return vehicle_count - 1;
+}
+
+int engine_add_vehicle(int user_id, const char *type, const char *plate, const char *color) {
+    double started = monotonic_us();
+    record_store_begin_append('V');
+    int result = add_vehicle_row(user_id, type, plate, color);
+    if (result >= 0) record_store_put('V', result);
+    record_store_end_append('V');
+    latency_record(METRIC_ADD_VEHICLE, started, result < 0);
+    if (capture_file != NULL) capture_call(TRACE_ADD_VEHICLE, started, result, "isss", user_id, type, plate, color);
+    return result;
+}
+
+// Reserve slot_id for one of the user's vehicles. Returns the reservation index.
+static int reserve_row(int user_id, int vehicle_id, int slot_id, double duration) {
+    int vehicle_index = find_vehicle_index(vehicle_id);
+    if (vehicle_index == -1 || vehicles[vehicle_index].user_id != user_id) return ENGINE_ERR_NOT_FOUND;
+    if (duration <= 0 || duration > 24) return ENGINE_ERR_INVALID;
+
+    int slot_index = find_slot_index(slot_id);
+    if (slot_index == -1) return ENGINE_ERR_NOT_FOUND;
+    if (strcmp(slots[slot_index].type, vehicles[vehicle_index].type) != 0 ||
+        strcmp(slots[slot_index].status, "available") != 0) {
+        return ENGINE_ERR_UNAVAILABLE;
+    }
+    if (reservation_count >= MAX_RESERVATIONS) return ENGINE_ERR_FULL;
+    // Another kiosk process may have taken the slot since the check above
+    if (!slot_claim(slot_index)) return ENGINE_ERR_UNAVAILABLE;
+
+    Reservation *res = &reservations[reservation_count];
+    res->reservation_id = get_next_reservation_id();
+    res->user_id = user_id;
+    res->slot_id = slot_id;
+    res->vehicle_id = vehicle_id;
+    res->duration_hours = duration;
+    res->start_time = now_epoch();
+    res->end_time = 0;
+    strcpy(res->status, "active");
+    res->total_amount = pricing_booking_amount(slot_type_code(slots[slot_index].type), duration);
+    reservation_count++;
+
+    char when[TIME_TEXT_SIZE];
+    journal_append("N %d %d %d %d %s - %s %.2f %.2f\n", res->reservation_id, res->user_id,
+                   res->slot_id, res->vehicle_id, format_time(res->start_time, when), res->status,
+                   res->duration_hours, res->total_amount);
+    set_slot_state(slot_index, "reserved", vehicle_id, user_id, res->start_time);
+    reservation_paid[reservation_count - 1] = 0;
+    reservation_timers_track(reservation_count - 1);
+    return reservation_count - 1;
+}
+
+int engine_reserve(int user_id, int vehicle_id, int slot_id, double duration) {
+    timers_advance(now_epoch()); // lapsed holds go back to the free pool first
+    double started = monotonic_us();
+    record_store_pull('V');
+    record_store_begin_append('N');
+    int result = reserve_row(user_id, vehicle_id, slot_id, duration);
+    if (result >= 0) record_store_put('N', result);
+    record_store_end_append('N');
+    latency_record(METRIC_RESERVE, started, result < 0);
+    if (capture_file != NULL) {
+        capture_call(TRACE_RESERVE, started, result, "iiid", user_id, vehicle_id, slot_id, duration);
+    }
+    return result;
+}
+
+// Cancel an active reservation; user_id -1 acts for the administrator
+static int cancel_row(int user_id, int reservation_id) {
+    int index = find_reservation_index(reservation_id);
+    if (index == -1 || (user_id != -1 && reservations[index].user_id != user_id)) {
+        return ENGINE_ERR_NOT_FOUND;
+    }
+    if (strcmp(reservations[index].status, "active") != 0) return ENGINE_ERR_STATE;
+
+    set_reservation_status(index, "cancelled", now_epoch());
+
+    int slot_index = find_slot_index(reservations[index].slot_id);
+    if (slot_index != -1) {
+        set_slot_state(slot_index, "available", 0, 0, 0);
+    }
+    return ENGINE_OK;
+}
+
+// The reservation row stays write-locked from the status check to the update
+int engine_cancel(int user_id, int reservation_id) {
+    double started = monotonic_us();
+    record_store_lock_row('N', reservation_id);
+    int result = cancel_row(user_id, reservation_id);
+    record_store_unlock_row('N');
+    latency_record(METRIC_CANCEL, started, result < 0);
+    if (capture_file != NULL) capture_call(TRACE_CANCEL, started, result, "ii", user_id, reservation_id);
+    return result;
+}
+
+// Pay for an active reservation. Returns the payment index.
+static int pay_row(int user_id, int reservation_id, const char *method) {
+    if (strcmp(method, "cash") != 0 && strcmp(method, "card") != 0 &&
+        strcmp(method, "bkash") != 0 && strcmp(method, "nagad") != 0) {
+        return ENGINE_ERR_INVALID;
+    }
+    int index = find_reservation_index(reservation_id);
+    if (index == -1 || reservations[index].user_id != user_id) return ENGINE_ERR_NOT_FOUND;
+    if (strcmp(reservations[index].status, "active") != 0 || reservation_is_paid(reservation_id)) {
+        return ENGINE_ERR_STATE;
+    }
+    if (payment_count >= MAX_PAYMENTS) return ENGINE_ERR_FULL;
+
+    Payment *payment = &payments[payment_count];
+    payment->payment_id = get_next_payment_id();
+    payment->user_id = user_id;
+    payment->reservation_id = reservation_id;
+    payment->amount = reservations[index].total_amount;
+    strcpy(payment->method, method);
+    strcpy(payment->status, "completed");
+    payment->payment_date = now_epoch();
+    payment_count++;
+
+    char when[TIME_TEXT_SIZE];
+    journal_append("P %d %d %d %.2f %s %s %s\n", payment->payment_id, payment->user_id,
+                   payment->reservation_id, payment->amount, payment->method,
+                   format_time(payment->payment_date, when), payment->status);
+
+    reservation_timers_paid(reservation_id); // paid holds are not released
+
+    // Paid slots are held as occupied
+    int slot_index = find_slot_index(reservations[index].slot_id);
+    if (slot_index != -1) {
+        set_slot_state(slot_index, "occupied", slots[slot_index].vehicle_id,
+                       slots[slot_index].user_id, slots[slot_index].reserved_time);
+    }
+    return payment_count - 1;
+}
+
+// Books the nearest free slot that fits the vehicle, on `level` if one is
+// free there. A slot another kiosk claims first is skipped and the next is tried.
+int engine_reserve_nearest(int user_id, int vehicle_id, int level, double duration) {
+    timers_advance(now_epoch()); // lapsed holds first, so their slots can be picked
+    record_store_pull('V');
+    int vehicle_index = find_vehicle_index(vehicle_id);
+    if (vehicle_index == -1 || vehicles[vehicle_index].user_id != user_id) return ENGINE_ERR_NOT_FOUND;
+    int type = slot_type_code(vehicles[vehicle_index].type);
+    int result = ENGINE_ERR_UNAVAILABLE;
+    for (int attempt = 0; attempt < ASSIGN_RETRIES && result == ENGINE_ERR_UNAVAILABLE; attempt++) {
+        int slot_id = slot_pick_nearest(type, level);
+        if (slot_id == 0) break;
+        result = engine_reserve(user_id, vehicle_id, slot_id, duration);
+    }
+    return result;
+}
+
+int engine_pay(int user_id, int reservation_id, const char *method) {
+    double started = monotonic_us();
+    record_store_lock_row('N', reservation_id);
+    record_store_begin_append('P'); // also pulls payments made elsewhere
+    int result = pay_row(user_id, reservation_id, method);
+    if (result >= 0) record_store_put('P', result);
+    record_store_end_append('P');
+    record_store_unlock_row('N');
+    if (result >= 0) payment_amount_total += payments[result].amount;
+    latency_record(METRIC_PAY, started, result < 0);
+    if (capture_file != NULL) capture_call(TRACE_PAY, started, result, "iis", user_id, reservation_id, method);
+    return result;
+}
+
+// Session State Machines
+// The console menus block on getch/scanf. Sessions run the same booking
+// flows as resumable state machines: input lines are pushed in, the session
+// advances one screen and writes the next prompt, then goes back to waiting.
+
+// Sends as much queued output as the non-blocking socket takes; the server
+// loop polls for POLLOUT while anything is left
+void session_flush(Session *session) {
+#ifndef _WIN32
+    int sent = 0;
+    while (sent < session->output_length) {
+        int n = (int)send(session->out_fd, session->output + sent, session->output_length - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            session->output_length = 0;
+            session->state = SESSION_CLOSED;
+            return;
+        }
+    }
+    memmove(session->output, session->output + sent, session->output_length - sent);
+    session->output_length -= sent;
+#else
+    session->output_length = 0;
+#endif
+}
+
+static void session_write(Session *session, const char *format, ...) {
+    char text[1024];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (len < 0 || session->state == SESSION_CLOSED) return;
+    if (len >= (int)sizeof(text)) len = sizeof(text) - 1;
+
+    // Clients are queued so one that stops reading cannot stall the others
+    if (session->is_socket) {
+        if (session->output_length + len > SESSION_OUTPUT_MAX) {
+            session->output_length = 0;
+            session->state = SESSION_CLOSED;
+            return;
+        }
+        memcpy(session->output + session->output_length, text, len);
+        session->output_length += len;
+        session_flush(session);
+        return;
+    }
+
+    int sent = 0;
+    while (sent < len) {
+        int n = (int)write(session->out_fd, text + sent, len - sent);
+        if (n <= 0) {
+            session->state = SESSION_CLOSED;
+            return;
+        }
+        sent += n;
+    }
+}
+
+// Make every change from the step durable before the next input is read
+static void session_persist() {
+    if (journal_pending_records == 0) return;
+    journal_commit();
+    if (journal_records_since_checkpoint >= JOURNAL_CHECKPOINT_RECORDS) {
+        save_data();
+    }
+}
+
+static void session_prompt(Session *session) {
+    switch (session->state) {
+        case SESSION_MAIN_MENU:
+            session_write(session, "\n*** SMART PARK ***\n1. Register Customer\n2. User Login\n3. Exit\nEnter choice: ");
+            break;
+        case SESSION_REGISTER_NAME: session_write(session, "Enter your full name: "); break;
+        case SESSION_REGISTER_PHONE: session_write(session, "Enter phone number (11 digits): "); break;
+        case SESSION_REGISTER_EMAIL: session_write(session, "Enter email address: "); break;
+        case SESSION_REGISTER_PASSWORD: session_write(session, "Create a password: "); break;
+        case SESSION_LOGIN_PHONE: session_write(session, "Enter phone number: "); break;
+        case SESSION_LOGIN_PASSWORD: session_write(session, "Enter password: "); break;
+        case SESSION_USER_MENU:
+            session_write(session, "\n*** USER DASHBOARD ***\n1. Add Vehicle\n2. View Available Slots\n"
+                                   "3. Reserve Slot\n4. Cancel Reservation\n5. Make Payment\n"
+                                   "6. View Booking History\n7. Logout\nEnter choice: ");
+            break;
+        case SESSION_VEHICLE_TYPE: session_write(session, "Vehicle type (bike/car/truck): "); break;
+        case SESSION_VEHICLE_PLATE: session_write(session, "License plate: "); break;
+        case SESSION_VEHICLE_COLOR: session_write(session, "Vehicle color: "); break;
+        case SESSION_RESERVE_VEHICLE: session_write(session, "Vehicle ID (0 = back): "); break;
+        case SESSION_RESERVE_SLOT: session_write(session, "Slot number (0 = nearest): "); break;
+        case SESSION_RESERVE_HOURS: session_write(session, "Parking duration (hours): "); break;
+        case SESSION_CANCEL_SELECT: session_write(session, "Reservation ID to cancel (0 = back): "); break;
+        case SESSION_PAY_SELECT: session_write(session, "Reservation ID to pay (0 = back): "); break;
+        case SESSION_PAY_METHOD: session_write(session, "Payment method (cash/card/bkash/nagad): "); break;
+        default: break;
+    }
+}
+
+static void session_show_slots(Session *session, const char *type) {
+    int shown = 0;
+    char row[128];
+    int used = 0;
+
+    for (int i = 0; i < slot_count; i++) {
+        if (strcmp(slots[i].status, "available") != 0) continue;
+        if (type != NULL && strcmp(slots[i].type, type) != 0) continue;
+        used += sprintf(row + used, "%03d ", slots[i].slot_id);
+        if (++shown % 10 == 0) {
+            session_write(session, "%s\n", row);
+            used = 0;
+        }
+    }
+    if (used > 0) session_write(session, "%s\n", row);
+    if (shown == 0) session_write(session, "No available slots.\n");
+}
+
+static void session_show_user_slots(Session *session) {
+    int available[3] = {0, 0, 0};
+    for (int i = 0; i < slot_count; i++) {
+        if (strcmp(slots[i].status, "available") != 0) continue;
+        if (strcmp(slots[i].type, "bike") == 0) available[0]++;
+        else if (strcmp(slots[i].type, "car") == 0) available[1]++;
+        else available[2]++;
+    }
+    session_show_slots(session, NULL);
+    session_write(session, "Available: Bike %d | Car %d | Truck %d\n",
+                  available[0], available[1], available[2]);
+    session_write(session, "Rates: Bike $%.2f/h | Car $%.2f/h | Truck $%.2f/h\n",
+                  pricing_quote(0), pricing_quote(1), pricing_quote(2));
+}
+
+// Lists the user's active reservations; unpaid_only narrows to ones awaiting payment
+static int session_list_reservations(Session *session, int unpaid_only) {
+    int listed = 0;
+    char when[TIME_TEXT_SIZE];
+    for (int i = 0; i < reservation_count; i++) {
+        if (reservations[i].user_id != session->user_id ||
+            strcmp(reservations[i].status, "active") != 0) continue;
+        if (unpaid_only && reservation_is_paid(reservations[i].reservation_id)) continue;
+        session_write(session, "Reservation %d - Slot %d - $%.2f (%.1fh) - %s\n",
+                      reservations[i].reservation_id, reservations[i].slot_id,
+                      reservations[i].total_amount, reservations[i].duration_hours,
+                      format_time(reservations[i].start_time, when));
+        listed++;
+    }
+    return listed;
+}
+
+static void session_user_menu_choice(Session *session, int choice) {
+    if (replica_mode && (choice == 1 || choice == 3 || choice == 4 || choice == 5)) {
+        session_write(session, "This is a read-only replica. Please make changes on the primary.\n");
+        return;
+    }
+    if (replica_mode && (choice == 2 || choice == 6) && replica_is_stale()) {
+        session_write(session, "Replica is out of date; please retry shortly or use the primary.\n");
+        return;
+    }
+
+    switch (choice) {
+        case 1:
+            session->state = SESSION_VEHICLE_TYPE;
+            break;
+        case 2:
+            session_show_user_slots(session);
+            break;
+        case 3: {
+            int listed = 0;
+            for (int i = 0; i < vehicle_count; i++) {
+                if (vehicles[i].user_id != session->user_id) continue;
+                session_write(session, "Vehicle %d: %s (%s) - %s\n", vehicles[i].vehicle_id,
+                              vehicles[i].license_plate, vehicles[i].color, vehicles[i].type);
+                listed++;
+            }
+            if (listed == 0) session_write(session, "Please add a vehicle first.\n");
+            else session->state = SESSION_RESERVE_VEHICLE;
+            break;
+        }
+        case 4:
+            if (session_list_reservations(session, 0) == 0) session_write(session, "No active reservations.\n");
+            else session->state = SESSION_CANCEL_SELECT;
+            break;
+        case 5:
+            if (session_list_reservations(session, 1) == 0) session_write(session, "No pending payments.\n");
+            else session->state = SESSION_PAY_SELECT;
+            break;
+        case 6:
+            for (int i = 0; i < reservation_count; i++) {
+                if (reservations[i].user_id != session->user_id) continue;
+                char started_at[TIME_TEXT_SIZE], ended_at[TIME_TEXT_SIZE];
+                session_write(session, "%d | Slot %d | %s | %s | %s | $%.2f\n",
+                              reservations[i].reservation_id, reservations[i].slot_id,
+                              format_time(reservations[i].start_time, started_at),
+                              reservations[i].end_time ? format_time(reservations[i].end_time, ended_at) : "Ongoing",
+                              reservations[i].status, reservations[i].total_amount);
+            }
+            break;
+        case 7:
+            session->user_id = -1;
+            session->state = SESSION_MAIN_MENU;
+            session_write(session, "Logged out successfully!\n");
+            break;
+        default:
+            session_write(session, "Invalid choice! Please try again.\n");
+    }
+}
+
+// Advance the session by one input line and prompt for the next
+void session_step(Session *session, const char *line) {
+    char token[SESSION_INPUT_MAX];
+    int result;
+
+    record_store_refresh();
+
+    // Single-line queries answer without disturbing the menu state. Only the
+    // read-only availability queries work before login; the router collects
+    // !REVENUE from this host without an account.
+    if (line[0] == '!') {
+        int open_query = strncmp(line, "!STATUS", 7) == 0 || strncmp(line, "!AVAIL", 6) == 0 ||
+                         strncmp(line, "!FREE ", 6) == 0 ||
+                         (strncmp(line, "!REVENUE", 8) == 0 && (session->is_console || session->is_loopback));
+        if (open_query || session->user_id >= 0) session_query(session, line);
+        else session_write(session, "ERR login required\n");
+        return;
+    }
+
+    if (sscanf(line, "%127s", token) != 1) token[0] = '\0';
+
+    switch (session->state) {
+        case SESSION_MAIN_MENU:
+            if (strcmp(token, "1") == 0 && replica_mode) {
+                session_write(session, "This is a read-only replica. Please register on the primary.\n");
+            } else if (strcmp(token, "1") == 0) session->state = SESSION_REGISTER_NAME;
+            else if (strcmp(token, "2") == 0) session->state = SESSION_LOGIN_PHONE;
+            else if (strcmp(token, "3") == 0) {
+                session_write(session, "Thank you for using SMART PARK System!\n");
+                session->state = SESSION_CLOSED;
+            } else session_write(session, "Invalid choice! Please try again.\n");
+            break;
+
+        case SESSION_REGISTER_NAME:
+            copy_field(session->step.reg.name, sizeof(session->step.reg.name), token);
+            session->state = SESSION_REGISTER_PHONE;
+            break;
+        case SESSION_REGISTER_PHONE:
+            if (phone_problem(token) != NULL) {
+                session_write(session, "%s\n", phone_problem(token));
+                break;
+            }
+            copy_field(session->step.reg.phone, sizeof(session->step.reg.phone), token);
+            session->state = SESSION_REGISTER_EMAIL;
+            break;
+        case SESSION_REGISTER_EMAIL:
+            if (email_problem(token) != NULL) {
+                session_write(session, "%s\n", email_problem(token));
+                break;
+            }
+            copy_field(session->step.reg.email, sizeof(session->step.reg.email), token);
+            session->state = SESSION_REGISTER_PASSWORD;
+            break;
+        case SESSION_REGISTER_PASSWORD:
+            result = engine_register_user(session->step.reg.name, session->step.reg.phone,
+                                          session->step.reg.email, token);
+            if (result < 0) {
+                session_write(session, "Registration failed: %s\n", engine_error_text(result));
+            } else {
+                session_persist();
+                session_write(session, "REGISTRATION SUCCESSFUL! Your Customer ID: %d\n",
+                              users[result].user_id);
+            }
+            session->state = SESSION_MAIN_MENU;
+            break;
+
+        case SESSION_LOGIN_PHONE:
+            copy_field(session->step.reg.phone, sizeof(session->step.reg.phone), token);
+            session->state = SESSION_LOGIN_PASSWORD;
+            break;
+        case SESSION_LOGIN_PASSWORD:
+            session->user_id = engine_login(session->step.reg.phone, token);
+            if (session->user_id == -1) {
+                session_write(session, "LOGIN FAILED! Invalid credentials or account deactivated.\n");
+                session->state = SESSION_MAIN_MENU;
+            } else {
+                session_write(session, "Welcome back, %s!\n", users[find_user_index(session->user_id)].name);
+                session->state = SESSION_USER_MENU;
+            }
+            break;
+
+        case SESSION_USER_MENU:
+            session_user_menu_choice(session, atoi(token));
+            break;
+
+        case SESSION_VEHICLE_TYPE:
+            copy_field(session->step.vehicle.type, sizeof(session->step.vehicle.type), token);
+            session->state = SESSION_VEHICLE_PLATE;
+            break;
+        case SESSION_VEHICLE_PLATE:
+            copy_field(session->step.vehicle.plate, sizeof(session->step.vehicle.plate), token);
+            session->state = SESSION_VEHICLE_COLOR;
+            break;
+        case SESSION_VEHICLE_COLOR:
+            result = engine_add_vehicle(session->user_id, session->step.vehicle.type,
+                                        session->step.vehicle.plate, token);
+            if (result < 0) {
+                session_write(session, "Vehicle registration failed: %s\n", engine_error_text(result));
+            } else {
+                session_persist();
+                session_write(session, "VEHICLE REGISTERED! Vehicle ID: %d\n", vehicles[result].vehicle_id);
+            }
+            session->state = SESSION_USER_MENU;
+            break;
+
+        case SESSION_RESERVE_VEHICLE: {
+            int vehicle_index = find_vehicle_index(atoi(token));
+            if (atoi(token) == 0) {
+                session->state = SESSION_USER_MENU;
+            } else if (vehicle_index == -1 || vehicles[vehicle_index].user_id != session->user_id) {
+                session_write(session, "Invalid vehicle selection!\n");
+            } else {
+                session->step.reserve.vehicle_id = vehicles[vehicle_index].vehicle_id;
+                session_show_slots(session, vehicles[vehicle_index].type);
+                session->state = SESSION_RESERVE_SLOT;
+            }
+            break;
+        }
+        case SESSION_RESERVE_SLOT:
+            session->step.reserve.slot_id = atoi(token);
+            session->state = SESSION_RESERVE_HOURS;
+            break;
+        case SESSION_RESERVE_HOURS:
+            if (session->step.reserve.slot_id == 0) {
+                result = engine_reserve_nearest(session->user_id, session->step.reserve.vehicle_id, LEVEL_ANY,
+                                                atof(token));
+            } else {
+                result = engine_reserve(session->user_id, session->step.reserve.vehicle_id,
+                                        session->step.reserve.slot_id, atof(token));
+            }
+            if (result < 0) {
+                session_write(session, "Reservation failed: %s\n", engine_error_text(result));
+            } else {
+                char location[64];
+                session_persist();
+                session_write(session, "RESERVATION CONFIRMED! ID %d - Slot %d (%s) - Total $%.2f\n",
+                              reservations[result].reservation_id, reservations[result].slot_id,
+                              slot_location(find_slot_index(reservations[result].slot_id), location),
+                              reservations[result].total_amount);
+                if (hold_ttl_seconds > 0) {
+                    session_write(session, "Pay within %d minutes or the slot is released.\n",
+                                  hold_ttl_seconds / 60);
+                }
+            }
+            session->state = SESSION_USER_MENU;
+            break;
+
+        case SESSION_CANCEL_SELECT:
+            if (atoi(token) != 0) {
+                result = engine_cancel(session->user_id, atoi(token));
+                if (result < 0) {
+                    session_write(session, "Cancellation failed: %s\n", engine_error_text(result));
+                } else {
+                    session_persist();
+                    session_write(session, "RESERVATION CANCELLED SUCCESSFULLY!\n");
+                }
+            }
+            session->state = SESSION_USER_MENU;
+            break;
+
+        case SESSION_PAY_SELECT:
+            session->step.reservation_id = atoi(token);
+            session->state = session->step.reservation_id != 0 ? SESSION_PAY_METHOD : SESSION_USER_MENU;
+            break;
+        case SESSION_PAY_METHOD:
+            result = engine_pay(session->user_id, session->step.reservation_id, token);
+            if (result < 0) {
+                session_write(session, "Payment failed: %s\n", engine_error_text(result));
+            } else {
+                session_persist();
+                session_write(session, "PAYMENT SUCCESSFUL! Payment ID %d - $%.2f via %s\n",
+                              payments[result].payment_id, payments[result].amount,
+                              payments[result].method);
+            }
+            session->state = SESSION_USER_MENU;
+            break;
+
+        default:
+            break;
+    }
+
+    session_prompt(session);
+}
+
+Session *session_open(int in_fd, int out_fd, int is_socket) {
+    Session *session = (Session *)calloc(1, sizeof(Session));
+    if (session == NULL) return NULL;
+    session->in_fd = in_fd;
+    session->out_fd = out_fd;
+    session->is_socket = (unsigned char)is_socket;
+#ifndef _WIN32
+    if (is_socket) fcntl(in_fd, F_SETFL, fcntl(in_fd, F_GETFL, 0) | O_NONBLOCK);
+#endif
+    session->user_id = -1;
+    session->state = SESSION_MAIN_MENU;
+    session_prompt(session);
+    return session;
+}
+
+// Split raw input into lines; each complete line drives one step
+void session_feed(Session *session, const char *data, int length) {
+    for (int i = 0; i < length && session->state != SESSION_CLOSED; i++) {
+        char ch = data[i];
+        if (ch == '\r') continue;
+        if (ch == '\n') {
+            session->input[session->input_length] = '\0';
+            session->input_length = 0;
+            session_step(session, session->input);
+        } else if (session->input_length < SESSION_INPUT_MAX - 1) {
+            session->input[session->input_length++] = ch;
+        }
+    }
+}
+
+#ifndef _WIN32
+static volatile sig_atomic_t server_running = 1;
+
+static void server_stop_signal(int sig) {
+    (void)sig;
+    server_running = 0;
+}
+#endif
+
+// One thread multiplexes the listening socket, every connected session and
+// the local console. Exiting the console session stops the server.
+void session_server(int port) {
+#ifdef _WIN32
+    printf("Session server is only available in POSIX builds.\n");
+    (void)port;
+#else
+    Session *sessions[SESSION_MAX];
+    struct pollfd fds[SESSION_MAX + 2 + REPLICA_MAX];
+    int session_total = 0;
+    int poll_ms = replication_poll_fd() >= 0 || replica_mode ? REPLICA_HEARTBEAT_MS : SESSION_POLL_MS;
+
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (listener < 0 || inet_pton(AF_INET, listen_address, &addr.sin_addr) != 1 ||
+        bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listener, 64) != 0) {
+        printf("Cannot listen on %s port %d\n", listen_address, port);
+        if (listener >= 0) close(listener);
+        return;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, server_stop_signal);
+    signal(SIGTERM, server_stop_signal);
+    printf("SMART PARK session server listening on %s port %d\n", listen_address, port);
+    fflush(stdout);
+
+    sessions[session_total] = session_open(STDIN_FILENO, STDOUT_FILENO, 0);
+    if (sessions[session_total] != NULL) {
+        sessions[session_total]->is_console = 1;
+        session_total++;
+    }
+
+    while (server_running) {
+        fds[0].fd = listener;
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        fds[1].fd = replication_poll_fd(); // negative when not replicating
+        fds[1].events = POLLIN;
+        fds[1].revents = 0;
+        for (int i = 0; i < session_total; i++) {
+            fds[i + 2].fd = sessions[i]->in_fd;
+            fds[i + 2].events = sessions[i]->output_length > 0 ? POLLIN | POLLOUT : POLLIN;
+            fds[i + 2].revents = 0;
+        }
+
+        int replica_polls = replication_poll_out(fds + session_total + 2);
+        int ready = poll(fds, session_total + 2 + replica_polls, poll_ms);
+        replication_tick();
+        latency_tick();
+        metrics_tick();
+        timers_advance(now_epoch());
+        if (ready <= 0) continue;
+
+        if (fds[1].revents & (POLLIN | POLLHUP | POLLERR)) replication_service();
+
+        // Sessions accepted below have no poll result yet
+        int polled = session_total;
+        if (fds[0].revents & POLLIN) {
+            struct sockaddr_in peer;
+            socklen_t peer_length = sizeof(peer);
+            int client = accept(listener, (struct sockaddr *)&peer, &peer_length);
+            if (client >= 0 && session_total < SESSION_MAX) {
+                Session *session = session_open(client, client, 1);
+                if (session != NULL) {
+                    session->is_loopback = (ntohl(peer.sin_addr.s_addr) >> 24) == 127;
+                    sessions[session_total++] = session;
+                } else {
+                    close(client);
+                }
+            } else if (client >= 0) {
+                close(client);
+            }
+        }
+
+        for (int i = 0; i < polled; i++) {
+            if (fds[i + 2].revents & POLLOUT) session_flush(sessions[i]);
+            if (!(fds[i + 2].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            char data[512];
+            int n = (int)read(sessions[i]->in_fd, data, sizeof(data));
+            if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) continue;
+            if (n <= 0) {
+                sessions[i]->is_console = 0; // EOF only drops the session
+                sessions[i]->state = SESSION_CLOSED;
+            } else {
+                session_feed(sessions[i], data, n);
+            }
+        }
+
+        // Drop finished sessions, keeping the array packed
+        int kept = 0;
+        for (int i = 0; i < session_total; i++) {
+            if (sessions[i]->state != SESSION_CLOSED) {
+                sessions[kept++] = sessions[i];
+                continue;
+            }
+            if (sessions[i]->is_console) server_running = 0; // console chose Exit
+            if (sessions[i]->is_socket) {
+                session_flush(sessions[i]); // a last try for the goodbye text
+                close(sessions[i]->in_fd);
+            }
+            free(sessions[i]);
+        }
+        session_total = kept;
+    }
+
+    for (int i = 0; i < session_total; i++) {
+        if (sessions[i]->is_socket) close(sessions[i]->in_fd);
+        free(sessions[i]);
+    }
+    close(listener);
+    if (!replica_mode) journal_commit();
+#endif
+}
+
+// Multi-Lot Federation
+// Each lot is its own engine process (--lot <id> --serve <port>) owning the
+// files in lot_<id>/. The router keeps no state of its own: it relays a
+// client to one lot, or sends a query to every lot and adds up the replies.
+
+// Machine-readable replies start with "OK " so the router can pick them out
+// of the menu text that precedes them
+void session_query(Session *session, const char *line) {
+    if (strncmp(line, "!STATUS", 7) == 0) {
+        session_write(session, "OK STATUS %d %s %d %lld\n", lot_id, replica_mode ? "replica" : "primary",
+                      replica_mode ? upstream_seq : journal_seq,
+                      replica_mode ? monotonic_ms() - upstream_heard_ms : 0LL);
+    } else if (replica_mode && replica_is_stale()) {
+        session_write(session, "ERR stale replica\n");
+    } else if (strncmp(line, "!AVAIL", 6) == 0) {
+        int available[3] = {0, 0, 0};
+        for (int i = 0; i < slot_count; i++) {
+            if (strcmp(slots[i].status, "available") != 0) continue;
+            if (strcmp(slots[i].type, "bike") == 0) available[0]++;
+            else if (strcmp(slots[i].type, "car") == 0) available[1]++;
+            else available[2]++;
+        }
+        session_write(session, "OK AVAIL %d %d %d %d\n", lot_id,
+                      available[0], available[1], available[2]);
+    } else if (strncmp(line, "!REVENUE", 8) == 0) {
+        ReportTotals totals;
+        compute_report_totals(-1, &totals);
+        session_write(session, "OK REVENUE %d %.2f %d\n", lot_id,
+                      totals.total_revenue, totals.completed_payments);
+    } else if (strncmp(line, "!FREE ", 6) == 0) {
+        char reply[SESSION_REPLY_MAX];
+        format_free_slots(line + 6, reply, sizeof(reply));
+        session_write(session, "%s\n", reply);
+    } else if (strncmp(line, "!DO ", 4) == 0) {
+        // One batch-script command per line, for load generators and tests.
+        // Off unless --allow-do, only from this host, and never as admin.
+        char result[256], verb[16], actor[16];
+        const char *command = line + 4;
+        while (isspace((unsigned char)*command)) command++;
+        if (!script_queries_enabled || !(session->is_console || session->is_loopback)) {
+            session_write(session, "ERR !DO is not enabled\n");
+            return;
+        }
+        if (*command == '\0') {
+            session_write(session, "ERR empty command\n");
+            return;
+        }
+        if (!session->is_console && sscanf(command, "%15s %15s", verb, actor) == 2 &&
+            strcmp(verb, "cancel") == 0 && strcmp(actor, "admin") == 0) {
+            session_write(session, "ERR admin commands are console only\n");
+            return;
+        }
+        if (replica_mode) {
+            session_write(session, "ERR read-only replica\n");
+            return;
+        }
+        int code = script_command(command, result);
+        session_persist();
+        session_write(session, "%s %s\n", code < 0 ? "ERR" : "OK", result);
+    } else {
+        session_write(session, "ERR unknown query\n");
+    }
+}
+
+// "OK FREE <type> <id> ..." listing at most SESSION_FREE_LIST available slots
+int format_free_slots(const char *type, char *reply, int size) {
+    int listed = 0;
+    timers_advance(now_epoch());
+    int length = snprintf(reply, size, "OK FREE %s", type);
+    for (int i = 0; i < slot_count && listed < SESSION_FREE_LIST && length < size - 8; i++) {
+        if (strcmp(slots[i].type, type) != 0 || strcmp(slots[i].status, "available") != 0) continue;
+        length += snprintf(reply + length, size - length, " %d", slots[i].slot_id);
+        listed++;
+    }
+    return listed;
+}
+
+int enter_lot_directory(int id) {
+    char path[32];
+    sprintf(path, LOT_DIR_FORMAT, id);
+#ifdef _WIN32
+    _mkdir(path);
+    return _chdir(path);
+#else
+    mkdir(path, 0755);
+    return chdir(path);
+#endif
+}
+
+// Parses "1=7001,2=7002" into the route table; returns the route count
+int parse_lot_routes(const char *spec, LotRoute *routes) {
+    int count = 0;
+    const char *p = spec;
+
+    while (*p != '\0' && count < ROUTER_MAX_LOTS) {
+        int id, port, used;
+        if (sscanf(p, "%d=%d%n", &id, &port, &used) != 2) break;
+        routes[count].lot_id = id;
+        routes[count].port = port;
+        count++;
+        p += used;
+        if (*p == ',') p++;
+    }
+    return count;
+}
+
+#ifndef _WIN32
+static int router_connect(int port) {
+    struct sockaddr_in addr;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((unsigned short)port);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Sends as much of the queue as the non-blocking socket takes; returns 0
+// once the peer is gone
+static int router_queue_flush(int fd, char *data, int *length) {
+    int sent = 0;
+    while (sent < *length) {
+        int n = (int)send(fd, data + sent, *length - sent, MSG_NOSIGNAL);
+        if (n > 0) sent += n;
+        else if (n < 0 && errno == EINTR) continue;
+        else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        else return 0;
+    }
+    memmove(data, data + sent, *length - sent);
+    *length -= sent;
+    return 1;
+}
+
+// Appends whatever the socket has to the queue; returns 0 at EOF or error,
+// or when the peer hung up while the queue is still full
+static int router_queue_read(int fd, short events, char *data, int *length, int capacity) {
+    if (*length >= capacity) return !(events & (POLLHUP | POLLERR));
+    int n = (int)read(fd, data + *length, capacity - *length);
+    if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    if (n == 0) return 0;
+    *length += n;
+    return 1;
+}
+
+// Queues text for the client; a client too far behind is disconnected
+static void router_send(RouterLink *link, const char *format, ...) {
+    char text[512];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (len >= (int)sizeof(text)) len = sizeof(text) - 1;
+    if (len <= 0) return;
+    if (link->to_client_length + len > SESSION_OUTPUT_MAX) {
+        link->closed = 1;
+        return;
+    }
+    memcpy(link->to_client + link->to_client_length, text, len);
+    link->to_client_length += len;
+}
+
+// Send the query to all lots at once. The replies are collected by the
+// router's poll loop until every lot has answered or the deadline passes,
+// so other clients are served meanwhile.
+static void router_fanout_start(RouterLink *link, LotRoute *routes, int route_count, const char *command) {
+    RouterQuery *query = (RouterQuery *)calloc(1, sizeof(RouterQuery));
+    if (query == NULL) {
+        router_send(link, "Router is out of memory.\n> ");
+        return;
+    }
+    query->is_avail = strcmp(command, "!AVAIL") == 0;
+    query->deadline_ms = monotonic_ms() + ROUTER_QUERY_MS;
+    for (int i = 0; i < ROUTER_MAX_LOTS; i++) query->fds[i] = -1;
+
+    for (int i = 0; i < route_count; i++) {
+        query->fds[i] = router_connect(routes[i].port);
+        if (query->fds[i] < 0) continue;
+        // A fresh socket has room for one short line
+        if (send(query->fds[i], command, strlen(command), MSG_NOSIGNAL) < 0 ||
+            send(query->fds[i], "\n", 1, MSG_NOSIGNAL) < 0) {
+            close(query->fds[i]);
+            query->fds[i] = -1;
+            continue;
+        }
+        fcntl(query->fds[i], F_SETFL, fcntl(query->fds[i], F_GETFL, 0) | O_NONBLOCK);
+        query->waiting++;
+    }
+    link->query = query;
+}
+
+// Reads one lot's reply; the lot is done once its OK line is complete
+static void router_fanout_read(RouterQuery *query, int i) {
+    const char *marker = query->is_avail ? "OK AVAIL " : "OK REVENUE ";
+    int room = (int)sizeof(query->replies[i]) - 1 - query->lengths[i];
+    int got = room > 0 ? (int)read(query->fds[i], query->replies[i] + query->lengths[i], room) : 0;
+    if (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return;
+    if (got > 0) {
+        query->lengths[i] += got;
+        query->replies[i][query->lengths[i]] = '\0';
+        char *found = strstr(query->replies[i], marker);
+        if (found == NULL || strchr(found, '\n') == NULL) return;
+        memmove(query->replies[i], found, strlen(found) + 1);
+    } else {
+        query->replies[i][0] = '\0';
+    }
+    close(query->fds[i]);
+    query->fds[i] = -1;
+    query->waiting--;
+}
+
+// Writes the per-lot lines and the totals; lots that did not answer in
+// time are reported as unreachable
+static void router_fanout_finish(RouterLink *link, LotRoute *routes, int route_count) {
+    RouterQuery *query = link->query;
+    int totals[3] = {0, 0, 0};
+    double revenue = 0;
+    int payments = 0;
+
+    for (int i = 0; i < route_count; i++) {
+        int lot, a, b, c;
+        double amount;
+        if (query->fds[i] >= 0) close(query->fds[i]);
+
+        if (query->is_avail && sscanf(query->replies[i], "OK AVAIL %d %d %d %d", &lot, &a, &b, &c) == 4) {
+            router_send(link, "Lot %d: Bike %d | Car %d | Truck %d\n", routes[i].lot_id, a, b, c);
+            totals[0] += a;
+            totals[1] += b;
+            totals[2] += c;
+        } else if (!query->is_avail && sscanf(query->replies[i], "OK REVENUE %d %lf %d", &lot, &amount, &a) == 3) {
+            router_send(link, "Lot %d: $%.2f from %d payments\n", routes[i].lot_id, amount, a);
+            revenue += amount;
+            payments += a;
+        } else {
+            router_send(link, "Lot %d: unreachable\n", routes[i].lot_id);
+        }
+    }
+
+    if (query->is_avail) {
+        router_send(link, "TOTAL: Bike %d | Car %d | Truck %d\n> ", totals[0], totals[1], totals[2]);
+    } else {
+        router_send(link, "TOTAL: $%.2f from %d payments\n> ", revenue, payments);
+    }
+    free(query);
+    link->query = NULL;
+}
+
+static void router_greet(RouterLink *link, LotRoute *routes, int route_count) {
+    router_send(link, "\n*** SMART PARK ROUTER ***\nLots:");
+    for (int i = 0; i < route_count; i++) router_send(link, " %d", routes[i].lot_id);
+    router_send(link, "\nLOT <id> to connect, !AVAIL or !REVENUE for all lots, QUIT to leave\n> ");
+}
+
+// Handles one line from a client that has not picked a lot yet;
+// returns 0 when the link should be closed
+static int router_command(RouterLink *link, LotRoute *routes, int route_count, const char *line) {
+    int id;
+
+    if (strcmp(line, "!AVAIL") == 0 || strcmp(line, "!REVENUE") == 0) {
+        router_fanout_start(link, routes, route_count, line);
+        return 1; // the prompt follows the totals
+    } else if (line[0] == '!') {
+        router_send(link, "Only !AVAIL and !REVENUE go to every lot; use LOT <id> for the rest.\n");
+    } else if (sscanf(line, "LOT %d", &id) == 1 || sscanf(line, "lot %d", &id) == 1) {
+        for (int i = 0; i < route_count; i++) {
+            if (routes[i].lot_id != id) continue;
+            link->lot_fd = router_connect(routes[i].port);
+            if (link->lot_fd >= 0) {
+                fcntl(link->lot_fd, F_SETFL, fcntl(link->lot_fd, F_GETFL, 0) | O_NONBLOCK);
+                return 1;
+            }
+            router_send(link, "Lot %d is not responding.\n", id);
+            break;
+        }
+        if (link->lot_fd < 0) router_send(link, "Unknown lot %d\n", id);
+    } else if (strcmp(line, "QUIT") == 0 || strcmp(line, "quit") == 0) {
+        return 0;
+    } else if (line[0] != '\0') {
+        router_send(link, "Unknown command.\n");
+    }
+    router_send(link, "> ");
+    return 1;
+}
+
+// Runs the complete lines a client has typed. Lines wait while a fan-out
+// is in flight; once a lot is chosen, the rest goes to that lot.
+static void router_take_input(RouterLink *link, LotRoute *routes, int route_count) {
+    while (!link->closed && link->query == NULL && link->lot_fd < 0 && link->input_length > 0) {
+        char line[SESSION_INPUT_MAX + 1];
+        char *newline = memchr(link->input, '\n', link->input_length);
+        if (newline == NULL && link->input_length < SESSION_INPUT_MAX) return;
+        int length = newline != NULL ? (int)(newline - link->input) : link->input_length;
+        int used = newline != NULL ? length + 1 : length; // an overlong line is cut here
+        memcpy(line, link->input, length);
+        line[length] = '\0';
+        if (length > 0 && line[length - 1] == '\r') line[length - 1] = '\0';
+        link->input_length -= used;
+        memmove(link->input, link->input + used, link->input_length);
+        if (!router_command(link, routes, route_count, line)) link->closed = 1;
+    }
+    // Bytes typed ahead of the lot prompt go straight to the lot
+    if (link->lot_fd >= 0 && link->input_length > 0 &&
+        link->to_lot_length + link->input_length <= SESSION_OUTPUT_MAX) {
+        memcpy(link->to_lot + link->to_lot_length, link->input, link->input_length);
+        link->to_lot_length += link->input_length;
+        link->input_length = 0;
+    }
+}
+
+static void router_link_close(RouterLink *link) {
+    router_queue_flush(link->client_fd, link->to_client, &link->to_client_length); // a last try
+    close(link->client_fd);
+    if (link->lot_fd >= 0) close(link->lot_fd);
+    if (link->query != NULL) {
+        for (int i = 0; i < ROUTER_MAX_LOTS; i++) {
+            if (link->query->fds[i] >= 0) close(link->query->fds[i]);
+        }
+        free(link->query);
+    }
+    free(link);
+}
+#endif
+
+// Every socket is non-blocking: relayed bytes and replies wait in per-link
+// queues, and a link only reads as much as its destination queue can hold
+void router_server(int port, LotRoute *routes, int route_count) {
+#ifdef _WIN32
+    printf("Lot router is only available in POSIX builds.\n");
+    (void)port; (void)routes; (void)route_count;
+#else
+    RouterLink *links[ROUTER_MAX_LINKS];
+    static struct pollfd fds[1 + (2 + ROUTER_MAX_LOTS) * ROUTER_MAX_LINKS];
+    static short fd_link[1 + (2 + ROUTER_MAX_LOTS) * ROUTER_MAX_LINKS];
+    static short fd_role[1 + (2 + ROUTER_MAX_LOTS) * ROUTER_MAX_LINKS]; // ROUTER_ROLE_* or a lot index
+    int link_total = 0;
+
+    if (route_count == 0) {
+        printf("No lots given. Usage: --router <port> <lot>=<port>[,<lot>=<port>...]\n");
+        return;
+    }
+
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (listener < 0 || inet_pton(AF_INET, listen_address, &addr.sin_addr) != 1 ||
+        bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listener, 64) != 0) {
+        printf("Cannot listen on %s port %d\n", listen_address, port);
+        if (listener >= 0) close(listener);
+        return;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, server_stop_signal);
+    signal(SIGTERM, server_stop_signal);
+    printf("SMART PARK router on %s port %d serving %d lots\n", listen_address, port, route_count);
+    fflush(stdout);
+
+    while (server_running) {
+        int n = 1;
+        long long now = monotonic_ms();
+        int wait_ms = SESSION_POLL_MS;
+        fds[0].fd = listener;
+        fds[0].events = POLLIN;
+        fds[0].revents = 0;
+        for (int i = 0; i < link_total; i++) {
+            RouterLink *link = links[i];
+            int to_lot_room = link->to_lot_length < SESSION_OUTPUT_MAX;
+            int input_room = link->input_length < SESSION_INPUT_MAX;
+
+            fds[n].fd = link->client_fd;
+            fds[n].events = (link->lot_fd >= 0 ? to_lot_room : link->query == NULL && input_room) ? POLLIN : 0;
+            if (link->to_client_length > 0) fds[n].events |= POLLOUT;
+            fd_link[n] = (short)i;
+            fd_role[n++] = ROUTER_ROLE_CLIENT;
+
+            fds[n].fd = link->lot_fd; // negative fds are ignored by poll
+            fds[n].events = link->to_client_length < SESSION_OUTPUT_MAX ? POLLIN : 0;
+            if (link->to_lot_length > 0) fds[n].events |= POLLOUT;
+            fd_link[n] = (short)i;
+            fd_role[n++] = ROUTER_ROLE_LOT;
+
+            if (link->query == NULL) continue;
+            if (link->query->deadline_ms - now < wait_ms) {
+                wait_ms = link->query->deadline_ms > now ? (int)(link->query->deadline_ms - now) : 0;
+            }
+            for (int k = 0; k < route_count; k++) {
+                if (link->query->fds[k] < 0) continue;
+                fds[n].fd = link->query->fds[k];
+                fds[n].events = POLLIN;
+                fd_link[n] = (short)i;
+                fd_role[n++] = (short)k;
+            }
+        }
+        for (int k = 0; k < n; k++) fds[k].revents = 0;
+
+        int ready = poll(fds, n, wait_ms);
+
+        if (ready > 0 && (fds[0].revents & POLLIN)) {
+            int client = accept(listener, NULL, NULL);
+            RouterLink *link = client >= 0 && link_total < ROUTER_MAX_LINKS ?
+                               (RouterLink *)calloc(1, sizeof(RouterLink)) : NULL;
+            if (link != NULL) {
+                fcntl(client, F_SETFL, fcntl(client, F_GETFL, 0) | O_NONBLOCK);
+                link->client_fd = client;
+                link->lot_fd = -1;
+                router_greet(link, routes, route_count);
+                links[link_total++] = link;
+            } else if (client >= 0) {
+                close(client);
+            }
+        }
+
+        // Only links that existed when fds was built have poll results
+        for (int k = 1; ready > 0 && k < n; k++) {
+            RouterLink *link = links[fd_link[k]];
+            short events = fds[k].revents;
+            if (events == 0 || link->closed) continue;
+
+            if (fd_role[k] == ROUTER_ROLE_CLIENT) {
+                if ((events & POLLOUT) &&
+                    !router_queue_flush(link->client_fd, link->to_client, &link->to_client_length)) {
+                    link->closed = 1;
+                }
+                if (!(events & (POLLIN | POLLHUP | POLLERR)) || link->closed) continue;
+                if (link->lot_fd >= 0) {
+                    if (!router_queue_read(link->client_fd, events, link->to_lot, &link->to_lot_length, SESSION_OUTPUT_MAX)) {
+                        link->closed = 1;
+                    }
+                } else if (link->query != NULL) {
+                    if (events & (POLLHUP | POLLERR)) link->closed = 1; // gone before the totals
+                } else {
+                    if (!router_queue_read(link->client_fd, events, link->input, &link->input_length, SESSION_INPUT_MAX)) {
+                        link->closed = 1;
+                    }
+                    router_take_input(link, routes, route_count);
+                }
+            } else if (fd_role[k] == ROUTER_ROLE_LOT) {
+                if ((events & POLLOUT) && !router_queue_flush(link->lot_fd, link->to_lot, &link->to_lot_length)) {
+                    link->closed = 1;
+                }
+                if ((events & (POLLIN | POLLHUP | POLLERR)) && !link->closed &&
+                    !router_queue_read(link->lot_fd, events, link->to_client, &link->to_client_length, SESSION_OUTPUT_MAX)) {
+                    link->closed = 1; // the lot ended the session
+                }
+            } else if (link->query != NULL && link->query->fds[fd_role[k]] >= 0) {
+                router_fanout_read(link->query, fd_role[k]);
+            }
+        }
+
+        // Finish answered or expired fan-outs, then push out what is queued
+        now = monotonic_ms();
+        for (int i = 0; i < link_total; i++) {
+            RouterLink *link = links[i];
+            if (link->query != NULL && (link->query->waiting == 0 || now >= link->query->deadline_ms)) {
+                router_fanout_finish(link, routes, route_count);
+                router_take_input(link, routes, route_count);
+            }
+            if (link->closed) continue;
+            if (link->to_lot_length > 0 && !router_queue_flush(link->lot_fd, link->to_lot, &link->to_lot_length)) {
+                link->closed = 1;
+            }
+            if (link->to_client_length > 0 &&
+                !router_queue_flush(link->client_fd, link->to_client, &link->to_client_length)) {
+                link->closed = 1;
+            }
+        }
+
+        // Drop closed links, keeping the array packed
+        int kept = 0;
+        for (int i = 0; i < link_total; i++) {
+            if (links[i]->closed) router_link_close(links[i]);
+            else links[kept++] = links[i];
+        }
+        link_total = kept;
+    }
+
+    for (int i = 0; i < link_total; i++) router_link_close(links[i]);
+    close(listener);
+#endif
+}
+
+// Log-Shipping Replication
+// A primary started with --replicate <port> sends every committed journal
+// batch to connected replicas. A new replica first receives a snapshot of
+// all tables in the same record format, so it only needs journal_apply_record.
+// Heartbeats ("H <seq>") let replicas measure how far behind they may be.
+long long monotonic_ms() {
+#ifdef _WIN32
+    return (long long)GetTickCount64();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (long long)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+#endif
+}
+
+double monotonic_us() {
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER now;
+    if (frequency.QuadPart == 0) QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&now);
+    return (double)now.QuadPart * 1e6 / (double)frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+#endif
+}
+
+int replica_is_stale() {
+    return upstream_fd < 0 || monotonic_ms() - upstream_heard_ms > REPLICA_STALE_MS;
+}
+
+#ifdef _WIN32
+int replication_listen(int port) { (void)port; return -1; }
+void replication_ship(const char *data, int length) { (void)data; (void)length; }
+int replication_poll_fd() { return -1; }
+void replication_flush() {}
+void replication_service() {}
+void replication_tick() {}
+#else
+int replication_listen(int port) {
+    struct sockaddr_in addr;
+    int reuse = 1;
+
+    replication_listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (replication_listener < 0) return -1;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // replicas live on the same host
+    addr.sin_port = htons((unsigned short)port);
+    setsockopt(replication_listener, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    if (bind(replication_listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(replication_listener, REPLICA_MAX) != 0) {
+        close(replication_listener);
+        replication_listener = -1;
+        return -1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+    return 0;
+}
+
+// Sends what the non-blocking socket takes now; 0 when the replica is gone
+static int replica_link_flush(ReplicaLink *link) {
+    int sent = 0;
+    while (sent < link->queued) {
+        int n = (int)send(link->fd, link->queue + sent, link->queued - sent, MSG_NOSIGNAL);
+        if (n > 0) {
+            sent += n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            break;
+        } else {
+            return 0;
+        }
+    }
+    memmove(link->queue, link->queue + sent, link->queued - sent);
+    link->queued -= sent;
+    return 1;
+}
+
+static int replica_link_queue(ReplicaLink *link, const char *data, int length) {
+    if (link->queued + length > REPLICA_QUEUE_MAX) return 0;
+    if (link->queued + length > link->capacity) {
+        int new_capacity = link->capacity > 0 ? link->capacity * 2 : 65536;
+        while (new_capacity < link->queued + length) new_capacity *= 2;
+        char *grown = (char *)realloc(link->queue, new_capacity);
+        if (grown == NULL) return 0;
+        link->queue = grown;
+        link->capacity = new_capacity;
+    }
+    memcpy(link->queue + link->queued, data, length);
+    link->queued += length;
+    return replica_link_flush(link);
+}
+
+// Closes the links marked dropped and packs the rest
+static void replica_links_prune() {
+    int kept = 0;
+    for (int i = 0; i < replica_link_count; i++) {
+        if (replica_links[i].fd >= 0) {
+            replica_links[kept++] = replica_links[i];
+        } else {
+            free(replica_links[i].queue);
+        }
+    }
+    replica_link_count = kept;
+}
+
+static void replica_link_drop(ReplicaLink *link) {
+    close(link->fd);
+    link->fd = -1;
+}
+
+// Never blocks the commit path. A replica more than REPLICA_QUEUE_MAX
+// behind is dropped; it reconnects and resyncs from a fresh snapshot.
+void replication_ship(const char *data, int length) {
+    for (int i = 0; i < replica_link_count; i++) {
+        if (!replica_link_queue(&replica_links[i], data, length)) replica_link_drop(&replica_links[i]);
+    }
+    replica_links_prune();
+}
+
+// Adds a POLLOUT entry for each replica with queued batches; returns how many
+int replication_poll_out(struct pollfd *fds) {
+    int n = 0;
+    for (int i = 0; i < replica_link_count; i++) {
+        if (replica_links[i].queued == 0) continue;
+        fds[n].fd = replica_links[i].fd;
+        fds[n].events = POLLOUT;
+        fds[n].revents = 0;
+        n++;
+    }
+    return n;
+}
+
+// Pushes queued batches to every replica whose socket has room
+void replication_flush() {
+    for (int i = 0; i < replica_link_count; i++) {
+        if (replica_links[i].queued > 0 && !replica_link_flush(&replica_links[i])) {
+            replica_link_drop(&replica_links[i]);
+        }
+    }
+    replica_links_prune();
+}
+
+static void snapshot_append(char **buffer, int *length, int *capacity, const char *format, ...) {
+    char record[RECORD_SIZE];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(record, sizeof(record), format, args);
+    va_end(args);
+    if (len < 0) return;
+    if (len >= (int)sizeof(record)) len = sizeof(record) - 1;
+
+    if (*length + len > *capacity) {
+        int new_capacity = *capacity > 0 ? *capacity * 2 : 65536;
+        while (new_capacity < *length + len) new_capacity *= 2;
+        char *grown = (char *)realloc(*buffer, new_capacity);
+        if (grown == NULL) return;
+        *buffer = grown;
+        *capacity = new_capacity;
+    }
+    memcpy(*buffer + *length, record, len);
+    *length += len;
+}
+
+// Every table as insert records, then the slot states, committed as one
+// batch. The snapshot becomes the new link's first queued data.
+static int replication_send_snapshot(int fd) {
+    const char kinds[] = "UVNPS";
+    char *buffer = NULL;
+    char line[RECORD_SIZE * 2];
+    int length = 0, capacity = 0, records = 0;
+
+    for (int k = 0; kinds[k] != '\0'; k++) {
+        int rows = kinds[k] == 'U' ? user_count : kinds[k] == 'V' ? vehicle_count :
+                   kinds[k] == 'N' ? reservation_count : kinds[k] == 'P' ? payment_count : slot_count;
+        for (int i = 0; i < rows; i++, records++) {
+            format_table_record(kinds[k], i, line);
+            snapshot_append(&buffer, &length, &capacity, "%s", line);
+        }
+    }
+    snapshot_append(&buffer, &length, &capacity, "C %d %d\nH %d\n", journal_seq, records, journal_seq);
+
+    if (buffer == NULL) return 0;
+    ReplicaLink *link = &replica_links[replica_link_count];
+    link->fd = fd;
+    link->queue = buffer;
+    link->queued = length;
+    link->capacity = capacity;
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    if (!replica_link_flush(link)) {
+        free(buffer);
+        return 0;
+    }
+    replica_link_count++;
+    return 1;
+}
+
+int replication_poll_fd() {
+    return replica_mode ? upstream_fd : replication_listener;
+}
+
+static void replica_reset_tables() {
+    user_count = vehicle_count = reservation_count = payment_count = 0;
+    slot_count = 0;
+    initialize_slots();
+    memset(plate_index, 0, sizeof(plate_index));
+    plate_index_count = 0;
+    upstream_batch_length = 0;
+    upstream_line_length = 0;
+}
+
+// Batches are applied only once their commit marker arrives, as in replay
+static void replica_take_line(const char *line) {
+    int seq, count;
+
+    if (sscanf(line, "H %d", &seq) == 1) {
+        upstream_seq = seq;
+        return;
+    }
+    if (sscanf(line, "C %d %d", &seq, &count) == 2) {
+        char *record = upstream_batch;
+        char *end = upstream_batch + upstream_batch_length;
+        while (record < end) {
+            char *next = memchr(record, '\n', end - record);
+            if (next == NULL) break;
+            *next = '\0';
+            journal_apply_record(record);
+            record = next + 1;
+        }
+        upstream_batch_length = 0;
+        upstream_seq = seq;
+        return;
+    }
+
+    int len = (int)strlen(line);
+    if (upstream_batch_length + len + 1 > upstream_batch_capacity) {
+        int new_capacity = upstream_batch_capacity > 0 ? upstream_batch_capacity * 2 : 65536;
+        while (new_capacity < upstream_batch_length + len + 1) new_capacity *= 2;
+        char *grown = (char *)realloc(upstream_batch, new_capacity);
+        if (grown == NULL) return;
+        upstream_batch = grown;
+        upstream_batch_capacity = new_capacity;
+    }
+    memcpy(upstream_batch + upstream_batch_length, line, len);
+    upstream_batch_length += len;
+    upstream_batch[upstream_batch_length++] = '\n';
+}
+
+void replication_service() {
+    if (!replica_mode) {
+        int fd = accept(replication_listener, NULL, NULL);
+        if (fd < 0) return;
+        journal_commit(); // the snapshot must not include uncommitted records
+        if (replica_link_count == REPLICA_MAX || !replication_send_snapshot(fd)) close(fd);
+        return;
+    }
+
+    char data[4096];
+    int n = (int)read(upstream_fd, data, sizeof(data));
+    if (n <= 0) {
+        close(upstream_fd);
+        upstream_fd = -1;
+        return;
+    }
+    upstream_heard_ms = monotonic_ms();
+    for (int i = 0; i < n; i++) {
+        if (data[i] != '\n') {
+            if (upstream_line_length < (int)sizeof(upstream_line) - 1) {
+                upstream_line[upstream_line_length++] = data[i];
+            }
+            continue;
+        }
+        upstream_line[upstream_line_length] = '\0';
+        upstream_line_length = 0;
+        replica_take_line(upstream_line);
+    }
+}
+
+// Primary: heartbeat. Replica: reconnect (and resync) when the primary is gone.
+void replication_tick() {
+    long long now = monotonic_ms();
+
+    if (!replica_mode) {
+        replication_flush(); // for loops that do not poll the replica sockets
+        if (replica_link_count == 0 || now - replication_last_ms < REPLICA_HEARTBEAT_MS) return;
+        char beat[32];
+        int len = sprintf(beat, "H %d\n", journal_seq);
+        replication_ship(beat, len);
+        replication_last_ms = now;
+        return;
+    }
+
+    if (upstream_fd >= 0 || now - replication_last_ms < REPLICA_HEARTBEAT_MS) return;
+    replication_last_ms = now;
+
+    struct sockaddr_in addr;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((unsigned short)upstream_port);
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return;
+    }
+    replica_reset_tables();
+    upstream_fd = fd;
+    upstream_heard_ms = 0; // stale until the snapshot arrives
+}
+#endif
+
+// Shared-Memory Slot Table
+// With --shared-slots every kiosk process of a lot maps the same slot table.
+// The first process creates and loads it; later ones use the live copy and
+// skip slots.txt. Writers hold the futex lock; readers just read.
+#ifdef _WIN32
+int shared_slots_attach() {
+    printf("Shared slot table is only available in POSIX builds.\n");
+    return -1;
+}
+void shared_slots_publish() {}
+void shared_slots_detach() {}
+void slot_table_lock() {}
+void slot_table_unlock() {}
+void slot_events_wait(unsigned int seen, int ms) {
+    (void)seen;
+    sleep_ms(ms);
+}
+#else
+static void futex_wait(int *word, int value) {
+#ifdef __linux__
+    syscall(SYS_futex, word, FUTEX_WAIT, value, NULL, NULL, 0);
+#else
+    (void)word; (void)value;
+    usleep(100);
+#endif
+}
+
+static void futex_wait_ms(int *word, int value, int ms) {
+#ifdef __linux__
+    struct timespec timeout;
+    timeout.tv_sec = ms / 1000;
+    timeout.tv_nsec = (long)(ms % 1000) * 1000000;
+    syscall(SYS_futex, word, FUTEX_WAIT, value, &timeout, NULL, 0);
+#else
+    (void)word; (void)value;
+    usleep(ms * 1000);
+#endif
+}
+
+static void futex_wake(int *word, int count) {
+#ifdef __linux__
+    syscall(SYS_futex, word, FUTEX_WAKE, count, NULL, NULL, 0);
+#else
+    (void)word; (void)count;
+#endif
+}
+
+int shared_slots_attach() {
+    char name[64];
+    int created = 1;
+    sprintf(name, SHARED_SLOTS_NAME, lot_id);
+
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) {
+        created = 0;
+        fd = shm_open(name, O_RDWR, 0600);
+        if (fd < 0) return -1;
+    } else if (ftruncate(fd, sizeof(SharedSlotTable)) != 0) {
+        close(fd);
+        shm_unlink(name);
+        return -1;
+    }
+
+    void *map = mmap(NULL, sizeof(SharedSlotTable), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return -1;
+    shared_slots = (SharedSlotTable *)map;
+
+    // The creator loads the table into shared memory; others wait until it has
+    if (!created) {
+        for (int i = 0; i < 500 && __atomic_load_n(&shared_slots->magic, __ATOMIC_ACQUIRE) != SHARED_SLOTS_MAGIC; i++) {
+            sleep_ms(10);
+        }
+        if (__atomic_load_n(&shared_slots->magic, __ATOMIC_ACQUIRE) != SHARED_SLOTS_MAGIC) {
+            munmap(map, sizeof(SharedSlotTable));
+            shared_slots = NULL;
+            return -1;
+        }
+        slot_count = shared_slots->slot_count;
+        shared_slots_live = 1;
+    }
+    slots = shared_slots->slots;
+    slot_events = &shared_slots->events;
+    slot_type_counts = shared_slots->type_counts;
+    return 0;
+}
+
+// Called by the creator once slots.txt and the journal are applied
+void shared_slots_publish() {
+    if (shared_slots == NULL || shared_slots_live) return;
+    for (int i = 0; i < slot_count; i++) {
+        shared_slots->state[i] = slot_state_code(slots[i].status);
+    }
+    shared_slots->slot_count = slot_count;
+    slot_counts_rebuild();
+    __atomic_store_n(&shared_slots->magic, SHARED_SLOTS_MAGIC, __ATOMIC_RELEASE);
+    shared_slots_live = 1;
+}
+
+// The segment outlives this process so other kiosks keep the live table
+void shared_slots_detach() {
+    if (shared_slots == NULL) return;
+    memcpy(local_slots, shared_slots->slots, sizeof(Slot) * slot_count);
+    slots = local_slots;
+    slot_events = &local_slot_events;
+    memcpy(local_slot_type_counts, shared_slots->type_counts, sizeof(local_slot_type_counts));
+    slot_type_counts = local_slot_type_counts;
+    munmap(shared_slots, sizeof(SharedSlotTable));
+    shared_slots = NULL;
+}
+
+// Drepper's three-state futex mutex
+void slot_table_lock() {
+    if (shared_slots == NULL) return;
+    int *word = &shared_slots->lock;
+    int expected = 0;
+    if (__atomic_compare_exchange_n(word, &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) return;
+    if (expected != 2) expected = __atomic_exchange_n(word, 2, __ATOMIC_ACQUIRE);
+    while (expected != 0) {
+        futex_wait(word, 2);
+        expected = __atomic_exchange_n(word, 2, __ATOMIC_ACQUIRE);
+    }
+}
+
+void slot_table_unlock() {
+    if (shared_slots == NULL) return;
+    __atomic_add_fetch(&shared_slots->version, 1, __ATOMIC_RELEASE);
+    if (__atomic_exchange_n(&shared_slots->lock, 0, __ATOMIC_RELEASE) == 2) {
+        futex_wake(&shared_slots->lock, 1);
+    }
+    if (__atomic_load_n(&shared_slots->watchers, __ATOMIC_ACQUIRE) > 0) {
+        futex_wake((int *)&shared_slots->events.head, 0x7fffffff);
+    }
+}
+
+// Sleep until a slot changes after event `seen`, or ms pass
+void slot_events_wait(unsigned int seen, int ms) {
+    if (shared_slots == NULL) {
+        sleep_ms(ms); // only this process changes its slots
+        return;
+    }
+    __atomic_add_fetch(&shared_slots->watchers, 1, __ATOMIC_ACQ_REL);
+    if (__atomic_load_n(&slot_events->head, __ATOMIC_ACQUIRE) == seen) {
+        futex_wait_ms((int *)&slot_events->head, (int)seen, ms);
+    }
+    __atomic_sub_fetch(&shared_slots->watchers, 1, __ATOMIC_ACQ_REL);
+}
+#endif
+
+int slot_state_code(const char *status) {
+    if (strcmp(status, "available") == 0) return SLOT_STATE_AVAILABLE;
+    if (strcmp(status, "reserved") == 0) return SLOT_STATE_RESERVED;
+    return SLOT_STATE_OCCUPIED;
+}
+
+// 0 bike, 1 car, 2 truck
+int slot_type_code(const char *type) {
+    if (strcmp(type, "bike") == 0) return 0;
+    if (strcmp(type, "car") == 0) return 1;
+    return 2;
+}
+
+// Full recount, only after the whole table was (re)loaded
+void slot_counts_rebuild() {
+    geometry_ready = 0; // the zone heaps are rebuilt on the next pick
+    memset(slot_type_counts, 0, sizeof(local_slot_type_counts));
+    for (int i = 0; i < slot_count; i++) {
+        slot_type_counts[slot_type_code(slots[i].type)][slot_state_code(slots[i].status)]++;
+    }
+}
+
+// Called before a slot's status changes, under the slot table lock
+void slot_counts_move(const Slot *slot, const char *new_status) {
+    int type = slot_type_code(slot->type);
+    slot_type_counts[type][slot_state_code(slot->status)]--;
+    slot_type_counts[type][slot_state_code(new_status)]++;
+}
+
+// Atomically move a slot from available to reserved; 0 if someone beat us to it
+int slot_claim(int slot_index) {
+    if (shared_slots == NULL) return 1;
+    int expected = SLOT_STATE_AVAILABLE;
+    return __atomic_compare_exchange_n(&shared_slots->state[slot_index], &expected, SLOT_STATE_RESERVED,
+                                       0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+// Fixed-Size Record Store
+// With --record-store, users, vehicles, reservations and payments live in
+// .dat files of RECORD_SIZE rows that several processes share. Each update
+// rewrites only its own row under an fcntl byte-range lock. Appends take the
+// header row's lock, which holds the row count.
+static const char *record_file_name(char kind) {
+    switch (kind) {
+        case 'U': return "users.dat";
+        case 'V': return "vehicles.dat";
+        case 'N': return "reservations.dat";
+        default: return "payments.dat";
+    }
+}
+
+static RecordFile *record_file(char kind) {
+    switch (kind) {
+        case 'U': return &record_files[0];
+        case 'V': return &record_files[1];
+        case 'N': return &record_files[2];
+        default: return &record_files[3];
+    }
+}
+
+static int *record_table_count(char kind) {
+    switch (kind) {
+        case 'U': return &user_count;
+        case 'V': return &vehicle_count;
+        case 'N': return &reservation_count;
+        default: return &payment_count;
+    }
+}
+
+static int record_row_id(char kind, int index) {
+    switch (kind) {
+        case 'U': return users[index].user_id;
+        case 'V': return vehicles[index].vehicle_id;
+        case 'N': return reservations[index].reservation_id;
+        default: return payments[index].payment_id;
+    }
+}
+
+#ifdef _WIN32
+int record_store_open() {
+    printf("Record store is only available in POSIX builds.\n");
+    return -1;
+}
+void record_store_close() {}
+void record_store_pull(char kind) { (void)kind; }
+void record_store_put(char kind, int index) { (void)kind; (void)index; }
+void record_store_begin_append(char kind) { (void)kind; }
+void record_store_end_append(char kind) { (void)kind; }
+void record_store_lock_row(char kind, int id) { (void)kind; (void)id; }
+void record_store_unlock_row(char kind) { (void)kind; }
+void record_store_refresh() {}
+#else
+// Lock `rows` rows starting at `row`; waits for conflicting locks
+static void record_lock(RecordFile *file, int row, int rows, short type) {
+    struct flock lock;
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = type;
+    lock.l_whence = SEEK_SET;
+    lock.l_start = (off_t)row * RECORD_SIZE;
+    lock.l_len = (off_t)rows * RECORD_SIZE;
+    while (fcntl(file->fd, F_SETLKW, &lock) == -1 && errno == EINTR) {
+    }
+}
+
+static int record_read_row(RecordFile *file, int row, char *line) {
+    if (pread(file->fd, line, RECORD_SIZE, (off_t)row * RECORD_SIZE) != RECORD_SIZE) return 0;
+    char *end = memchr(line, '\n', RECORD_SIZE);
+    if (end == NULL) return 0;
+    *end = '\0';
+    return 1;
+}
+
+static void record_write_row(RecordFile *file, int row, const char *text) {
+    char line[RECORD_SIZE];
+    int len = (int)strcspn(text, "\n");
+    if (len > RECORD_SIZE - 1) len = RECORD_SIZE - 1;
+    memcpy(line, text, len);
+    memset(line + len, ' ', RECORD_SIZE - 1 - len);
+    line[RECORD_SIZE - 1] = '\n';
+    if (pwrite(file->fd, line, RECORD_SIZE, (off_t)row * RECORD_SIZE) != RECORD_SIZE) {
+        printCentered("Error: Could not write the record store", LIGHTRED);
+    }
+}
+
+static int record_header_count(RecordFile *file) {
+    char line[RECORD_SIZE];
+    int count = 0;
+    if (record_read_row(file, 0, line)) sscanf(line, "COUNT %d", &count);
+    return count;
+}
+
+static void record_set_header_count(RecordFile *file, int count) {
+    char header[32];
+    sprintf(header, "COUNT %d", count);
+    record_write_row(file, 0, header);
+}
+
+// Replace an existing row in memory, or append it when the id is new
+static void record_apply_row(const char *line) {
+    int id, index = -1;
+    char when[TIME_TEXT_SIZE], ended[TIME_TEXT_SIZE];
+    if (sscanf(line + 1, "%d", &id) != 1) return;
+
+    if (line[0] == 'U' && (index = find_user_index(id)) != -1) {
+        User u;
+        if (sscanf(line, "U %d %99s %19s %99s %99s %19s %d", &u.user_id, u.name, u.phone,
+                   u.email, u.password, when, &u.is_active) == 7) {
+            u.reg_date = parse_time(when);
+            users[index] = u;
+        }
+        return;
+    }
+    if (line[0] == 'N' && (index = find_reservation_index(id)) != -1) {
+        Reservation r;
+        if (sscanf(line, "N %d %d %d %d %19s %19s %19s %lf %lf", &r.reservation_id, &r.user_id,
+                   &r.slot_id, &r.vehicle_id, when, ended, r.status,
+                   &r.duration_hours, &r.total_amount) == 9) {
+            r.start_time = parse_time(when);
+            r.end_time = parse_time(ended);
+            reservations[index] = r;
+            reservation_timers_track(index);
+        }
+        return;
+    }
+    table_apply_record(line);
+}
+
+int record_store_open() {
+    const char kinds[] = "UVNP";
+    char line[RECORD_SIZE];
+
+    for (int k = 0; kinds[k] != '\0'; k++) {
+        RecordFile *file = record_file(kinds[k]);
+        int *count = record_table_count(kinds[k]);
+
+        file->kind = kinds[k];
+        file->header_held = 0;
+        file->held_row = 0;
+        file->fd = open(record_file_name(kinds[k]), O_RDWR | O_CREAT, 0644);
+        if (file->fd < 0) return -1;
+
+        // An empty store is seeded from the text files that load_data read
+        record_lock(file, 0, 1, F_WRLCK);
+        int stored = record_header_count(file);
+        if (stored == 0) {
+            for (int i = 0; i < *count; i++) {
+                format_table_record(kinds[k], i, line);
+                record_write_row(file, record_row_id(kinds[k], i), line);
+                if (record_row_id(kinds[k], i) > stored) stored = record_row_id(kinds[k], i);
+            }
+            record_set_header_count(file, stored);
+        } else {
+            *count = 0;
+            for (int row = 1; row <= stored; row++) {
+                if (record_read_row(file, row, line)) record_apply_row(line);
+            }
+        }
+        record_lock(file, 0, 1, F_UNLCK);
+    }
+
+    char msg[100];
+    sprintf(msg, "Record store: %d users, %d vehicles, %d reservations, %d payments",
+            user_count, vehicle_count, reservation_count, payment_count);
+    printCentered(msg, LIGHTGREEN);
+    return 0;
+}
+
+void record_store_close() {
+    if (!record_store_mode) return;
+    for (int k = 0; k < 4; k++) {
+        if (record_files[k].fd >= 0) close(record_files[k].fd);
+        record_files[k].fd = -1;
+    }
+}
+
+// Load rows other processes appended since we last looked
+void record_store_pull(char kind) {
+    if (!record_store_mode) return;
+    RecordFile *file = record_file(kind);
+    int *count = record_table_count(kind);
+    char line[RECORD_SIZE];
+
+    // Re-locking a range we hold would downgrade our own lock, so skip it then
+    if (!file->header_held) record_lock(file, 0, 1, F_RDLCK);
+    int stored = record_header_count(file);
+    if (!file->header_held) record_lock(file, 0, 1, F_UNLCK);
+
+    int first = *count + 1;
+    if (stored < first) return;
+    if (file->held_row == 0) record_lock(file, first, stored - first + 1, F_RDLCK);
+    for (int row = first; row <= stored; row++) {
+        if (record_read_row(file, row, line)) record_apply_row(line);
+    }
+    if (file->held_row == 0) record_lock(file, first, stored - first + 1, F_UNLCK);
+}
+
+void record_store_refresh() {
+    record_store_pull('U');
+    record_store_pull('V');
+    record_store_pull('N');
+    record_store_pull('P');
+}
+
+// Write one row back; extends the header count for new ids
+void record_store_put(char kind, int index) {
+    if (!record_store_mode) return;
+    double started = monotonic_us();
+    RecordFile *file = record_file(kind);
+    char line[RECORD_SIZE * 2];
+    int id = record_row_id(kind, index);
+
+    format_table_record(kind, index, line);
+    if (file->held_row != id) record_lock(file, id, 1, F_WRLCK);
+    record_write_row(file, id, line);
+    if (file->held_row != id) record_lock(file, id, 1, F_UNLCK);
+
+    if (!file->header_held) record_lock(file, 0, 1, F_WRLCK);
+    if (id > record_header_count(file)) record_set_header_count(file, id);
+    if (!file->header_held) record_lock(file, 0, 1, F_UNLCK);
+    latency_record(METRIC_RECORD_STORE_PUT, started, 0);
+}
+
+void record_store_begin_append(char kind) {
+    if (!record_store_mode) return;
+    RecordFile *file = record_file(kind);
+    record_lock(file, 0, 1, F_WRLCK);
+    file->header_held = 1;
+    record_store_pull(kind);
+}
+
+void record_store_end_append(char kind) {
+    if (!record_store_mode) return;
+    RecordFile *file = record_file(kind);
+    file->header_held = 0;
+    record_lock(file, 0, 1, F_UNLCK);
+}
+
+// Hold one row for a read-check-write sequence, starting from its stored copy
+void record_store_lock_row(char kind, int id) {
+    if (!record_store_mode || id <= 0) return;
+    RecordFile *file = record_file(kind);
+    char line[RECORD_SIZE];
+
+    record_store_pull(kind);
+    record_lock(file, id, 1, F_WRLCK);
+    file->held_row = id;
+    if (record_read_row(file, id, line)) record_apply_row(line);
+}
+
+void record_store_unlock_row(char kind) {
+    if (!record_store_mode) return;
+    RecordFile *file = record_file(kind);
+    if (file->held_row == 0) return;
+    record_lock(file, file->held_row, 1, F_UNLCK);
+    file->held_row = 0;
+}
+#endif
+
+// Live Slot Dashboard
+// A grid with one colored cell per slot. Only the cells named in the slot
+// event ring are redrawn, and the renderer sends just those cells, so the
+// cost follows the change rate rather than the lot size.
+static int dashboard_page_cells() {
+    int rows = term_height() - 6;
+    return (rows > 0 ? rows : 1) * DASHBOARD_COLUMNS;
+}
+
+static int dashboard_slot_state(int index) {
+    if (shared_slots != NULL) return __atomic_load_n(&shared_slots->state[index], __ATOMIC_ACQUIRE);
+    return slot_state_code(slots[index].status);
+}
+
+static void dashboard_draw_cell(int index, int state, int page) {
+    int local = index - page * dashboard_page_cells();
+    if (local < 0 || local >= dashboard_page_cells()) return;
+
+    term_move(4 + local / DASHBOARD_COLUMNS, 8 + local % DASHBOARD_COLUMNS);
+    if (state == SLOT_STATE_AVAILABLE) {
+        setColor(LIGHTGREEN);
+        term_printf("A");
+    } else if (state == SLOT_STATE_RESERVED) {
+        setColor(LIGHTBLUE);
+        term_printf("R");
+    } else {
+        setColor(LIGHTRED);
+        term_printf("O");
+    }
+    resetColor();
+}
+
+static void dashboard_draw_counts(const int counts[3], int page) {
+    char line[CONSOLE_WIDTH + 1];
+    int pages = (slot_count + dashboard_page_cells() - 1) / dashboard_page_cells();
+
+    term_move(1, 0);
+    sprintf(line, "Available %d | Reserved %d | Occupied %d | Page %d/%d",
+            counts[SLOT_STATE_AVAILABLE], counts[SLOT_STATE_RESERVED],
+            counts[SLOT_STATE_OCCUPIED], page + 1, pages > 0 ? pages : 1);
+    term_printf("%-*s", CONSOLE_WIDTH - 1, "");
+    term_move(1, 0);
+    printCentered(line, WHITE);
+}
+
+static void dashboard_draw_all(signed char *drawn, int counts[3], int page) {
+    clear_screen();
+    printCentered("LIVE SLOT MAP", LIGHTCYAN);
+    counts[0] = counts[1] = counts[2] = 0;
+
+    int first = page * dashboard_page_cells();
+    for (int i = first; i < slot_count && i < first + dashboard_page_cells(); i += DASHBOARD_COLUMNS) {
+        term_move(4 + (i - first) / DASHBOARD_COLUMNS, 0);
+        setColor(DARKGRAY);
+        term_printf("%6d ", slots[i].slot_id);
+        resetColor();
+    }
+    for (int i = 0; i < slot_count; i++) {
+        drawn[i] = (signed char)dashboard_slot_state(i);
+        counts[drawn[i]]++;
+        dashboard_draw_cell(i, drawn[i], page);
+    }
+    dashboard_draw_counts(counts, page);
+    term_move(term_height() - 1, 0);
+    setColor(DARKGRAY);
+    term_printf("A available  R reserved  O occupied    n/p: page  q: back");
+    resetColor();
+}
+
+void slot_dashboard() {
+    static signed char drawn[MAX_SLOTS];
+    int counts[3];
+    int page = 0;
+
+    if (term_is_plain()) {
+        printCentered("The live slot map needs a terminal (not --plain).", YELLOW);
+        pause_screen();
+        return;
+    }
+
+    unsigned int seen = __atomic_load_n(&slot_events->head, __ATOMIC_ACQUIRE);
+    dashboard_draw_all(drawn, counts, page);
+    term_flush();
+
+    while (1) {
+        int changed = 0;
+
+        while (kbhit()) {
+            int key = getch();
+            int pages = (slot_count + dashboard_page_cells() - 1) / dashboard_page_cells();
+            if (key == 'q' || key == 'Q' || key == 27) {
+                clear_screen();
+                return;
+            }
+            if (key == 'n' || key == 'N') page = pages > 0 ? (page + 1) % pages : 0;
+            if (key == 'p' || key == 'P') page = pages > 0 ? (page + pages - 1) % pages : 0;
+            seen = __atomic_load_n(&slot_events->head, __ATOMIC_ACQUIRE);
+            dashboard_draw_all(drawn, counts, page);
+            changed = 1;
+        }
+
+        unsigned int head = __atomic_load_n(&slot_events->head, __ATOMIC_ACQUIRE);
+        if (head - seen > SLOT_EVENT_RING) {
+            dashboard_draw_all(drawn, counts, page); // fell behind the ring
+            changed = 1;
+        } else {
+            for (; seen != head; seen++) {
+                int index = slot_events->slots[seen & (SLOT_EVENT_RING - 1)];
+                if (index < 0 || index >= slot_count) continue;
+                int state = dashboard_slot_state(index);
+                if (state == drawn[index]) continue;
+                counts[drawn[index]]--;
+                counts[state]++;
+                drawn[index] = (signed char)state;
+                dashboard_draw_cell(index, state, page);
+                changed = 1;
+            }
+        }
+        seen = head;
+
+        if (changed) {
+            dashboard_draw_counts(counts, page);
+            term_move(term_height() - 1, 0);
+            term_flush();
+            sleep_ms(DASHBOARD_FRAME_MS); // let further changes batch into the next frame
+        }
+        slot_events_wait(seen, DASHBOARD_FRAME_MS);
+    }
+}
+
+// Batch Script Mode
+// --script <file|-> runs one command per line through the engine, without
+// menus or pauses, and prints one result line per command:
+//   register <name> <phone> <email> <password>
+//   login <phone> <password>
+//   add-vehicle <user_id> <bike|car|truck> <plate> [color]
+//   reserve <user_id> <vehicle_id> <slot_id> <hours>
+//   pay <user_id> <reservation_id> <cash|card|bkash|nagad>
+//   cancel <user_id|admin> <reservation_id>
+//   entry <plate> / exit <plate>
+//   quote
+//   advance <minutes>        (simulated --clock only)
+//   report [user_id]
+// Blank lines and lines starting with # are skipped.
+int script_command(const char *line, char *result) {
+    char command[32], a[MAX_STRING], b[MAX_STRING], c[MAX_STRING], d[MAX_STRING];
+    int fields = sscanf(line, "%31s %99s %99s %99s %99s", command, a, b, c, d) - 1;
+    int code;
+
+    if (fields < 0) { // blank line: nothing was read into command
+        sprintf(result, "empty command");
+        return ENGINE_ERR_INVALID;
+    }
+
+    if (strcmp(command, "register") == 0 && fields == 4) {
+        code = engine_register_user(a, b, c, d);
+        if (code >= 0) sprintf(result, "user %d", users[code].user_id);
+    } else if (strcmp(command, "login") == 0 && fields == 2) {
+        code = engine_login(a, b);
+        if (code >= 0) sprintf(result, "user %d", code);
+        else code = ENGINE_ERR_NOT_FOUND;
+    } else if (strcmp(command, "add-vehicle") == 0 && fields >= 3) {
+        code = engine_add_vehicle(atoi(a), b, c, fields >= 4 ? d : "");
+        if (code >= 0) sprintf(result, "vehicle %d", vehicles[code].vehicle_id);
+    } else if (strcmp(command, "reserve") == 0 && fields == 4) {
+        // "nearest" or "nearest@<level>" in place of a slot number
+        int level = LEVEL_ANY;
+        if (strncmp(c, "nearest", 7) == 0 && (c[7] == '\0' || sscanf(c + 7, "@%d", &level) == 1)) {
+            code = engine_reserve_nearest(atoi(a), atoi(b), level, atof(d));
+        } else {
+            code = engine_reserve(atoi(a), atoi(b), atoi(c), atof(d));
+        }
+        if (code >= 0) {
+            sprintf(result, "reservation %d slot %d $%.2f", reservations[code].reservation_id,
+                    reservations[code].slot_id, reservations[code].total_amount);
+        }
+    } else if (strcmp(command, "pay") == 0 && fields == 3) {
+        code = engine_pay(atoi(a), atoi(b), c);
+        if (code >= 0) {
+            sprintf(result, "payment %d $%.2f", payments[code].payment_id, payments[code].amount);
+        }
+    } else if (strcmp(command, "cancel") == 0 && fields == 2) {
+        code = engine_cancel(strcmp(a, "admin") == 0 ? -1 : atoi(a), atoi(b));
+        if (code >= 0) sprintf(result, "reservation %d cancelled", atoi(b));
+    } else if ((strcmp(command, "entry") == 0 || strcmp(command, "exit") == 0) && fields == 1) {
+        PlateEvent event;
+        IngestStats stats;
+        copy_field(event.plate, sizeof(event.plate), a);
+        event.is_exit = strcmp(command, "exit") == 0;
+        event.event_time = now_epoch();
+        code = ingest_plate_events(&event, 1, &stats) > 0 ? ENGINE_OK
+             : stats.applied + stats.ignored > 0 ? ENGINE_ERR_STATE : ENGINE_ERR_NOT_FOUND;
+        if (code >= 0) sprintf(result, "%s %s", event.plate, event.is_exit ? "left" : "entered");
+    } else if (strcmp(command, "quote") == 0 && fields == 0) {
+        sprintf(result, "bike $%.2f/h (%d%%) | car $%.2f/h (%d%%) | truck $%.2f/h (%d%%)",
+                pricing_quote(0), slot_type_occupancy(0), pricing_quote(1), slot_type_occupancy(1),
+                pricing_quote(2), slot_type_occupancy(2));
+        code = ENGINE_OK;
+    } else if (strcmp(command, "advance") == 0 && fields == 1) {
+        code = clock_advance((long long)(atof(a) * 60));
+        if (code >= 0) {
+            char when[TIME_TEXT_SIZE];
+            sprintf(result, "clock %s | overstays %d | holds released %ld", format_time(now_epoch(), when),
+                    overstay_count, hold_expiries_total);
+        }
+    } else if (strcmp(command, "report") == 0 && fields <= 1) {
+        ReportTotals totals;
+        compute_report_totals(fields == 1 ? atoi(a) : -1, &totals);
+        sprintf(result, "reservations %d active %d | payments %d revenue $%.2f | occupied %d reserved %d",
+                totals.total_reservations, totals.active_reservations, totals.completed_payments,
+                totals.total_revenue, totals.total_occupied, totals.total_reserved);
+        code = ENGINE_OK;
+    } else {
+        sprintf(result, "unknown command or wrong arguments");
+        return ENGINE_ERR_INVALID;
+    }
+
+    if (code < 0) sprintf(result, "%s", engine_error_text(code));
+    return code;
+}
+
+// Returns the number of failed commands
+int run_script(FILE *input) {
+    char line[512], result[256];
+    int line_number = 0, commands = 0, failed = 0;
+    double started = monotonic_us();
+
+    while (fgets(line, sizeof(line), input) != NULL) {
+        line_number++;
+        line[strcspn(line, "\r\n")] = '\0';
+        const char *text = line;
+        while (isspace((unsigned char)*text)) text++;
+        if (*text == '\0' || *text == '#') continue;
+
+        int code = script_command(text, result);
+        commands++;
+        if (code < 0) failed++;
+        printf("%d %s %s\n", line_number, code < 0 ? "ERR" : "OK", result);
+
+        if (journal_pending_records > 0 && commands % SCRIPT_COMMIT_EVERY == 0) {
+            journal_commit();
+            if (journal_records_since_checkpoint >= JOURNAL_CHECKPOINT_RECORDS) save_data();
+        }
+    }
+    journal_commit();
+
+    double elapsed_us = monotonic_us() - started;
+    printf("%d commands, %d ok, %d failed in %.3f ms", commands, commands - failed, failed, elapsed_us / 1000.0);
+    if (elapsed_us > 0) printf(" (%.0f commands/s)", commands * 1e6 / elapsed_us);
+    printf("\n");
+    fflush(stdout);
+    return failed;
+}
+
+// Benchmark Suite
+// --bench <users> [--bench-ops <n>] [--bench-out <file>] fills the tables
+// with a synthetic lot of about <users> customers, then times the file
+// snapshot, the engine operations and the reports on it. Results are written
+// as JSON: ops/s and latency percentiles per operation, plus peak RSS.
+// Everything happens inside BENCH_DIR, so the real data files are untouched.
+static unsigned long long bench_rng_state = 0x9E3779B97F4A7C15ULL;
+
+// xorshift64: the same dataset on every run
+static int bench_random(int limit) {
+    bench_rng_state ^= bench_rng_state << 13;
+    bench_rng_state ^= bench_rng_state >> 7;
+    bench_rng_state ^= bench_rng_state << 17;
+    return limit > 0 ? (int)(bench_rng_state % (unsigned long long)limit) : 0;
+}
+
+static void bench_add(BenchSeries *series, double us) {
+    if (series->count == series->capacity) {
+        int capacity = series->capacity > 0 ? series->capacity * 2 : 256;
+        double *grown = (double *)realloc(series->samples_us, capacity * sizeof(double));
+        if (grown == NULL) return;
+        series->samples_us = grown;
+        series->capacity = capacity;
+    }
+    series->samples_us[series->count++] = us;
+    series->total_us += us;
+}
+
+static void bench_record(BenchSeries *series, double started_us) {
+    bench_add(series, monotonic_us() - started_us);
+}
+
+static int bench_compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Nearest-rank percentile of sorted samples
+static double bench_percentile(const BenchSeries *series, double p) {
+    if (series->count == 0) return 0;
+    int rank = (int)(p / 100.0 * series->count + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > series->count) rank = series->count;
+    return series->samples_us[rank - 1];
+}
+
+static void bench_write_series(FILE *out, BenchSeries *series, int last) {
+    qsort(series->samples_us, series->count, sizeof(double), bench_compare_double);
+    fprintf(out, "    {\"name\": \"%s\", \"count\": %d, \"ops_per_sec\": %.1f, "
+                 "\"mean_us\": %.2f, \"p50_us\": %.2f, \"p90_us\": %.2f, \"p99_us\": %.2f, \"max_us\": %.2f}%s\n",
+            series->name, series->count,
+            series->total_us > 0 ? series->count * 1e6 / series->total_us : 0.0,
+            series->count > 0 ? series->total_us / series->count : 0.0,
+            bench_percentile(series, 50), bench_percentile(series, 90), bench_percentile(series, 99),
+            series->count > 0 ? series->samples_us[series->count - 1] : 0.0, last ? "" : ",");
+}
+
+// Peak resident set size in KB, -1 where the platform does not report it
+static long bench_peak_rss_kb() {
+#ifdef _WIN32
+    return -1;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return -1;
+#ifdef __APPLE__
+    return (long)(usage.ru_maxrss / 1024); // bytes on macOS
+#else
+    return (long)usage.ru_maxrss;
+#endif
+#endif
+}
+
+static void bench_reset_tables() {
+    user_count = vehicle_count = reservation_count = payment_count = 0;
+    slot_count = 0;
+    initialize_slots();
+    memset(plate_index, 0, sizeof(plate_index));
+    plate_index_count = 0;
+}
+
+// Timestamps spread over the year before a fixed date
+static long long bench_time(long long seconds_before) {
+    return 1735689600LL - seconds_before; // 2025-01-01
+}
+
+// Customers with one to three vehicles each and a history of finished
+// (paid) and cancelled bookings. Each table keeps `headroom` free rows
+// for the timed operations.
+static void bench_generate(int user_target, int headroom) {
+    static const char *colors[] = {"black", "white", "silver", "red", "blue", "green"};
+    static const char *methods[] = {"cash", "card", "bkash", "nagad"};
+    int slot_of_type[3][MAX_SLOTS], slots_of_type[3] = {0, 0, 0};
+
+    for (int i = 0; i < slot_count; i++) {
+        int type = strcmp(slots[i].type, "bike") == 0 ? 0 : strcmp(slots[i].type, "car") == 0 ? 1 : 2;
+        slot_of_type[type][slots_of_type[type]++] = i;
+    }
+
+    int users_wanted = user_target < MAX_USERS - headroom ? user_target : MAX_USERS - headroom;
+    for (int i = 0; i < users_wanted; i++) {
+        User *user = &users[user_count];
+        user->user_id = user_count + 1;
+        sprintf(user->name, "User%d", user->user_id);
+        sprintf(user->phone, "017%08d", user->user_id);
+        sprintf(user->email, "user%d@bench.test", user->user_id);
+        sprintf(user->password, "pass%d", user->user_id);
+        user->reg_date = bench_time(31536000LL + bench_random(31536000));
+        user->is_active = user->user_id % 50 != 0;
+        user_count++;
+
+        int owned = 1 + bench_random(3);
+        for (int v = 0; v < owned && vehicle_count < MAX_VEHICLES - headroom; v++) {
+            Vehicle *vehicle = &vehicles[vehicle_count];
+            int roll = bench_random(100);
+            vehicle->vehicle_id = vehicle_count + 1;
+            vehicle->user_id = user->user_id;
+            strcpy(vehicle->type, roll < 40 ? "bike" : roll < 85 ? "car" : "truck");
+            sprintf(vehicle->license_plate, "BD-%07d", vehicle->vehicle_id);
+            strcpy(vehicle->color, colors[bench_random(6)]);
+            vehicle->reg_date = user->reg_date;
+            vehicle_count++;
+        }
+    }
+
+    int bookings = user_count * 3;
+    for (int i = 0; i < bookings && vehicle_count > 0 && reservation_count < MAX_RESERVATIONS - headroom; i++) {
+        Vehicle *vehicle = &vehicles[bench_random(vehicle_count)];
+        int type = strcmp(vehicle->type, "bike") == 0 ? 0 : strcmp(vehicle->type, "car") == 0 ? 1 : 2;
+        if (slots_of_type[type] == 0) continue;
+        Slot *slot = &slots[slot_of_type[type][bench_random(slots_of_type[type])]];
+
+        Reservation *res = &reservations[reservation_count];
+        long long started = bench_random(31536000);
+        res->reservation_id = reservation_count + 1;
+        res->user_id = vehicle->user_id;
+        res->slot_id = slot->slot_id;
+        res->vehicle_id = vehicle->vehicle_id;
+        res->duration_hours = 1 + bench_random(8);
+        res->total_amount = res->duration_hours * pricing_base_rate(slot->type);
+        res->start_time = bench_time(started);
+        res->end_time = bench_time(started - (long long)res->duration_hours * 3600);
+        int paid = bench_random(100) < 75 && payment_count < MAX_PAYMENTS - headroom;
+        strcpy(res->status, paid ? "completed" : "cancelled");
+        reservation_count++;
+
+        if (paid) {
+            Payment *payment = &payments[payment_count];
+            payment->payment_id = payment_count + 1;
+            payment->user_id = res->user_id;
+            payment->reservation_id = res->reservation_id;
+            payment->amount = res->total_amount;
+            strcpy(payment->method, methods[bench_random(4)]);
+            payment->payment_date = res->start_time;
+            strcpy(payment->status, "completed");
+            payment_count++;
+        }
+    }
+}
+
+static int bench_enter_directory() {
+#ifdef _WIN32
+    _mkdir(BENCH_DIR);
+    return _chdir(BENCH_DIR);
+#else
+    mkdir(BENCH_DIR, 0755);
+    return chdir(BENCH_DIR);
+#endif
+}
+
+// Returns 0, or 1 when the scratch directory cannot be used
+int run_benchmark(int user_target, int op_target, FILE *out) {
+    enum { B_SAVE, B_LOAD, B_REGISTER, B_ADD_VEHICLE, B_LOGIN, B_PLATE_LOOKUP, B_RESERVE,
+           B_PAY, B_CANCEL, B_COMMIT, B_ANPR_EXIT, B_REPORT_ALL, B_REPORT_USER, B_COUNT };
+    static const char *names[B_COUNT] = {
+        "save_data", "load_data", "register_user", "add_vehicle", "login", "plate_lookup",
+        "reserve", "pay", "cancel", "journal_commit", "anpr_exit_batch",
+        "report_all", "report_user"};
+    BenchSeries series[B_COUNT];
+    char text[4][MAX_STRING];
+    double t;
+
+    if (bench_enter_directory() != 0) {
+        fprintf(stderr, "Cannot use benchmark directory %s\n", BENCH_DIR);
+        return 1;
+    }
+    memset(series, 0, sizeof(series));
+    for (int b = 0; b < B_COUNT; b++) series[b].name = names[b];
+    if (op_target < 1) op_target = 1;
+    int headroom = op_target;
+    if (headroom > MAX_USERS / 2) headroom = MAX_USERS / 2;
+    if (headroom > MAX_VEHICLES / 2) headroom = MAX_VEHICLES / 2;
+
+    remove(JOURNAL_FILE);
+    bench_reset_tables();
+    bench_generate(user_target, headroom);
+    int generated[4] = {user_count, vehicle_count, reservation_count, payment_count};
+
+    for (int run = 0; run < BENCH_FILE_RUNS; run++) {
+        t = monotonic_us();
+        save_data();
+        bench_record(&series[B_SAVE], t);
+    }
+    for (int run = 0; run < BENCH_FILE_RUNS; run++) {
+        bench_reset_tables();
+        t = monotonic_us();
+        load_data();
+        bench_record(&series[B_LOAD], t);
+    }
+
+    // New customers, each with one vehicle
+    int first_new_user = user_count;
+    for (int i = 0; i < headroom && user_count < MAX_USERS; i++) {
+        int id = user_count + 1;
+        sprintf(text[0], "NewUser%d", id);
+        sprintf(text[1], "018%08d", id);
+        sprintf(text[2], "new%d@bench.test", id);
+        sprintf(text[3], "pass%d", id);
+        t = monotonic_us();
+        engine_register_user(text[0], text[1], text[2], text[3]);
+        bench_record(&series[B_REGISTER], t);
+        if ((i + 1) % SCRIPT_COMMIT_EVERY == 0) {
+            t = monotonic_us();
+            journal_commit();
+            bench_record(&series[B_COMMIT], t);
+        }
+    }
+    for (int i = first_new_user; i < user_count && vehicle_count < MAX_VEHICLES; i++) {
+        sprintf(text[0], "NB-%07d", users[i].user_id);
+        t = monotonic_us();
+        engine_add_vehicle(users[i].user_id, i % 3 == 0 ? "bike" : i % 3 == 1 ? "car" : "truck", text[0], "grey");
+        bench_record(&series[B_ADD_VEHICLE], t);
+    }
+    t = monotonic_us();
+    journal_commit();
+    bench_record(&series[B_COMMIT], t);
+
+    for (int i = 0; i < op_target && user_count > 0; i++) {
+        User *user = &users[bench_random(user_count)];
+        t = monotonic_us();
+        engine_login(user->phone, user->password);
+        bench_record(&series[B_LOGIN], t);
+    }
+    for (int i = 0; i < op_target && vehicle_count > 0; i++) {
+        const char *plate = vehicles[bench_random(vehicle_count)].license_plate;
+        t = monotonic_us();
+        find_vehicle_by_plate(plate);
+        bench_record(&series[B_PLATE_LOOKUP], t);
+    }
+
+    // Booking rounds: fill every free slot, pay for half and cancel the
+    // rest, then drive the paid vehicles out through the ANPR path
+    int *vehicle_of_type[3];
+    int vehicles_of_type[3] = {0, 0, 0}, cursor[3] = {0, 0, 0};
+    int *round_res = (int *)malloc(MAX_SLOTS * sizeof(int));
+    PlateEvent *exits = (PlateEvent *)malloc(ANPR_BATCH_MAX * sizeof(PlateEvent));
+    for (int type = 0; type < 3; type++) vehicle_of_type[type] = (int *)malloc((vehicle_count + 1) * sizeof(int));
+    for (int i = 0; i < vehicle_count; i++) {
+        int type = strcmp(vehicles[i].type, "bike") == 0 ? 0 : strcmp(vehicles[i].type, "car") == 0 ? 1 : 2;
+        vehicle_of_type[type][vehicles_of_type[type]++] = i;
+    }
+
+    int reserved = 0, stalled = 0;
+    while (reserved < op_target && !stalled && round_res != NULL && exits != NULL) {
+        int in_round = 0;
+        for (int s = 0; s < slot_count && reserved < op_target; s++) {
+            if (strcmp(slots[s].status, "available") != 0) continue;
+            int type = strcmp(slots[s].type, "bike") == 0 ? 0 : strcmp(slots[s].type, "car") == 0 ? 1 : 2;
+            if (vehicles_of_type[type] == 0) continue;
+            Vehicle *vehicle = &vehicles[vehicle_of_type[type][cursor[type]]];
+            cursor[type] = (cursor[type] + 1) % vehicles_of_type[type];
+
+            t = monotonic_us();
+            int index = engine_reserve(vehicle->user_id, vehicle->vehicle_id, slots[s].slot_id, 1 + bench_random(8));
+            bench_record(&series[B_RESERVE], t);
+            if (index < 0) continue;
+            round_res[in_round++] = reservations[index].reservation_id;
+            reserved++;
+        }
+        if (in_round == 0) break;
+
+        int exit_count = 0;
+        for (int r = 0; r < in_round; r++) {
+            int index = find_reservation_index(round_res[r]);
+            int user_id = reservations[index].user_id;
+            if (r % 2 == 0) {
+                t = monotonic_us();
+                int paid = engine_pay(user_id, round_res[r], "card");
+                bench_record(&series[B_PAY], t);
+                if (paid < 0) continue;
+                int vehicle_index = find_vehicle_index(reservations[index].vehicle_id);
+                strcpy(exits[exit_count].plate, vehicles[vehicle_index].license_plate);
+                exits[exit_count].is_exit = 1;
+                exits[exit_count].event_time = now_epoch();
+                exit_count++;
+            } else {
+                t = monotonic_us();
+                engine_cancel(user_id, round_res[r]);
+                bench_record(&series[B_CANCEL], t);
+            }
+        }
+        t = monotonic_us();
+        journal_commit();
+        bench_record(&series[B_COMMIT], t);
+
+        IngestStats stats;
+        for (int e = 0; e < exit_count; e += ANPR_BATCH_MAX) {
+            int batch = exit_count - e < ANPR_BATCH_MAX ? exit_count - e : ANPR_BATCH_MAX;
+            t = monotonic_us();
+            ingest_plate_events(exits + e, batch, &stats);
+            bench_record(&series[B_ANPR_EXIT], t);
+        }
+        stalled = reservation_count >= MAX_RESERVATIONS || payment_count >= MAX_PAYMENTS;
+    }
+    for (int type = 0; type < 3; type++) free(vehicle_of_type[type]);
+    free(round_res);
+    free(exits);
+
+    ReportTotals totals;
+    for (int run = 0; run < BENCH_REPORT_RUNS; run++) {
+        t = monotonic_us();
+        compute_report_totals(-1, &totals);
+        bench_record(&series[B_REPORT_ALL], t);
+    }
+    for (int run = 0; run < BENCH_REPORT_RUNS && user_count > 0; run++) {
+        int user_id = users[bench_random(user_count)].user_id;
+        t = monotonic_us();
+        compute_report_totals(user_id, &totals);
+        bench_record(&series[B_REPORT_USER], t);
+    }
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"limits\": {\"max_users\": %d, \"max_vehicles\": %d, \"max_slots\": %d, "
+                 "\"max_reservations\": %d, \"max_payments\": %d},\n",
+            MAX_USERS, MAX_VEHICLES, MAX_SLOTS, MAX_RESERVATIONS, MAX_PAYMENTS);
+    fprintf(out, "  \"dataset\": {\"users\": %d, \"vehicles\": %d, \"reservations\": %d, "
+                 "\"payments\": %d, \"slots\": %d},\n",
+            generated[0], generated[1], generated[2], generated[3], slot_count);
+    fprintf(out, "  \"operations\": [\n");
+    for (int b = 0; b < B_COUNT; b++) {
+        bench_write_series(out, &series[b], b == B_COUNT - 1);
+        free(series[b].samples_us);
+    }
+    fprintf(out, "  ],\n");
+    fprintf(out, "  \"peak_rss_kb\": %ld\n", bench_peak_rss_kb());
+    fprintf(out, "}\n");
+    return 0;
+}
+
+// Capacity Simulator
+// --simulate <b/c/t>[,<b/c/t>...] plays a stream of arrivals against each
+// slot layout (bike/car/truck slot counts) through the real engine:
+// engine_reserve and engine_pay when a vehicle arrives, an ANPR exit when it
+// leaves, all on a fixed engine clock that jumps from event to event.
+// Arrivals are Poisson (--sim-arrivals per hour and vehicle type, with
+// exponential stays around --sim-stay hours) or read from --sim-trace.
+// Run r draws its arrivals once, before any layout is involved, from one
+// random stream per vehicle type and one per type for stays. Every layout
+// therefore sees the same vehicles at the same times. Runs are forked
+// across the cores. Each works in its own SIM_DIR/run_<n>
+// directory and leaves its totals in shared memory; the JSON report gives
+// the per-run means for every layout.
+static const char *sim_type_names[3] = {"bike", "car", "truck"};
+static SimEvent *sim_heap = NULL; // event queue, a binary min-heap on time
+static int sim_heap_count = 0, sim_heap_capacity = 0;
+
+// xorshift64 mapped into (0, 1)
+static double sim_uniform(unsigned long long *state) {
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return ((*state >> 11) + 0.5) / 9007199254740992.0;
+}
+
+// Natural logarithm for 0 < x <= 1; the build does not link the math library
+static double sim_log(double x) {
+    double result = 0;
+    while (x < 0.5) {
+        x *= 2;
+        result -= 0.69314718055994531;
+    }
+    double z = (x - 1) / (x + 1), term = z;
+    for (int n = 1; n < 40; n += 2) {
+        result += 2 * term / n;
+        term *= z * z;
+    }
+    return result;
+}
+
+static double sim_exponential(unsigned long long *state, double mean) {
+    return -mean * sim_log(sim_uniform(state));
+}
+
+// Ties are broken on every field so the order never depends on heap history
+static int sim_event_before(const SimEvent *a, const SimEvent *b) {
+    if (a->at != b->at) return a->at < b->at;
+    if (a->kind != b->kind) return a->kind < b->kind;
+    if (a->type != b->type) return a->type < b->type;
+    return a->vehicle < b->vehicle;
+}
+
+static void sim_schedule(long long at, int kind, int type, int vehicle, double hours) {
+    if (sim_heap_count == sim_heap_capacity) {
+        int capacity = sim_heap_capacity > 0 ? sim_heap_capacity * 2 : 256;
+        SimEvent *grown = (SimEvent *)realloc(sim_heap, capacity * sizeof(SimEvent));
+        if (grown == NULL) return;
+        sim_heap = grown;
+        sim_heap_capacity = capacity;
+    }
+    SimEvent event = {at, kind, type, vehicle, hours};
+    int i = sim_heap_count++;
+    while (i > 0 && sim_event_before(&event, &sim_heap[(i - 1) / 2])) {
+        sim_heap[i] = sim_heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    sim_heap[i] = event;
+}
+
+static SimEvent sim_next_event() {
+    SimEvent top = sim_heap[0], last = sim_heap[--sim_heap_count];
+    int i = 0;
+    while (2 * i + 1 < sim_heap_count) {
+        int child = 2 * i + 1;
+        if (child + 1 < sim_heap_count && sim_event_before(&sim_heap[child + 1], &sim_heap[child])) child++;
+        if (!sim_event_before(&sim_heap[child], &last)) break;
+        sim_heap[i] = sim_heap[child];
+        i = child;
+    }
+    if (sim_heap_count > 0) sim_heap[i] = last;
+    return top;
+}
+
+// "40/40/20,30/50/20": bike, car and truck slots of each layout
+static int sim_parse_layouts(const char *spec, SimConfig *config) {
+    config->layout_count = 0;
+    while (*spec != '\0' && config->layout_count < SIM_MAX_LAYOUTS) {
+        int *layout = config->layouts[config->layout_count];
+        int used = 0;
+        if (sscanf(spec, "%d/%d/%d%n", &layout[0], &layout[1], &layout[2], &used) != 3 ||
+            layout[0] < 0 || layout[1] < 0 || layout[2] < 0) {
+            return -1;
+        }
+        int total = layout[0] + layout[1] + layout[2];
+        if (total < 1 || total > MAX_SLOTS || total + 3 > MAX_USERS || total + 3 > MAX_VEHICLES) return -1;
+        config->layout_count++;
+        spec += used;
+        if (*spec == ',') spec++;
+        else if (*spec != '\0') return -1;
+    }
+    return config->layout_count > 0 && *spec == '\0' ? 0 : -1;
+}
+
+// One arrival per line: "<minutes from start> <bike|car|truck> <stay hours>"
+static int sim_load_trace(const char *path, SimConfig *config) {
+    FILE *file = fopen(path, "r");
+    char line[256], type[16];
+    double minutes, hours;
+    int capacity = 0;
+
+    if (file == NULL) return -1;
+    while (fgets(line, sizeof(line), file) != NULL) {
+        if (line[0] == '#' || sscanf(line, "%lf %15s %lf", &minutes, type, &hours) != 3 || minutes < 0) continue;
+        if (strcmp(type, "bike") != 0 && strcmp(type, "car") != 0 && strcmp(type, "truck") != 0) continue;
+        if (config->trace_count == capacity) {
+            capacity = capacity > 0 ? capacity * 2 : 1024;
+            SimEvent *grown = (SimEvent *)realloc(config->trace, capacity * sizeof(SimEvent));
+            if (grown == NULL) break;
+            config->trace = grown;
+        }
+        SimEvent *event = &config->trace[config->trace_count++];
+        event->at = (long long)(minutes * 60 + 0.5); // from the start; the run adds config->start
+        event->kind = SIM_ARRIVE;
+        event->type = slot_type_code(type);
+        event->vehicle = -1;
+        event->hours = hours;
+    }
+    fclose(file);
+    return config->trace_count > 0 ? 0 : -1;
+}
+
+// Poisson arrivals of run `run`, as offsets from the start like a trace.
+// Returns how many were stored in *out (to be freed), -1 without memory.
+static int sim_generate_arrivals(const SimConfig *config, int run, SimEvent **out) {
+    long long span = (long long)config->days * 86400;
+    int count = 0, capacity = 0;
+
+    *out = NULL;
+    for (int type = 0; type < 3; type++) {
+        if (config->arrivals_per_hour[type] <= 0) continue;
+        unsigned long long arrival_state = 0x9E3779B97F4A7C15ULL * (unsigned long long)(run * 6 + type * 2 + 1);
+        unsigned long long stay_state = 0x9E3779B97F4A7C15ULL * (unsigned long long)(run * 6 + type * 2 + 2);
+        long long at = 0;
+        for (;;) {
+            at += (long long)(sim_exponential(&arrival_state, 3600 / config->arrivals_per_hour[type]) + 0.5);
+            if (at > span) break;
+            if (count == capacity) {
+                capacity = capacity > 0 ? capacity * 2 : 1024;
+                SimEvent *grown = (SimEvent *)realloc(*out, capacity * sizeof(SimEvent));
+                if (grown == NULL) {
+                    free(*out);
+                    *out = NULL;
+                    return -1;
+                }
+                *out = grown;
+            }
+            SimEvent *event = &(*out)[count++];
+            event->at = at;
+            event->kind = SIM_ARRIVE;
+            event->type = type;
+            event->vehicle = -1;
+            event->hours = sim_exponential(&stay_state, config->mean_stay_hours);
+        }
+    }
+    return count;
+}
+
+// Slots numbered from 1: bikes first, then cars, then trucks
+static void sim_set_layout(const int *layout) {
+    slot_count = 0;
+    for (int type = 0; type < 3; type++) {
+        for (int i = 0; i < layout[type]; i++) {
+            Slot *slot = &slots[slot_count];
+            slot->slot_id = slot_count + 1;
+            strcpy(slot->type, sim_type_names[type]);
+            strcpy(slot->status, "available");
+            slot->vehicle_id = 0;
+            slot->user_id = 0;
+            slot->reserved_time = 0;
+            slot_count++;
+        }
+    }
+    slot_counts_rebuild();
+}
+
+// Drops finished bookings and their payments so a long run fits the tables
+static void sim_compact() {
+    int kept = 0;
+    for (int i = 0; i < reservation_count; i++) {
+        if (strcmp(reservations[i].status, "active") == 0) reservations[kept++] = reservations[i];
+    }
+    reservation_count = kept;
+    kept = 0;
+    for (int p = 0; p < payment_count; p++) {
+        if (find_reservation_index(payments[p].reservation_id) != -1) payments[kept++] = payments[p];
+    }
+    payment_count = kept;
+    timers_rebuild();
+    journal_checkpoint();
+}
+
+// Moves the engine clock to `at`, adding the parked time since the last event
+static void sim_elapse(SimResult *result, const int *busy, long long *last, long long at) {
+    for (int type = 0; type < 3; type++) result->occupied_seconds[type] += busy[type] * (double)(at - *last);
+    *last = at;
+    clock_origin = at;
+}
+
+static void sim_run(const SimConfig *config, int layout, int run, SimResult *result) {
+    const int *layout_slots = config->layouts[layout];
+    int *idle[3], idle_count[3] = {0, 0, 0}, busy[3] = {0, 0, 0}, first_slot[3];
+    long long end = config->start + (long long)config->days * 86400, last = config->start;
+    char text[4][MAX_STRING];
+    PlateEvent exits[ANPR_BATCH_MAX];
+    IngestStats stats;
+    double started = monotonic_us();
+
+    memset(result, 0, sizeof(SimResult));
+    const SimEvent *arrivals = config->trace;
+    int arrival_count = config->trace_count;
+    SimEvent *generated = NULL;
+    if (arrivals == NULL) {
+        arrival_count = sim_generate_arrivals(config, run, &generated);
+        if (arrival_count < 0) return; // left not done: reported as a failed run
+        arrivals = generated;
+    }
+    user_count = vehicle_count = reservation_count = payment_count = 0;
+    memset(plate_index, 0, sizeof(plate_index));
+    plate_index_count = 0;
+    sim_set_layout(layout_slots);
+    first_slot[0] = 0;
+    first_slot[1] = layout_slots[0];
+    first_slot[2] = layout_slots[0] + layout_slots[1];
+    journal_checkpoint();
+    clock_mode = CLOCK_FIXED;
+    clock_origin = config->start;
+    timers_rebuild();
+    sim_heap_count = 0;
+
+    // Customers waiting to arrive: one per slot, plus one, for each vehicle type
+    for (int type = 0; type < 3; type++) {
+        idle[type] = (int *)malloc((layout_slots[type] + 1) * sizeof(int));
+        for (int i = 0; idle[type] != NULL && i <= layout_slots[type]; i++) {
+            int id = user_count + 1;
+            sprintf(text[0], "Sim%d", id);
+            sprintf(text[1], "019%08d", id);
+            sprintf(text[2], "sim%d@sim.test", id);
+            sprintf(text[3], "pass%d", id);
+            int user = engine_register_user(text[0], text[1], text[2], text[3]);
+            if (user < 0) break;
+            sprintf(text[0], "SIM-%06d", id);
+            int vehicle = engine_add_vehicle(users[user].user_id, sim_type_names[type], text[0], "grey");
+            if (vehicle < 0) break;
+            idle[type][idle_count[type]++] = vehicle;
+        }
+    }
+    journal_commit();
+
+    for (int i = 0; i < arrival_count; i++) {
+        sim_schedule(config->start + arrivals[i].at, SIM_ARRIVE, arrivals[i].type, -1, arrivals[i].hours);
+    }
+    free(generated);
+
+    while (sim_heap_count > 0 && sim_heap[0].at <= end) {
+        SimEvent event = sim_next_event();
+        sim_elapse(result, busy, &last, event.at);
+        result->events++;
+
+        if (event.kind == SIM_DEPART) {
+            // Departures before the next arrival leave through one ANPR batch
+            int exit_count = 0;
+            for (;;) {
+                copy_field(exits[exit_count].plate, sizeof(exits[exit_count].plate),
+                           vehicles[event.vehicle].license_plate);
+                exits[exit_count].is_exit = 1;
+                exits[exit_count].event_time = event.at;
+                exit_count++;
+                busy[event.type]--;
+                idle[event.type][idle_count[event.type]++] = event.vehicle;
+                if (exit_count == ANPR_BATCH_MAX || sim_heap_count == 0 || sim_heap[0].kind != SIM_DEPART ||
+                    sim_heap[0].at > end) {
+                    break;
+                }
+                event = sim_next_event();
+                sim_elapse(result, busy, &last, event.at);
+                result->events++;
+            }
+            ingest_plate_events(exits, exit_count, &stats);
+            continue;
+        }
+
+        int type = event.type;
+        double hours = event.hours;
+        result->arrivals[type]++;
+        if (hours < SIM_MIN_STAY_HOURS) hours = SIM_MIN_STAY_HOURS;
+        if (hours > 24) hours = 24;
+
+        // The kiosk books the lowest free slot of the type, in whole hours
+        int slot_index = -1;
+        for (int i = first_slot[type]; i < first_slot[type] + layout_slots[type] && slot_index == -1; i++) {
+            if (strcmp(slots[i].status, "available") == 0) slot_index = i;
+        }
+        if (slot_index == -1 || idle_count[type] == 0) {
+            result->rejected[type]++;
+            continue;
+        }
+        int vehicle = idle[type][--idle_count[type]];
+        int booked = (int)hours;
+        if (booked < hours) booked++;
+        int index = engine_reserve(vehicles[vehicle].user_id, vehicles[vehicle].vehicle_id,
+                                   slots[slot_index].slot_id, booked);
+        if (index < 0) {
+            idle[type][idle_count[type]++] = vehicle;
+            result->rejected[type]++;
+            continue;
+        }
+        int paid = engine_pay(vehicles[vehicle].user_id, reservations[index].reservation_id, "card");
+        if (paid >= 0) result->revenue[type] += payments[paid].amount;
+        busy[type]++;
+        sim_schedule(event.at + (long long)(hours * 3600 + 0.5), SIM_DEPART, type, vehicle, 0);
+
+        if (reservation_count >= MAX_RESERVATIONS - 1 || payment_count >= MAX_PAYMENTS - 1) sim_compact();
+    }
+    sim_elapse(result, busy, &last, end); // vehicles still parked at the end
+    journal_commit();
+
+    for (int type = 0; type < 3; type++) free(idle[type]);
+    result->wall_us = monotonic_us() - started;
+    result->done = 1;
+}
+
+static int sim_enter_directory(const char *name) {
+#ifdef _WIN32
+    _mkdir(name);
+    return _chdir(name);
+#else
+    mkdir(name, 0755);
+    return chdir(name);
+#endif
+}
+
+// Job n is run n % runs of layout n / runs
+static void sim_run_job(const SimConfig *config, int job, SimResult *result) {
+    char name[32];
+    sprintf(name, "run_%d", job);
+    if (sim_enter_directory(name) != 0) return;
+    sim_run(config, job / config->runs, job % config->runs, result);
+    if (chdir("..") != 0) return;
+}
+
+// Returns 0, 1 when the settings or the scratch directory are unusable, 2 when a run failed
+int run_simulation(const char *layout_spec, const char *arrivals, double mean_stay_hours, int days, int runs,
+                   const char *trace_path, FILE *out) {
+    SimConfig config;
+    char when[TIME_TEXT_SIZE];
+
+    memset(&config, 0, sizeof(config));
+    if (sim_parse_layouts(layout_spec, &config) != 0) {
+        fprintf(stderr, "Bad layouts %s: bike/car/truck slot counts, comma separated, at most %d layouts of %d slots\n",
+                layout_spec, SIM_MAX_LAYOUTS, MAX_SLOTS);
+        return 1;
+    }
+    if (sscanf(arrivals, "%lf,%lf,%lf", &config.arrivals_per_hour[0], &config.arrivals_per_hour[1],
+               &config.arrivals_per_hour[2]) != 3 ||
+        config.arrivals_per_hour[0] < 0 || config.arrivals_per_hour[1] < 0 || config.arrivals_per_hour[2] < 0) {
+        fprintf(stderr, "Bad arrival rates %s: bikes,cars,trucks per hour\n", arrivals);
+        return 1;
+    }
+    if (trace_path != NULL && sim_load_trace(trace_path, &config) != 0) {
+        fprintf(stderr, "Cannot read arrivals from %s\n", trace_path);
+        return 1;
+    }
+    config.mean_stay_hours = mean_stay_hours > 0 ? mean_stay_hours : SIM_DEFAULT_STAY_HOURS;
+    config.runs = runs > 0 ? runs : SIM_DEFAULT_RUNS;
+    config.start = clock_mode != CLOCK_REAL ? clock_origin : parse_time(SIM_START_TIME);
+    config.days = days > 0 ? days : SIM_DEFAULT_DAYS;
+    if (days <= 0 && config.trace != NULL) {
+        long long span = 0;
+        for (int i = 0; i < config.trace_count; i++) {
+            if (config.trace[i].at > span) span = config.trace[i].at;
+        }
+        config.days = (int)(span / 86400) + 1;
+    }
+
+    pricing_load(); // the lot's tariff, read before leaving its directory
+    if (sim_enter_directory(SIM_DIR) != 0) {
+        fprintf(stderr, "Cannot use simulation directory %s\n", SIM_DIR);
+        free(config.trace);
+        return 1;
+    }
+    journal_sync = 0;
+    hold_ttl_seconds = 0; // every booking is paid at once
+
+    int jobs = config.layout_count * config.runs;
+    int workers = pool_cpu_count() < jobs ? pool_cpu_count() : jobs;
+    double started = monotonic_us();
+#ifdef _WIN32
+    SimResult *results = (SimResult *)calloc(jobs, sizeof(SimResult));
+    workers = 1;
+    for (int job = 0; results != NULL && job < jobs; job++) sim_run_job(&config, job, &results[job]);
+#else
+    // Shared with the forked workers, which each fill in their own entry
+    SimResult *results = (SimResult *)mmap(NULL, jobs * sizeof(SimResult), PROT_READ | PROT_WRITE,
+                                           MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (results == MAP_FAILED) results = NULL;
+    int running = 0;
+    fflush(stdout);
+    fflush(out);
+    for (int job = 0; results != NULL && job < jobs; job++) {
+        if (running == workers && wait(NULL) > 0) running--;
+        pid_t pid = fork();
+        if (pid == 0) {
+            sim_run_job(&config, job, &results[job]);
+            _exit(0);
+        }
+        if (pid < 0) sim_run_job(&config, job, &results[job]); // no process to spare: run it here
+        else running++;
+    }
+    while (running > 0 && wait(NULL) > 0) running--;
+#endif
+    double wall_seconds = (monotonic_us() - started) / 1e6;
+    if (results == NULL) {
+        fprintf(stderr, "Cannot allocate the simulation results\n");
+        free(config.trace);
+        return 1;
+    }
+
+    long long events = 0;
+    int finished_total = 0, best = -1;
+    double best_revenue = -1;
+    fprintf(out, "{\n");
+    fprintf(out, "  \"start\": \"%s\",\n", format_time(config.start, when));
+    fprintf(out, "  \"days\": %d,\n", config.days);
+    fprintf(out, "  \"runs_per_layout\": %d,\n", config.runs);
+    if (config.trace != NULL) {
+        fprintf(out, "  \"arrivals\": {\"trace\": \"%s\", \"count\": %d},\n", trace_path, config.trace_count);
+    } else {
+        fprintf(out, "  \"arrivals\": {\"bike_per_hour\": %.2f, \"car_per_hour\": %.2f, \"truck_per_hour\": %.2f, "
+                     "\"mean_stay_hours\": %.2f},\n",
+                config.arrivals_per_hour[0], config.arrivals_per_hour[1], config.arrivals_per_hour[2],
+                config.mean_stay_hours);
+    }
+    fprintf(out, "  \"layouts\": [\n");
+    for (int l = 0; l < config.layout_count; l++) {
+        const int *layout = config.layouts[l];
+        SimResult total;
+        int finished = 0;
+        memset(&total, 0, sizeof(total));
+        for (int r = 0; r < config.runs; r++) {
+            const SimResult *result = &results[l * config.runs + r];
+            if (!result->done) continue;
+            finished++;
+            total.events += result->events;
+            for (int type = 0; type < 3; type++) {
+                total.arrivals[type] += result->arrivals[type];
+                total.rejected[type] += result->rejected[type];
+                total.occupied_seconds[type] += result->occupied_seconds[type];
+                total.revenue[type] += result->revenue[type];
+            }
+        }
+        events += total.events;
+        finished_total += finished;
+
+        // Means per run
+        double runs_done = finished > 0 ? finished : 1, seconds = config.days * 86400.0;
+        double arrivals_all = 0, rejected_all = 0, occupied_all = 0, revenue_all = 0;
+        int slots_all = layout[0] + layout[1] + layout[2];
+        for (int type = 0; type < 3; type++) {
+            arrivals_all += total.arrivals[type] / runs_done;
+            rejected_all += total.rejected[type] / runs_done;
+            occupied_all += total.occupied_seconds[type] / runs_done;
+            revenue_all += total.revenue[type] / runs_done;
+        }
+        if (finished > 0 && revenue_all > best_revenue) {
+            best_revenue = revenue_all;
+            best = l;
+        }
+        fprintf(out, "    {\"layout\": \"%d/%d/%d\", \"runs\": %d, \"revenue\": %.2f, \"revenue_per_slot_day\": %.2f, "
+                     "\"rejection_rate\": %.4f, \"utilization\": %.4f, \"types\": [\n",
+                layout[0], layout[1], layout[2], finished, revenue_all, revenue_all / (slots_all * config.days),
+                arrivals_all > 0 ? rejected_all / arrivals_all : 0.0, occupied_all / (slots_all * seconds));
+        for (int type = 0; type < 3; type++) {
+            double arrived = total.arrivals[type] / runs_done, rejected = total.rejected[type] / runs_done;
+            fprintf(out, "      {\"type\": \"%s\", \"slots\": %d, \"arrivals\": %.1f, \"rejected\": %.1f, "
+                         "\"rejection_rate\": %.4f, \"utilization\": %.4f, \"revenue\": %.2f}%s\n",
+                    sim_type_names[type], layout[type], arrived, rejected, arrived > 0 ? rejected / arrived : 0.0,
+                    layout[type] > 0 ? total.occupied_seconds[type] / runs_done / (layout[type] * seconds) : 0.0,
+                    total.revenue[type] / runs_done, type < 2 ? "," : "");
+        }
+        fprintf(out, "    ]}%s\n", l < config.layout_count - 1 ? "," : "");
+    }
+    fprintf(out, "  ],\n");
+    if (best >= 0) {
+        fprintf(out, "  \"best_layout_by_revenue\": \"%d/%d/%d\",\n",
+                config.layouts[best][0], config.layouts[best][1], config.layouts[best][2]);
+    }
+    fprintf(out, "  \"failed_runs\": %d,\n", jobs - finished_total);
+    fprintf(out, "  \"workers\": %d,\n", workers);
+    fprintf(out, "  \"events\": %lld,\n", events);
+    fprintf(out, "  \"wall_seconds\": %.3f,\n", wall_seconds);
+    fprintf(out, "  \"simulated_to_real\": %.0f\n",
+            wall_seconds > 0 ? finished_total * config.days * 86400.0 / wall_seconds : 0.0);
+    fprintf(out, "}\n");
+
+#ifdef _WIN32
+    free(results);
+#else
+    munmap(results, jobs * sizeof(SimResult));
+#endif
+    free(config.trace);
+    return finished_total == jobs ? 0 : 2;
+}
+
+// Closed-Loop Load Generator
+// --loadgen <port> starts N kiosk clients against a --serve daemon (port 0:
+// against this process's engine, serialized by one lock). Each client books,
+// pays, cancels and drives out its own vehicles as fast as the server
+// answers, with a random think time between operations. Reserve follows the
+// kiosk flow: list free slots, pick one, reserve; a slot taken by another
+// client in between counts as a conflict and is retried.
+static const char *load_op_names[LOAD_OP_COUNT] = {"list_free", "reserve", "pay", "cancel", "exit"};
+static int loadgen_weights[4];        // reserve, pay, cancel, exit
+static int loadgen_think_ms;
+static double loadgen_started_us;
+static double loadgen_deadline_us;
+static pool_mutex_t loadgen_engine_lock;
+
+static int loadgen_random(LoadClient *client, int limit) {
+    client->rng ^= client->rng << 13;
+    client->rng ^= client->rng >> 7;
+    client->rng ^= client->rng << 17;
+    return limit > 0 ? (int)(client->rng % (unsigned long long)limit) : 0;
+}
+
+#ifndef _WIN32
+// Returns the next line of the daemon's output, -1 once the connection is gone
+static int loadgen_read_line(LoadClient *client, char *line, int size) {
+    for (;;) {
+        char *newline = memchr(client->input, '\n', client->input_length);
+        if (newline != NULL) {
+            int length = (int)(newline - client->input);
+            int copied = length < size - 1 ? length : size - 1;
+            memcpy(line, client->input, copied);
+            line[copied] = '\0';
+            client->input_length -= length + 1;
+            memmove(client->input, newline + 1, client->input_length);
+            return copied;
+        }
+        if (client->input_length == (int)sizeof(client->input)) client->input_length = 0; // overlong menu line
+        int n = (int)read(client->fd, client->input + client->input_length,
+                          sizeof(client->input) - client->input_length);
+        if (n <= 0) return -1;
+        client->input_length += n;
+    }
+}
+#endif
+
+// Sends one ! query and waits for its "OK ..." or "ERR ..." line
+static int loadgen_exchange(LoadClient *client, const char *request, char *reply) {
+    if (client->fd < 0) {
+        pool_mutex_lock(&loadgen_engine_lock);
+        if (strncmp(request, "!FREE ", 6) == 0) {
+            format_free_slots(request + 6, reply, SESSION_REPLY_MAX);
+        } else {
+            char result[256];
+            int code = script_command(request + 4, result);
+            if (journal_pending_records > 0) journal_commit();
+            if (journal_records_since_checkpoint >= JOURNAL_CHECKPOINT_RECORDS) save_data();
+            snprintf(reply, SESSION_REPLY_MAX, "%s %s", code < 0 ? "ERR" : "OK", result);
+        }
+        pool_mutex_unlock(&loadgen_engine_lock);
+        return strncmp(reply, "OK", 2) == 0;
+    }
+#ifdef _WIN32
+    snprintf(reply, SESSION_REPLY_MAX, "ERR no sockets");
+    return 0;
+#else
+    char line[SESSION_INPUT_MAX + 2];
+    int length = snprintf(line, sizeof(line), "%s\n", request);
+    if (write(client->fd, line, length) != length) {
+        snprintf(reply, SESSION_REPLY_MAX, "ERR connection lost");
+        return 0;
+    }
+    for (;;) {
+        if (loadgen_read_line(client, reply, SESSION_REPLY_MAX) < 0) {
+            snprintf(reply, SESSION_REPLY_MAX, "ERR connection lost");
+            return 0;
+        }
+        if (strncmp(reply, "OK ", 3) == 0) return 1;
+        if (strncmp(reply, "ERR ", 4) == 0) return 0;
+    }
+#endif
+}
+
+static int loadgen_call(LoadClient *client, const char *request, char *reply) {
+    int ok = loadgen_exchange(client, request, reply);
+    if (!ok && strstr(reply, engine_error_text(ENGINE_ERR_FULL)) != NULL) client->table_full = 1;
+    return ok;
+}
+
+static void loadgen_record(LoadClient *client, LoadOp op, double started_us, int ok) {
+    double us = monotonic_us() - started_us;
+    LoadOpStats *stats = &client->ops[op];
+    int bucket = 0;
+    while (bucket < LOADGEN_BUCKETS - 1 && us >= (double)(2ULL << bucket)) bucket++;
+    stats->buckets[bucket]++;
+    stats->count++;
+    stats->total_us += us;
+    if (us > stats->max_us) stats->max_us = us;
+    if (!ok) stats->errors++;
+
+    int second = (int)((monotonic_us() - loadgen_started_us) / 1e6);
+    if (second >= 0 && second < LOADGEN_MAX_SECONDS) client->per_second[second]++;
+}
+
+#ifndef _WIN32
+// Sends menu input and reads lines until one contains `success`; a line
+// containing `failure` or a lost connection ends the wait early
+static int loadgen_menu(LoadClient *client, const char *input, const char *success,
+                        const char *failure, char *line) {
+    int length = (int)strlen(input);
+    if (write(client->fd, input, length) != length) return 0;
+    for (;;) {
+        if (loadgen_read_line(client, line, SESSION_REPLY_MAX) < 0) return 0;
+        if (strstr(line, success) != NULL) return 1;
+        if (strstr(line, failure) != NULL) return 0;
+    }
+}
+#endif
+
+// A customer and one vehicle of each type, so every slot type sees traffic.
+// Daemon clients register and log in through the menus first, because the
+// daemon answers !DO only for a logged-in session.
+static int loadgen_setup(LoadClient *client) {
+    static const char *types[3] = {"bike", "car", "truck"};
+    char request[SESSION_INPUT_MAX], reply[SESSION_REPLY_MAX];
+    unsigned int tag = (unsigned int)(time(NULL) % 100000) * 1000 + client->index;
+
+#ifndef _WIN32
+    // The daemon greets with its menu; the first query reply marks its end
+    if (client->fd >= 0) {
+        char *id;
+        if (!loadgen_menu(client, "!STATUS\n", "OK STATUS", "ERR ", reply)) return 0;
+        snprintf(request, sizeof(request), "1\nKiosk%u\n016%08u\nkiosk%u@loadgen.test\nload%u\n",
+                 tag, tag, tag, tag);
+        if (!loadgen_menu(client, request, "Customer ID:", "failed", reply) ||
+            (id = strstr(reply, "Customer ID:")) == NULL || sscanf(id, "Customer ID: %d", &client->user_id) != 1) {
+            fprintf(stderr, "client %d: register failed: %s\n", client->index, reply);
+            return 0;
+        }
+        snprintf(request, sizeof(request), "2\n016%08u\nload%u\n", tag, tag);
+        if (!loadgen_menu(client, request, "Welcome back", "FAILED", reply)) {
+            fprintf(stderr, "client %d: login failed: %s\n", client->index, reply);
+            return 0;
+        }
+        if (!loadgen_menu(client, "!STATUS\n", "OK STATUS", "ERR ", reply)) return 0; // past the dashboard
+    }
+#endif
+    snprintf(request, sizeof(request), "!DO register Kiosk%u 016%08u kiosk%u@loadgen.test load%u",
+             tag, tag, tag, tag);
+    if (client->fd < 0 &&
+        (!loadgen_call(client, request, reply) || sscanf(reply, "OK user %d", &client->user_id) != 1)) {
+        fprintf(stderr, "client %d: register failed: %s\n", client->index, reply);
+        return 0;
+    }
+    for (int v = 0; v < 3; v++) {
+        snprintf(client->plate[v], sizeof(client->plate[v]), "LG%d-%c", client->user_id, types[v][0]);
+        snprintf(request, sizeof(request), "!DO add-vehicle %d %s %s grey", client->user_id, types[v], client->plate[v]);
+        if (!loadgen_call(client, request, reply) || sscanf(reply, "OK vehicle %d", &client->vehicle_id[v]) != 1) {
+            fprintf(stderr, "client %d: add-vehicle failed: %s\n", client->index, reply);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Picks a vehicle in the given state, -1 if there is none
+static int loadgen_pick_vehicle(LoadClient *client, int state) {
+    int start = loadgen_random(client, 3);
+    for (int k = 0; k < 3; k++) {
+        int v = (start + k) % 3;
+        if (client->vehicle_state[v] == state) return v;
+    }
+    return -1;
+}
+
+static void loadgen_reserve(LoadClient *client, int v) {
+    static const char *types[3] = {"bike", "car", "truck"};
+    char request[SESSION_INPUT_MAX], reply[SESSION_REPLY_MAX];
+
+    for (int attempt = 0; attempt <= LOADGEN_MAX_RETRIES; attempt++) {
+        int free_ids[SESSION_FREE_LIST], listed = 0, used = 0, pos = 8 + (int)strlen(types[v]);
+        snprintf(request, sizeof(request), "!FREE %s", types[v]);
+        double t = monotonic_us();
+        int ok = loadgen_call(client, request, reply);
+        loadgen_record(client, LOAD_LIST_FREE, t, ok);
+        while (ok && listed < SESSION_FREE_LIST && pos < (int)strlen(reply) &&
+               sscanf(reply + pos, "%d%n", &free_ids[listed], &used) == 1) {
+            listed++;
+            pos += used;
+        }
+        if (listed == 0) {
+            client->lot_full++;
+            return;
+        }
+
+        snprintf(request, sizeof(request), "!DO reserve %d %d %d %d", client->user_id, client->vehicle_id[v],
+                 free_ids[loadgen_random(client, listed)], 1 + loadgen_random(client, 4));
+        t = monotonic_us();
+        ok = loadgen_call(client, request, reply);
+        int taken = !ok && strstr(reply, engine_error_text(ENGINE_ERR_UNAVAILABLE)) != NULL;
+        loadgen_record(client, LOAD_RESERVE, t, ok || taken);
+        if (ok && sscanf(reply, "OK reservation %d", &client->reservation_id[v]) == 1) {
+            client->vehicle_state[v] = 1;
+            return;
+        }
+        if (!taken) return;
+        client->conflicts++;
+        if (attempt < LOADGEN_MAX_RETRIES) client->retries++;
+    }
+}
+
+#ifdef _WIN32
+static DWORD WINAPI loadgen_client_main(LPVOID arg) {
+#else
+static void *loadgen_client_main(void *arg) {
+#endif
+    static const char *methods[] = {"cash", "card", "bkash", "nagad"};
+    LoadClient *client = (LoadClient *)arg;
+    char request[SESSION_INPUT_MAX], reply[SESSION_REPLY_MAX];
+
+    client->ready = loadgen_setup(client);
+    while (client->ready && !client->table_full && monotonic_us() < loadgen_deadline_us) {
+        // Draw an operation from the mix among those this kiosk can do now
+        int eligible[4], total = 0;
+        eligible[0] = loadgen_pick_vehicle(client, 0) >= 0 ? loadgen_weights[0] : 0;
+        eligible[1] = loadgen_pick_vehicle(client, 1) >= 0 ? loadgen_weights[1] : 0;
+        eligible[2] = loadgen_pick_vehicle(client, 1) >= 0 ? loadgen_weights[2] : 0;
+        eligible[3] = loadgen_pick_vehicle(client, 2) >= 0 ? loadgen_weights[3] : 0;
+        for (int k = 0; k < 4; k++) total += eligible[k];
+        if (total == 0) {
+            sleep_ms(10);
+            continue;
+        }
+        int roll = loadgen_random(client, total), choice = 0;
+        while (roll >= eligible[choice]) roll -= eligible[choice++];
+
+        if (choice == 0) {
+            loadgen_reserve(client, loadgen_pick_vehicle(client, 0));
+        } else if (choice == 1 || choice == 2) {
+            int v = loadgen_pick_vehicle(client, 1);
+            if (choice == 1) {
+                snprintf(request, sizeof(request), "!DO pay %d %d %s", client->user_id,
+                         client->reservation_id[v], methods[loadgen_random(client, 4)]);
+            } else {
+                snprintf(request, sizeof(request), "!DO cancel %d %d", client->user_id, client->reservation_id[v]);
+            }
+            double t = monotonic_us();
+            int ok = loadgen_call(client, request, reply);
+            loadgen_record(client, choice == 1 ? LOAD_PAY : LOAD_CANCEL, t, ok);
+            client->vehicle_state[v] = ok && choice == 1 ? 2 : 0;
+        } else {
+            int v = loadgen_pick_vehicle(client, 2);
+            snprintf(request, sizeof(request), "!DO exit %s", client->plate[v]);
+            double t = monotonic_us();
+            int ok = loadgen_call(client, request, reply);
+            loadgen_record(client, LOAD_EXIT, t, ok);
+            client->vehicle_state[v] = 0;
+        }
+
+        if (loadgen_think_ms > 0) sleep_ms(loadgen_random(client, 2 * loadgen_think_ms + 1));
+    }
+    return 0;
+}
+
+// Upper edge of the histogram bucket holding the p-th percentile
+static double loadgen_percentile(const LoadOpStats *stats, double p) {
+    unsigned long long seen = 0, rank = (unsigned long long)(p / 100.0 * stats->count + 0.999999);
+    for (int b = 0; b < LOADGEN_BUCKETS; b++) {
+        seen += stats->buckets[b];
+        if (seen >= rank && seen > 0) return (double)(2ULL << b);
+    }
+    return 0;
+}
+
+static int loadgen_compare_int(const void *a, const void *b) {
+    return *(const int *)a - *(const int *)b;
+}
+
+// Returns 0, or 1 when no client could start
+int run_load_generator(int port, int client_count, int seconds, int think_ms, const char *mix) {
+    if (client_count < 1) client_count = 1;
+    if (client_count > LOADGEN_MAX_CLIENTS) client_count = LOADGEN_MAX_CLIENTS;
+    if (seconds < 1) seconds = 1;
+    if (seconds > LOADGEN_MAX_SECONDS) seconds = LOADGEN_MAX_SECONDS;
+    if (sscanf(mix, "%d,%d,%d,%d", &loadgen_weights[0], &loadgen_weights[1],
+               &loadgen_weights[2], &loadgen_weights[3]) != 4 || loadgen_weights[0] <= 0) {
+        fprintf(stderr, "--mix needs four weights reserve,pay,cancel,exit with reserve > 0\n");
+        return 1;
+    }
+    loadgen_think_ms = think_ms < 0 ? 0 : think_ms;
+    pool_mutex_init(&loadgen_engine_lock);
+
+    LoadClient *clients = (LoadClient *)calloc(client_count, sizeof(LoadClient));
+    pool_thread_t *threads = (pool_thread_t *)calloc(client_count, sizeof(pool_thread_t));
+    int *started = (int *)calloc(client_count, sizeof(int));
+    if (clients == NULL || threads == NULL || started == NULL) {
+        free(clients);
+        free(threads);
+        free(started);
+        return 1;
+    }
+
+    for (int i = 0; i < client_count; i++) {
+        clients[i].index = i;
+        clients[i].fd = -1;
+        clients[i].rng = 0x9E3779B97F4A7C15ULL * (unsigned long long)(i + 1) ^ (unsigned long long)time(NULL);
+#ifndef _WIN32
+        if (port > 0 && (clients[i].fd = router_connect(port)) < 0) {
+            fprintf(stderr, "client %d: cannot connect to port %d\n", i, port);
+        }
+#endif
+    }
+
+    loadgen_started_us = monotonic_us();
+    loadgen_deadline_us = loadgen_started_us + seconds * 1e6;
+    for (int i = 0; i < client_count; i++) {
+        if (port > 0 && clients[i].fd < 0) continue;
+#ifdef _WIN32
+        threads[i] = CreateThread(NULL, 0, loadgen_client_main, &clients[i], 0, NULL);
+        started[i] = threads[i] != NULL;
+#else
+        started[i] = pthread_create(&threads[i], NULL, loadgen_client_main, &clients[i]) == 0;
+#endif
+    }
+    int running = 0;
+    for (int i = 0; i < client_count; i++) {
+        if (!started[i]) continue;
+#ifdef _WIN32
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+#else
+        pthread_join(threads[i], NULL);
+#endif
+        if (clients[i].ready) running++;
+#ifndef _WIN32
+        if (clients[i].fd >= 0) close(clients[i].fd);
+#endif
+    }
+    double elapsed = (monotonic_us() - loadgen_started_us) / 1e6;
+
+    // Merge the per-client figures
+    LoadOpStats totals[LOAD_OP_COUNT];
+    int conflicts = 0, retries = 0, lot_full = 0, table_full = 0, completed = 0;
+    int *per_second = (int *)calloc(LOADGEN_MAX_SECONDS, sizeof(int));
+    memset(totals, 0, sizeof(totals));
+    for (int i = 0; i < client_count; i++) {
+        for (int op = 0; op < LOAD_OP_COUNT; op++) {
+            LoadOpStats *from = &clients[i].ops[op];
+            totals[op].count += from->count;
+            totals[op].errors += from->errors;
+            totals[op].total_us += from->total_us;
+            if (from->max_us > totals[op].max_us) totals[op].max_us = from->max_us;
+            for (int b = 0; b < LOADGEN_BUCKETS; b++) totals[op].buckets[b] += from->buckets[b];
+        }
+        conflicts += clients[i].conflicts;
+        retries += clients[i].retries;
+        lot_full += clients[i].lot_full;
+        table_full += clients[i].table_full;
+        for (int sec = 0; sec < seconds && per_second != NULL; sec++) per_second[sec] += clients[i].per_second[sec];
+    }
+
+    printf("Load generator: %d of %d clients against %s, %d s, think %d ms, mix %s\n",
+           running, client_count, port > 0 ? "daemon" : "in-process engine", seconds, loadgen_think_ms, mix);
+    printf("%-10s %9s %7s %10s %9s %8s %8s %8s %9s\n",
+           "operation", "count", "errors", "ops/s", "mean_us", "p50_us", "p90_us", "p99_us", "max_us");
+    for (int op = 0; op < LOAD_OP_COUNT; op++) {
+        LoadOpStats *t = &totals[op];
+        completed += t->count;
+        printf("%-10s %9d %7d %10.1f %9.1f %8.0f %8.0f %8.0f %9.0f\n", load_op_names[op], t->count, t->errors,
+               t->count / elapsed, t->count > 0 ? t->total_us / t->count : 0.0,
+               loadgen_percentile(t, 50), loadgen_percentile(t, 90), loadgen_percentile(t, 99), t->max_us);
+    }
+
+    // Sustained rate: median of the totals of each full second of the run
+    int measured = (int)elapsed;
+    if (measured < 1) measured = 1;
+    if (measured > seconds) measured = seconds;
+    if (per_second != NULL) {
+        qsort(per_second, measured, sizeof(int), loadgen_compare_int);
+        printf("throughput: %.1f ops/s overall, per second min %d / median %d / max %d\n",
+               completed / elapsed, per_second[0], per_second[measured / 2], per_second[measured - 1]);
+        free(per_second);
+    }
+    printf("conflicts: %d (%.1f/s), retries: %d (%.1f/s), lot full: %d\n",
+           conflicts, conflicts / elapsed, retries, retries / elapsed, lot_full);
+    if (table_full > 0) {
+        printf("%d clients stopped early: %s (raise MAX_RESERVATIONS / MAX_PAYMENTS)\n",
+               table_full, engine_error_text(ENGINE_ERR_FULL));
+    }
+
+    printf("latency histograms (upper bucket edge in us):\n");
+    for (int op = 0; op < LOAD_OP_COUNT; op++) {
+        unsigned int peak = 0;
+        for (int b = 0; b < LOADGEN_BUCKETS; b++) {
+            if (totals[op].buckets[b] > peak) peak = totals[op].buckets[b];
+        }
+        for (int b = 0; b < LOADGEN_BUCKETS; b++) {
+            if (totals[op].buckets[b] == 0) continue;
+            int bar = (int)(40.0 * totals[op].buckets[b] / peak + 0.5);
+            printf("  %-10s <= %9llu %8u %.*s\n", load_op_names[op], 2ULL << b, totals[op].buckets[b],
+                   bar > 0 ? bar : 1, "########################################");
+        }
+    }
+    fflush(stdout);
+
+    free(clients);
+    free(threads);
+    free(started);
+    return running > 0 ? 0 : 1;
+}
+
+// Latency Instrumentation
+// Every engine operation and persistence phase adds its duration to a
+// log-linear histogram: two clock reads and a few integer operations. The
+// admin menu shows the summary; latency_dump writes it, with the non-empty
+// buckets, to LATENCY_FILE on demand or every --latency-every seconds.
+static const char *metric_names[METRIC_COUNT] = {
+    "register_user", "login", "add_vehicle", "reserve", "cancel", "pay", "anpr_batch", "report",
+    "load_data", "save_data", "journal_replay", "journal_write", "journal_fsync",
+    "replication_ship", "record_store_put"};
+static long long latency_last_dump_ms = 0;
+
+static int latency_bucket(double us) {
+    unsigned long long value = us > 0 ? (unsigned long long)us : 0;
+    if (value < 2 * LATENCY_SUB_BUCKETS) return (int)value;
+    int magnitude = 0;
+    while ((value >> magnitude) >= 2 * LATENCY_SUB_BUCKETS) magnitude++;
+    int bucket = 2 * LATENCY_SUB_BUCKETS + (magnitude - 1) * LATENCY_SUB_BUCKETS +
+                 (int)(value >> magnitude) - LATENCY_SUB_BUCKETS;
+    return bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1;
+}
+
+// Smallest value that lands in the bucket
+static double latency_bucket_floor(int bucket) {
+    if (bucket < 2 * LATENCY_SUB_BUCKETS) return bucket;
+    int magnitude = (bucket - 2 * LATENCY_SUB_BUCKETS) / LATENCY_SUB_BUCKETS + 1;
+    int sub = (bucket - 2 * LATENCY_SUB_BUCKETS) % LATENCY_SUB_BUCKETS + LATENCY_SUB_BUCKETS;
+    return (double)((unsigned long long)sub << magnitude);
+}
+
+void latency_record(MetricId metric, double started_us, int failed) {
+    double us = monotonic_us() - started_us;
+    LatencyHistogram *histogram = &latency_stats[metric];
+    histogram->buckets[latency_bucket(us)]++;
+    histogram->count++;
+    histogram->total_us += us;
+    if (us > histogram->max_us) histogram->max_us = us;
+    if (failed) histogram->errors++;
+}
+
+// Upper edge of the bucket holding the p-th percentile, capped at the maximum
+double latency_percentile(const LatencyHistogram *histogram, double p) {
+    unsigned long long rank = (unsigned long long)(p / 100.0 * histogram->count + 0.999999), seen = 0;
+    if (histogram->count == 0) return 0;
+    if (rank < 1) rank = 1;
+    for (int b = 0; b < LATENCY_BUCKETS; b++) {
+        seen += histogram->buckets[b];
+        if (seen >= rank) {
+            double edge = b + 1 < LATENCY_BUCKETS ? latency_bucket_floor(b + 1) : histogram->max_us;
+            return edge < histogram->max_us ? edge : histogram->max_us;
+        }
+    }
+    return histogram->max_us;
+}
+
+// Returns 1 when the file was written
+int latency_dump(const char *path) {
+    FILE *file = fopen(path, "w");
+    char now[20];
+    if (file == NULL) return 0;
+
+    get_current_time(now);
+    fprintf(file, "# latency statistics at %s, times in microseconds\n", now);
+    fprintf(file, "# name count errors mean p50 p90 p99 p999 max\n");
+    for (int m = 0; m < METRIC_COUNT; m++) {
+        LatencyHistogram *h = &latency_stats[m];
+        fprintf(file, "%s %llu %llu %.1f %.0f %.0f %.0f %.0f %.0f\n", metric_names[m], h->count, h->errors,
+                h->count > 0 ? h->total_us / h->count : 0.0, latency_percentile(h, 50),
+                latency_percentile(h, 90), latency_percentile(h, 99), latency_percentile(h, 99.9), h->max_us);
+    }
+    // Raw buckets as "<floor_us>:<count>", enough to merge dumps or recompute percentiles
+    for (int m = 0; m < METRIC_COUNT; m++) {
+        if (latency_stats[m].count == 0) continue;
+        fprintf(file, "buckets %s", metric_names[m]);
+        for (int b = 0; b < LATENCY_BUCKETS; b++) {
+            if (latency_stats[m].buckets[b] > 0) {
+                fprintf(file, " %.0f:%u", latency_bucket_floor(b), latency_stats[m].buckets[b]);
+            }
+        }
+        fprintf(file, "\n");
+    }
+    fclose(file);
+    return 1;
+}
+
+void latency_dump_at_exit() {
+    latency_dump(LATENCY_FILE);
+}
+
+// Called from the server loops; dumps once per latency_dump_seconds
+void latency_tick() {
+    if (latency_dump_seconds <= 0) return;
+    long long now = monotonic_ms();
+    if (latency_last_dump_ms == 0) latency_last_dump_ms = now;
+    if (now - latency_last_dump_ms < latency_dump_seconds * 1000LL) return;
+    latency_last_dump_ms = now;
+    latency_dump(LATENCY_FILE);
+}
+
+void admin_latency_report() {
+    char line[160];
+
+    clear_screen();
+    print_header();
+    term_printf("\n");
+    printCentered("OPERATION LATENCY STATISTICS", LIGHTCYAN);
+    printCentered("Since system start, times in microseconds", YELLOW);
+    term_printf("\n");
+
+    sprintf(line, "%-17s %8s %6s %9s %8s %8s %8s %9s", "Operation", "Count", "Errors",
+            "Mean", "p50", "p90", "p99", "Max");
+    printCentered(line, LIGHTBLUE);
+    printCenteredLine('-', LIGHTBLUE);
+    for (int m = 0; m < METRIC_COUNT; m++) {
+        LatencyHistogram *h = &latency_stats[m];
+        if (m == METRIC_LOAD_DATA) printCenteredLine('-', DARKGRAY); // persistence phases below
+        sprintf(line, "%-17s %8llu %6llu %9.1f %8.0f %8.0f %8.0f %9.0f", metric_names[m], h->count, h->errors,
+                h->count > 0 ? h->total_us / h->count : 0.0, latency_percentile(h, 50),
+                latency_percentile(h, 90), latency_percentile(h, 99), h->max_us);
+        printCentered(line, h->count > 0 ? WHITE : DARKGRAY);
+    }
+
+    term_printf("\n");
+    printCentered("Press D to write " LATENCY_FILE ", any other key to return", YELLOW);
+    int key = term_getch();
+    if (key == 'd' || key == 'D') {
+        if (latency_dump(LATENCY_FILE)) {
+            printCentered("Latency statistics written to " LATENCY_FILE, LIGHTGREEN);
+        } else {
+            printCentered("Error: Could not write " LATENCY_FILE, LIGHTRED);
+        }
+        pause_screen();
+    }
+}
+
+// Metrics Export
+// --metrics-every <s> writes METRICS_FILE in the Prometheus text exposition
+// format, for the node_exporter textfile collector. Slot gauges come from the
+// per-type counters kept by set_slot_state; rates come from the operation
+// counters of the latency histograms, so writing the file never scans a table.
+// The file is written under a temporary name and renamed, so a scrape never
+// sees half of it.
+static long long metrics_last_write_ms = 0;
+
+static void metrics_labels(char *labels, int size, const char *extra) {
+    if (lot_id > 0) {
+        snprintf(labels, size, "{lot=\"%d\"%s%s}", lot_id, extra[0] ? "," : "", extra);
+    } else if (extra[0]) {
+        snprintf(labels, size, "{%s}", extra);
+    } else {
+        labels[0] = '\0';
+    }
+}
+
+static void metrics_sample(FILE *file, const char *name, const char *extra, double value) {
+    char labels[160];
+    metrics_labels(labels, sizeof(labels), extra);
+    fprintf(file, "%s%s %.15g\n", name, labels, value);
+}
+
+static void metrics_help(FILE *file, const char *name, const char *type, const char *help) {
+    fprintf(file, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+// Returns 1 when the file was written
+int metrics_write(const char *path) {
+    static const char *types[3] = {"bike", "car", "truck"};
+    static const char *states[3] = {"available", "reserved", "occupied"};
+    static const double quantiles[3] = {50, 90, 99};
+    char temp_path[256], extra[128];
+    long long now = monotonic_ms();
+
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", path);
+    FILE *file = fopen(temp_path, "w");
+    if (file == NULL) return 0;
+
+    metrics_help(file, "smart_park_slots", "gauge", "Parking slots by vehicle type and state.");
+    for (int t = 0; t < 3; t++) {
+        for (int st = 0; st < 3; st++) {
+            snprintf(extra, sizeof(extra), "type=\"%s\",state=\"%s\"", types[t], states[st]);
+            metrics_sample(file, "smart_park_slots", extra, slot_type_counts[t][st]);
+        }
+    }
+
+    metrics_help(file, "smart_park_overstays", "gauge", "Active reservations past their booked time.");
+    metrics_sample(file, "smart_park_overstays", "", overstay_count);
+    metrics_help(file, "smart_park_overstay_alerts_total", "counter", "Reservations that ran over since start.");
+    metrics_sample(file, "smart_park_overstay_alerts_total", "", overstay_alerts_total);
+    metrics_help(file, "smart_park_hold_expiries_total", "counter", "Unpaid reservations released by this process.");
+    metrics_sample(file, "smart_park_hold_expiries_total", "", hold_expiries_total);
+
+    const LatencyHistogram *reserve = &latency_stats[METRIC_RESERVE];
+    const LatencyHistogram *pay = &latency_stats[METRIC_PAY];
+    const LatencyHistogram *cancel = &latency_stats[METRIC_CANCEL];
+    metrics_help(file, "smart_park_bookings_total", "counter", "Reservations made by this process.");
+    metrics_sample(file, "smart_park_bookings_total", "", (double)(reserve->count - reserve->errors));
+    metrics_help(file, "smart_park_cancellations_total", "counter", "Reservations cancelled by this process.");
+    metrics_sample(file, "smart_park_cancellations_total", "", (double)(cancel->count - cancel->errors));
+    metrics_help(file, "smart_park_payments_total", "counter", "Payments taken by this process.");
+    metrics_sample(file, "smart_park_payments_total", "", (double)(pay->count - pay->errors));
+    metrics_help(file, "smart_park_payment_amount_total", "counter", "Amount of the payments taken by this process.");
+    metrics_sample(file, "smart_park_payment_amount_total", "", payment_amount_total);
+
+    metrics_help(file, "smart_park_operations_total", "counter", "Engine operations and persistence phases run.");
+    for (int m = 0; m < METRIC_COUNT; m++) {
+        snprintf(extra, sizeof(extra), "op=\"%s\"", metric_names[m]);
+        metrics_sample(file, "smart_park_operations_total", extra, (double)latency_stats[m].count);
+    }
+    metrics_help(file, "smart_park_operation_errors_total", "counter", "Operations that were refused or failed.");
+    for (int m = 0; m < METRIC_COUNT; m++) {
+        snprintf(extra, sizeof(extra), "op=\"%s\"", metric_names[m]);
+        metrics_sample(file, "smart_park_operation_errors_total", extra, (double)latency_stats[m].errors);
+    }
+    metrics_help(file, "smart_park_operation_latency_seconds", "summary", "Operation latency since start.");
+    for (int m = 0; m < METRIC_COUNT; m++) {
+        const LatencyHistogram *h = &latency_stats[m];
+        if (h->count == 0) continue;
+        for (int q = 0; q < 3; q++) {
+            snprintf(extra, sizeof(extra), "op=\"%s\",quantile=\"%.2f\"", metric_names[m], quantiles[q] / 100);
+            metrics_sample(file, "smart_park_operation_latency_seconds", extra, latency_percentile(h, quantiles[q]) / 1e6);
+        }
+        snprintf(extra, sizeof(extra), "op=\"%s\"", metric_names[m]);
+        metrics_sample(file, "smart_park_operation_latency_seconds_sum", extra, h->total_us / 1e6);
+        metrics_sample(file, "smart_park_operation_latency_seconds_count", extra, (double)h->count);
+    }
+
+    MemoryArea areas[MEMORY_MAX_AREAS];
+    int area_count = memory_collect(areas);
+    metrics_help(file, "smart_park_memory_allocated_bytes", "gauge", "Memory reserved per table, index and buffer.");
+    for (int a = 0; a < area_count; a++) {
+        snprintf(extra, sizeof(extra), "area=\"%s\"", areas[a].name);
+        metrics_sample(file, "smart_park_memory_allocated_bytes", extra, (double)areas[a].allocated);
+    }
+    metrics_help(file, "smart_park_memory_used_bytes", "gauge", "Memory held by live rows per table, index and buffer.");
+    for (int a = 0; a < area_count; a++) {
+        snprintf(extra, sizeof(extra), "area=\"%s\"", areas[a].name);
+        metrics_sample(file, "smart_park_memory_used_bytes", extra, (double)areas[a].used);
+    }
+    long resident_kb = memory_resident_kb();
+    if (resident_kb >= 0) {
+        metrics_help(file, "smart_park_resident_memory_bytes", "gauge", "Resident set size of the process.");
+        metrics_sample(file, "smart_park_resident_memory_bytes", "", resident_kb * 1024.0);
+    }
+
+    // Persistence lag: what a crash now would have to replay or would lose
+    metrics_help(file, "smart_park_journal_pending_records", "gauge", "Journal records not yet committed.");
+    metrics_sample(file, "smart_park_journal_pending_records", "", journal_pending_records);
+    metrics_help(file, "smart_park_journal_records_since_snapshot", "gauge", "Committed records replayed after a restart.");
+    metrics_sample(file, "smart_park_journal_records_since_snapshot", "", journal_records_since_checkpoint);
+    metrics_help(file, "smart_park_journal_sequence", "counter", "Sequence number of the last journal commit.");
+    metrics_sample(file, "smart_park_journal_sequence", "", replica_mode ? upstream_seq : journal_seq);
+    metrics_help(file, "smart_park_journal_commit_age_seconds", "gauge", "Time since the last journal commit.");
+    metrics_sample(file, "smart_park_journal_commit_age_seconds", "",
+                   journal_commit_ms > 0 ? (now - journal_commit_ms) / 1000.0 : -1);
+    metrics_help(file, "smart_park_snapshot_age_seconds", "gauge", "Time since the snapshot files were loaded or saved.");
+    metrics_sample(file, "smart_park_snapshot_age_seconds", "",
+                   snapshot_saved_ms > 0 ? (now - snapshot_saved_ms) / 1000.0 : -1);
+    if (replica_mode) {
+        metrics_help(file, "smart_park_replica_lag_seconds", "gauge", "Time since the primary was last heard from.");
+        metrics_sample(file, "smart_park_replica_lag_seconds", "",
+                       upstream_heard_ms > 0 ? (now - upstream_heard_ms) / 1000.0 : -1);
+    } else {
+        metrics_help(file, "smart_park_replicas_connected", "gauge", "Replicas receiving the journal.");
+        metrics_sample(file, "smart_park_replicas_connected", "", replica_link_count);
+    }
+
+    int ok = fclose(file) == 0;
+#ifdef _WIN32
+    remove(path); // rename does not replace on Windows
+#endif
+    return ok && rename(temp_path, path) == 0;
+}
+
+void metrics_write_at_exit() {
+    metrics_write(METRICS_FILE);
+}
+
+// Called from the server loops; writes once per metrics_every_seconds
+void metrics_tick() {
+    if (metrics_every_seconds <= 0) return;
+    long long now = monotonic_ms();
+    if (metrics_last_write_ms != 0 && now - metrics_last_write_ms < metrics_every_seconds * 1000LL) return;
+    metrics_last_write_ms = now;
+    metrics_write(METRICS_FILE);
+}
+
+// Startup Profiler
+// load_data and main record each startup step as it runs: the table files
+// (bytes read, rows parsed), the journal replay, index builds, shared-memory
+// and record-store setup, and the wait for a key at the end of loading.
+// --profile-startup runs the normal startup headless and prints the steps
+// as JSON, so cold-start time can be tracked as the data grows.
+void startup_phase_record(const char *name, long bytes, int rows, double started_us) {
+    if (startup_phase_count >= STARTUP_MAX_PHASES) return;
+    StartupPhase *phase = &startup_phases[startup_phase_count++];
+    phase->name = name;
+    phase->bytes = bytes > 0 ? bytes : 0;
+    phase->rows = rows;
+    phase->us = monotonic_us() - started_us;
+}
+
+void startup_report(FILE *out, double total_us) {
+    fprintf(out, "{\n");
+    fprintf(out, "  \"lot\": %d,\n", lot_id);
+    fprintf(out, "  \"total_us\": %.1f,\n", total_us);
+    fprintf(out, "  \"phases\": [\n");
+    for (int i = 0; i < startup_phase_count; i++) {
+        StartupPhase *phase = &startup_phases[i];
+        fprintf(out, "    {\"name\": \"%s\", \"bytes\": %ld, \"rows\": %d, \"us\": %.1f, \"mb_per_s\": %.1f}%s\n",
+                phase->name, phase->bytes, phase->rows, phase->us,
+                phase->us > 0 ? phase->bytes / phase->us : 0.0, i + 1 < startup_phase_count ? "," : "");
+    }
+    fprintf(out, "  ],\n");
+    fprintf(out, "  \"tables\": {\"users\": %d, \"vehicles\": %d, \"slots\": %d, \"reservations\": %d, \"payments\": %d},\n",
+            user_count, vehicle_count, slot_count, reservation_count, payment_count);
+    fprintf(out, "  \"peak_rss_kb\": %ld\n", bench_peak_rss_kb());
+    fprintf(out, "}\n");
+    fflush(out);
+}
+
+// Memory Accounting
+// The tables are fixed arrays sized by the MAX_* limits, so most of the
+// process is reserved up front whatever the lot holds. memory_collect
+// reports reserved and used bytes per table, index and buffer from counters
+// only; the admin screen also adds up the text actually stored in the rows
+// to show how much of each fixed-width row is padding.
+static void memory_area(MemoryArea *area, const char *name, size_t allocated, size_t row_bytes, long rows,
+                        size_t used) {
+    area->name = name;
+    area->allocated = allocated;
+    area->row_bytes = row_bytes;
+    area->rows = rows;
+    area->used = used;
+}
+
+// Fills areas (at least MEMORY_MAX_AREAS); returns how many
+int memory_collect(MemoryArea *areas) {
+    int n = 0;
+    memory_area(&areas[n++], "users", sizeof(users), sizeof(User), user_count, user_count * sizeof(User));
+    memory_area(&areas[n++], "vehicles", sizeof(vehicles), sizeof(Vehicle), vehicle_count,
+                vehicle_count * sizeof(Vehicle));
+    memory_area(&areas[n++], "reservations", sizeof(reservations), sizeof(Reservation), reservation_count,
+                reservation_count * sizeof(Reservation));
+    memory_area(&areas[n++], "payments", sizeof(payments), sizeof(Payment), payment_count,
+                payment_count * sizeof(Payment));
+    memory_area(&areas[n++], "slots", sizeof(local_slots), sizeof(Slot), slot_count, slot_count * sizeof(Slot));
+    if (shared_slots != NULL) {
+        memory_area(&areas[n++], "shared_slot_table", sizeof(SharedSlotTable), 0, slot_count, sizeof(SharedSlotTable));
+    }
+    memory_area(&areas[n++], "plate_index", sizeof(plate_index), sizeof(int), plate_index_count,
+                plate_index_count * sizeof(int));
+    memory_area(&areas[n++], "zone_heaps", sizeof(zone_heaps) + sizeof(slot_zone) + sizeof(slot_distance) +
+                sizeof(slot_queued), sizeof(int), geometry_ready ? slot_count : 0,
+                geometry_ready ? slot_count * (3 * sizeof(int) + 1) : 0);
+    memory_area(&areas[n++], "slot_event_ring", sizeof(local_slot_events), sizeof(int), SLOT_EVENT_RING,
+                sizeof(local_slot_events));
+    memory_area(&areas[n++], "journal_buffer", journal_capacity, 0, journal_pending_records, journal_length);
+    if (replica_mode) {
+        memory_area(&areas[n++], "replica_batch", upstream_batch_capacity, 0, 0, upstream_batch_length);
+    }
+    memory_area(&areas[n++], "screen_buffers", sizeof(term_frame) + sizeof(term_shown), sizeof(TermCell),
+                TERM_MAX_ROWS * CONSOLE_WIDTH * 2, term_is_plain() ? 0 : sizeof(term_frame) + sizeof(term_shown));
+    memory_area(&areas[n++], "latency_histograms", sizeof(latency_stats), sizeof(LatencyHistogram), METRIC_COUNT,
+                sizeof(latency_stats));
+    if (task_pool != NULL) {
+        memory_area(&areas[n++], "task_pool", sizeof(TaskPool), 0, task_pool->worker_count, sizeof(TaskPool));
+    }
+    return n;
+}
+
+// Current resident set size in KB, -1 where it cannot be read
+long memory_resident_kb() {
+#ifdef __linux__
+    long pages_total = 0, pages_resident = -1;
+    FILE *file = fopen("/proc/self/statm", "r");
+    if (file == NULL) return -1;
+    if (fscanf(file, "%ld %ld", &pages_total, &pages_resident) != 2) pages_resident = -1;
+    fclose(file);
+    return pages_resident < 0 ? -1 : pages_resident * (sysconf(_SC_PAGESIZE) / 1024);
+#else
+    return -1;
+#endif
+}
+
+// Bytes of real content in the used rows: text plus terminator, and numbers
+static size_t memory_table_payload(const char *table) {
+    size_t bytes = 0;
+    if (strcmp(table, "users") == 0) {
+        for (int i = 0; i < user_count; i++) {
+            bytes += strlen(users[i].name) + strlen(users[i].phone) + strlen(users[i].email) +
+                     strlen(users[i].password) + 4 + 2 * sizeof(int) + sizeof(long long);
+        }
+    } else if (strcmp(table, "vehicles") == 0) {
+        for (int i = 0; i < vehicle_count; i++) {
+            bytes += strlen(vehicles[i].type) + strlen(vehicles[i].license_plate) + strlen(vehicles[i].color) +
+                     3 + 2 * sizeof(int) + sizeof(long long);
+        }
+    } else if (strcmp(table, "reservations") == 0) {
+        for (int i = 0; i < reservation_count; i++) {
+            bytes += strlen(reservations[i].status) + 1 + 4 * sizeof(int) + 2 * sizeof(long long) +
+                     2 * sizeof(double);
+        }
+    } else if (strcmp(table, "payments") == 0) {
+        for (int i = 0; i < payment_count; i++) {
+            bytes += strlen(payments[i].method) + strlen(payments[i].status) +
+                     2 + 3 * sizeof(int) + sizeof(long long) + sizeof(double);
+        }
+    } else if (strcmp(table, "slots") == 0) {
+        for (int i = 0; i < slot_count; i++) {
+            bytes += strlen(slots[i].type) + strlen(slots[i].status) +
+                     2 + 3 * sizeof(int) + sizeof(long long);
+        }
+    } else {
+        return 0;
+    }
+    return bytes;
+}
+
+void admin_memory_report() {
+    MemoryArea areas[MEMORY_MAX_AREAS];
+    int count = memory_collect(areas);
+    size_t total_allocated = 0, total_used = 0;
+    char line[160];
+
+    clear_screen();
+    print_header();
+    term_printf("\n");
+    printCentered("MEMORY USAGE", LIGHTBLUE);
+    printCentered("Reserved and used memory per table, index and buffer (KB)", YELLOW);
+    term_printf("\n");
+
+    sprintf(line, "%-19s %10s %10s %6s %9s %8s %8s", "Area", "Reserved", "Used", "Used%",
+            "Rows", "Row B", "Padding");
+    printCentered(line, LIGHTBLUE);
+    printCenteredLine('-', LIGHTBLUE);
+    for (int a = 0; a < count; a++) {
+        MemoryArea *area = &areas[a];
+        size_t payload = memory_table_payload(area->name);
+        char padding[16] = "-";
+        if (payload > 0 && area->used > 0) {
+            sprintf(padding, "%.0f%%", 100.0 * (1.0 - (double)payload / area->used));
+        }
+        total_allocated += area->allocated;
+        total_used += area->used;
+        sprintf(line, "%-19s %10.1f %10.1f %5.1f%% %9ld %8lu %8s", area->name, area->allocated / 1024.0,
+                area->used / 1024.0, area->allocated > 0 ? 100.0 * area->used / area->allocated : 0.0,
+                area->rows, (unsigned long)area->row_bytes, padding);
+        printCentered(line, area->used > 0 ? WHITE : DARKGRAY);
+    }
+    printCenteredLine('-', LIGHTBLUE);
+    sprintf(line, "%-19s %10.1f %10.1f %5.1f%% %9s %8s %8s", "Total", total_allocated / 1024.0,
+            total_used / 1024.0, total_allocated > 0 ? 100.0 * total_used / total_allocated : 0.0, "", "", "");
+    printCentered(line, LIGHTGREEN);
+
+    term_printf("\n");
+    long resident_kb = memory_resident_kb();
+    long peak_kb = bench_peak_rss_kb();
+    if (peak_kb < resident_kb) peak_kb = resident_kb;  // the two are sampled differently
+    if (resident_kb >= 0) {
+        sprintf(line, "Process resident: %ld KB | peak: %ld KB", resident_kb, peak_kb);
+        printCentered(line, LIGHTCYAN);
+    }
+    printCentered("Padding is the part of the used rows not holding text or numbers.", DARKGRAY);
+    printCentered("Reserved table memory is only resident once rows are written to it.", DARKGRAY);
+    pause_screen();
+}
+
+// Workload Capture and Replay
+// --capture appends every engine call to a binary trace: register, login,
+// add vehicle, reserve, cancel, pay and ANPR batches, with their arguments,
+// start time, latency and result. --replay runs a trace against the data
+// in the working directory and compares each result, the latencies and the
+// final state with what was recorded. Traces are compact: a record is an op
+// byte, then varints (zigzag for signed values), length-prefixed text and
+// raw doubles. The trace starts with a digest of the state it was taken
+// from and ends with a digest of the final state.
+static const char *trace_op_names[TRACE_OP_COUNT] = {
+    "", "register", "login", "add_vehicle", "reserve", "cancel", "pay", "anpr_batch", "end", "hold_expiry"};
+// Argument layout per op: i = int, s = text, d = double
+static const char *trace_signatures[TRACE_OP_COUNT] = {"", "ssss", "ss", "isss", "iiid", "ii", "iis", "", "", "i"};
+
+typedef struct {
+    unsigned char data[TRACE_RECORD_MAX];
+    int length;
+} TraceBuffer;
+
+static void trace_put_varint(TraceBuffer *buffer, unsigned long long value) {
+    while (value >= 0x80 && buffer->length < TRACE_RECORD_MAX) {
+        buffer->data[buffer->length++] = (unsigned char)(value | 0x80);
+        value >>= 7;
+    }
+    if (buffer->length < TRACE_RECORD_MAX) buffer->data[buffer->length++] = (unsigned char)value;
+}
+
+static void trace_put_int(TraceBuffer *buffer, long long value) {
+    trace_put_varint(buffer, ((unsigned long long)value << 1) ^ (unsigned long long)(value >> 63));
+}
+
+static void trace_put_text(TraceBuffer *buffer, const char *text) {
+    int len = (int)strlen(text);
+    if (len > MAX_STRING - 1) len = MAX_STRING - 1;
+    if (buffer->length + 1 + len > TRACE_RECORD_MAX) return;
+    buffer->data[buffer->length++] = (unsigned char)len;
+    memcpy(buffer->data + buffer->length, text, len);
+    buffer->length += len;
+}
+
+static void trace_put_double(TraceBuffer *buffer, double value) {
+    if (buffer->length + (int)sizeof(double) > TRACE_RECORD_MAX) return;
+    memcpy(buffer->data + buffer->length, &value, sizeof(double));
+    buffer->length += sizeof(double);
+}
+
+static void trace_begin(TraceBuffer *buffer, TraceOp op, double started_us, int result) {
+    buffer->length = 0;
+    buffer->data[buffer->length++] = (unsigned char)op;
+    double offset = started_us - capture_started_us;
+    trace_put_varint(buffer, offset > 0 ? (unsigned long long)offset : 0);
+    double latency = monotonic_us() - started_us;
+    trace_put_varint(buffer, latency > 0 ? (unsigned long long)latency : 0);
+    trace_put_int(buffer, result);
+}
+
+static void trace_write(TraceBuffer *buffer) {
+    fwrite(buffer->data, 1, buffer->length, capture_file);
+    if (++capture_records % CAPTURE_FLUSH_RECORDS == 0) fflush(capture_file);
+}
+
+// FNV-1a over the rows, leaving out timestamps so a replay run at another
+// time matches as long as it made the same changes
+static unsigned long long digest_bytes(unsigned long long hash, const void *data, size_t length) {
+    const unsigned char *bytes = (const unsigned char *)data;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static unsigned long long digest_int(unsigned long long hash, long long value) {
+    return digest_bytes(hash, &value, sizeof(value));
+}
+
+static unsigned long long digest_text(unsigned long long hash, const char *text) {
+    return digest_bytes(hash, text, strlen(text) + 1);
+}
+
+unsigned long long state_digest() {
+    unsigned long long hash = 14695981039346656037ULL;
+    for (int i = 0; i < user_count; i++) {
+        hash = digest_int(hash, users[i].user_id);
+        hash = digest_text(hash, users[i].name);
+        hash = digest_text(hash, users[i].phone);
+        hash = digest_text(hash, users[i].email);
+        hash = digest_int(hash, users[i].is_active);
+    }
+    for (int i = 0; i < vehicle_count; i++) {
+        hash = digest_int(hash, vehicles[i].vehicle_id);
+        hash = digest_int(hash, vehicles[i].user_id);
+        hash = digest_text(hash, vehicles[i].type);
+        hash = digest_text(hash, vehicles[i].license_plate);
+    }
+    for (int i = 0; i < reservation_count; i++) {
+        Reservation *r = &reservations[i];
+        hash = digest_int(hash, r->reservation_id);
+        hash = digest_int(hash, r->user_id);
+        hash = digest_int(hash, r->slot_id);
+        hash = digest_int(hash, r->vehicle_id);
+        hash = digest_text(hash, r->status);
+        hash = digest_int(hash, (long long)(r->total_amount * 100 + 0.5));
+    }
+    for (int i = 0; i < payment_count; i++) {
+        hash = digest_int(hash, payments[i].payment_id);
+        hash = digest_int(hash, payments[i].reservation_id);
+        hash = digest_int(hash, (long long)(payments[i].amount * 100 + 0.5));
+        hash = digest_text(hash, payments[i].method);
+        hash = digest_text(hash, payments[i].status);
+    }
+    for (int i = 0; i < slot_count; i++) {
+        hash = digest_int(hash, slots[i].slot_id);
+        hash = digest_text(hash, slots[i].status);
+        hash = digest_int(hash, slots[i].vehicle_id);
+        hash = digest_int(hash, slots[i].user_id);
+    }
+    return hash;
+}
+
+// Returns 0, or 1 when the trace cannot be created
+int capture_open(const char *path) {
+    capture_file = fopen(path, "wb");
+    if (capture_file == NULL) return 1;
+    unsigned long long digest = state_digest();
+    fwrite(TRACE_MAGIC, 1, 8, capture_file);
+    fwrite(&digest, sizeof(digest), 1, capture_file);
+    capture_started_us = monotonic_us();
+    capture_records = 0;
+    return 0;
+}
+
+// Arguments follow the signature: i = int, s = text, d = double
+void capture_call(TraceOp op, double started_us, int result, const char *signature, ...) {
+    TraceBuffer buffer;
+    va_list args;
+    trace_begin(&buffer, op, started_us, result);
+    va_start(args, signature);
+    for (const char *kind = signature; *kind; kind++) {
+        if (*kind == 'i') trace_put_int(&buffer, va_arg(args, int));
+        else if (*kind == 's') trace_put_text(&buffer, va_arg(args, const char *));
+        else trace_put_double(&buffer, va_arg(args, double));
+    }
+    va_end(args);
+    trace_write(&buffer);
+}
+
+void capture_plates(const PlateEvent *events, int count, double started_us, int applied) {
+    TraceBuffer buffer;
+    trace_begin(&buffer, TRACE_PLATES, started_us, applied);
+    trace_put_varint(&buffer, count);
+    for (int e = 0; e < count; e++) {
+        trace_put_text(&buffer, events[e].plate);
+        trace_put_varint(&buffer, events[e].is_exit);
+        trace_put_varint(&buffer, (unsigned long long)events[e].event_time);
+    }
+    trace_write(&buffer);
+}
+
+// Runs at exit: the final digest lets a replay check it ended in the same state
+void capture_close() {
+    if (capture_file == NULL) return;
+    TraceBuffer buffer;
+    trace_begin(&buffer, TRACE_END, monotonic_us(), 0);
+    unsigned long long digest = state_digest();
+    memcpy(buffer.data + buffer.length, &digest, sizeof(digest));
+    buffer.length += sizeof(digest);
+    trace_write(&buffer);
+    fclose(capture_file);
+    capture_file = NULL;
+}
+
+static int trace_get_varint(FILE *file, unsigned long long *value) {
+    int shift = 0, c;
+    *value = 0;
+    while ((c = fgetc(file)) != EOF && shift < 64) {
+        *value |= (unsigned long long)(c & 0x7f) << shift;
+        if (!(c & 0x80)) return 1;
+        shift += 7;
+    }
+    return 0;
+}
+
+static int trace_get_int(FILE *file, int *value) {
+    unsigned long long raw;
+    if (!trace_get_varint(file, &raw)) return 0;
+    *value = (int)((long long)(raw >> 1) ^ -(long long)(raw & 1));
+    return 1;
+}
+
+static int trace_get_text(FILE *file, char *text) {
+    int len = fgetc(file);
+    if (len == EOF || len > MAX_STRING - 1 || fread(text, 1, len, file) != (size_t)len) return 0;
+    text[len] = '\0';
+    return 1;
+}
+
+// Returns 1 for a record, 0 at the end of the trace or on a damaged record
+static int trace_read(FILE *file, TraceRecord *record) {
+    unsigned long long offset, latency, count, flag, when;
+    record->op = fgetc(file);
+    if (record->op == EOF || record->op <= 0 || record->op >= TRACE_OP_COUNT) return 0;
+    if (!trace_get_varint(file, &offset) || !trace_get_varint(file, &latency) ||
+        !trace_get_int(file, &record->result)) {
+        return 0;
+    }
+    record->offset_us = (double)offset;
+    record->latency_us = (double)latency;
+
+    if (record->op == TRACE_END) {
+        return fread(&record->digest, sizeof(record->digest), 1, file) == 1;
+    }
+    if (record->op == TRACE_PLATES) {
+        if (!trace_get_varint(file, &count) || count > ANPR_BATCH_MAX) return 0;
+        record->event_count = (int)count;
+        for (int e = 0; e < record->event_count; e++) {
+            PlateEvent *event = &record->events[e];
+            if (!trace_get_text(file, event->plate) || !trace_get_varint(file, &flag) ||
+                !trace_get_varint(file, &when)) {
+                return 0;
+            }
+            event->event_time = (long long)when;
+            event->is_exit = (int)flag;
+        }
+        return 1;
+    }
+
+    int ints = 0, texts = 0;
+    for (const char *kind = trace_signatures[record->op]; *kind; kind++) {
+        if (*kind == 'i') {
+            if (!trace_get_int(file, &record->ints[ints++])) return 0;
+        } else if (*kind == 's') {
+            if (!trace_get_text(file, record->text[texts++])) return 0;
+        } else if (fread(&record->number, sizeof(double), 1, file) != 1) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Same call the capture saw; returns the engine's result
+static int replay_apply(const TraceRecord *r) {
+    IngestStats stats;
+    switch (r->op) {
+        case TRACE_REGISTER: return engine_register_user(r->text[0], r->text[1], r->text[2], r->text[3]);
+        case TRACE_LOGIN: return engine_login(r->text[0], r->text[1]);
+        case TRACE_ADD_VEHICLE: return engine_add_vehicle(r->ints[0], r->text[0], r->text[1], r->text[2]);
+        case TRACE_RESERVE: return engine_reserve(r->ints[0], r->ints[1], r->ints[2], r->number);
+        case TRACE_CANCEL: return engine_cancel(r->ints[0], r->ints[1]);
+        case TRACE_PAY: return engine_pay(r->ints[0], r->ints[1], r->text[0]);
+        case TRACE_PLATES: return ingest_plate_events(r->events, r->event_count, &stats);
+        case TRACE_EXPIRE: return engine_expire_hold(r->ints[0]);
+    }
+    return 0;
+}
+
+static int replay_enter_directory() {
+#ifdef _WIN32
+    _mkdir(REPLAY_DIR);
+    return _chdir(REPLAY_DIR);
+#else
+    mkdir(REPLAY_DIR, 0755);
+    return chdir(REPLAY_DIR);
+#endif
+}
+
+// Returns 0 when the replay ended in the recorded state, 3 when it did not,
+// 1 when the trace cannot be read
+int run_replay(const char *path, int paced, FILE *out) {
+    FILE *file = fopen(path, "rb");
+    char magic[8];
+    unsigned long long start_digest;
+    if (file == NULL || fread(magic, 1, 8, file) != 8 || memcmp(magic, TRACE_MAGIC, 8) != 0 ||
+        fread(&start_digest, sizeof(start_digest), 1, file) != 1) {
+        fprintf(stderr, "%s is not a workload trace\n", path);
+        if (file != NULL) fclose(file);
+        return 1;
+    }
+    int start_matches = state_digest() == start_digest;
+
+    // The site's files were loaded; journal commits go to the scratch directory
+    if (replay_enter_directory() != 0) {
+        fprintf(stderr, "Cannot use the scratch directory %s\n", REPLAY_DIR);
+        fclose(file);
+        return 1;
+    }
+    journal_checkpoint();
+
+    TraceRecord *record = (TraceRecord *)malloc(sizeof(TraceRecord));
+    BenchSeries recorded[TRACE_OP_COUNT], replayed[TRACE_OP_COUNT];
+    int mismatches[TRACE_OP_COUNT];
+    memset(recorded, 0, sizeof(recorded));
+    memset(replayed, 0, sizeof(replayed));
+    memset(mismatches, 0, sizeof(mismatches));
+    int has_end = 0, total_mismatches = 0;
+    long records = 0;
+    unsigned long long recorded_final = 0;
+
+    double replay_started = monotonic_us();
+    while (record != NULL && trace_read(file, record)) {
+        if (record->op == TRACE_END) {
+            has_end = 1;
+            recorded_final = record->digest;
+            break;
+        }
+        if (paced) {
+            double wait_us = record->offset_us - (monotonic_us() - replay_started);
+            if (wait_us >= 1000) sleep_ms((int)(wait_us / 1000));
+        }
+        double started = monotonic_us();
+        int result = replay_apply(record);
+        bench_record(&replayed[record->op], started);
+        bench_add(&recorded[record->op], record->latency_us);
+        if (result != record->result) {
+            mismatches[record->op]++;
+            total_mismatches++;
+        }
+        journal_commit(); // as the kiosks and the server do after each action
+        records++;
+    }
+    double wall_seconds = (monotonic_us() - replay_started) / 1e6;
+    fclose(file);
+    free(record);
+
+    unsigned long long final_digest = state_digest();
+    int final_matches = has_end && final_digest == recorded_final;
+
+    fprintf(out, "{\n  \"trace\": \"%s\",\n  \"records\": %ld,\n  \"pace\": \"%s\",\n", path, records,
+            paced ? "recorded" : "fast");
+    fprintf(out, "  \"wall_seconds\": %.3f,\n  \"start_state_match\": %s,\n", wall_seconds,
+            start_matches ? "true" : "false");
+    fprintf(out, "  \"final_digest\": \"%016llx\",\n", final_digest);
+    if (has_end) {
+        fprintf(out, "  \"recorded_final_digest\": \"%016llx\",\n  \"final_state_match\": %s,\n",
+                recorded_final, final_matches ? "true" : "false");
+    } else {
+        fprintf(out, "  \"recorded_final_digest\": null,\n  \"final_state_match\": null,\n");
+    }
+    fprintf(out, "  \"result_mismatches\": %d,\n  \"operations\": [\n", total_mismatches);
+    int written = 0, present = 0;
+    for (int op = 1; op < TRACE_OP_COUNT; op++) present += replayed[op].count > 0;
+    for (int op = 1; op < TRACE_OP_COUNT; op++) {
+        if (replayed[op].count == 0) continue;
+        qsort(recorded[op].samples_us, recorded[op].count, sizeof(double), bench_compare_double);
+        qsort(replayed[op].samples_us, replayed[op].count, sizeof(double), bench_compare_double);
+        double recorded_p50 = bench_percentile(&recorded[op], 50);
+        double replayed_p50 = bench_percentile(&replayed[op], 50);
+        fprintf(out, "    {\"name\": \"%s\", \"count\": %d, \"result_mismatches\": %d, "
+                     "\"recorded_p50_us\": %.0f, \"replay_p50_us\": %.2f, "
+                     "\"recorded_p99_us\": %.0f, \"replay_p99_us\": %.2f, "
+                     "\"recorded_mean_us\": %.2f, \"replay_mean_us\": %.2f, \"p50_ratio\": %.2f}%s\n",
+                trace_op_names[op], replayed[op].count, mismatches[op], recorded_p50, replayed_p50,
+                bench_percentile(&recorded[op], 99), bench_percentile(&replayed[op], 99),
+                recorded[op].total_us / recorded[op].count, replayed[op].total_us / replayed[op].count,
+                recorded_p50 > 0 ? replayed_p50 / recorded_p50 : 0.0, ++written < present ? "," : "");
+        free(recorded[op].samples_us);
+        free(replayed[op].samples_us);
+    }
+    fprintf(out, "  ]\n}\n");
+    return has_end && !final_matches ? 3 : 0;
+}
+
+// Pricing Engine
+// A booking is charged by the lot's tariff for the hours it covers, times
+// an occupancy factor taken when it is made. Occupancy comes from the
+// per-type slot counters kept up to date on every slot change. The tariff
+// rules are compiled at startup into hourly rate tables per vehicle type
+// and day kind (weekday, weekend, holiday), with a prefix sum per day, so
+// pricing a stay is one prefix-sum difference per calendar day and tier
+// and a quote is a few table reads. Rules are read from pricing.txt when
+// the lot has one:
+//   base <bike|car|truck> <rate>
+//   rate <type|all> <weekday|weekend|holiday|all> <start> <end> <rate>
+//   hours <start> <end> <multiplier>                  (every type and day)
+//   tier <type|all> <from hour of the stay> <multiplier>
+//   holiday <YYYY-MM-DD>
+//   occupancy <type|all> <percent> <multiplier>      (from that percent up)
+//   cap <multiplier>                                  (on the occupancy factor)
+// Hours are local and [start, end) ranges may wrap past midnight. Without
+// the file, rates are flat and rise by 25% from 80% full and 50% from 95%.
+typedef struct {
+    int type; // -1 for every type
+    int percent;
+    double factor;
+} OccupancyRule;
+
+// rate and hours lines, applied in file order after the base rates
+typedef struct {
+    int type;     // -1 for every type
+    int day_kind; // -1 for every kind
+    int start, end;
+    double value;
+    int is_factor; // hours: multiplies instead of setting
+} RateRule;
+
+// -1 for "all", TARGET_UNKNOWN for anything that is not a vehicle type
+static int parse_vehicle_target(const char *text) {
+    if (strcmp(text, "all") == 0) return -1;
+    if (strcmp(text, "bike") == 0 || strcmp(text, "car") == 0 || strcmp(text, "truck") == 0) {
+        return slot_type_code(text);
+    }
+    return TARGET_UNKNOWN;
+}
+
+static int parse_day_kind(const char *text) {
+    if (strcmp(text, "weekday") == 0) return DAY_WEEKDAY;
+    if (strcmp(text, "weekend") == 0) return DAY_WEEKEND;
+    if (strcmp(text, "holiday") == 0) return DAY_HOLIDAY;
+    if (strcmp(text, "all") == 0) return -1;
+    return TARGET_UNKNOWN;
+}
+
+static int compare_int(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void pricing_compile(const OccupancyRule *occupancy_rules, int occupancy_count,
+                            const RateRule *rate_rules, int rate_count) {
+    for (int type = 0; type < 3; type++) {
+        for (int percent = 0; percent <= 100; percent++) {
+            double factor = 1.0;
+            int best = -1;
+            // The highest threshold at or below this occupancy applies
+            for (int r = 0; r < occupancy_count; r++) {
+                if ((occupancy_rules[r].type == -1 || occupancy_rules[r].type == type) &&
+                    occupancy_rules[r].percent <= percent && occupancy_rules[r].percent > best) {
+                    best = occupancy_rules[r].percent;
+                    factor = occupancy_rules[r].factor;
+                }
+            }
+            pricing.occupancy[type][percent] = factor;
+        }
+
+        for (int kind = 0; kind < DAY_KINDS; kind++) {
+            for (int h = 0; h < 24; h++) pricing.rate[type][kind][h] = pricing.base[type];
+            for (int r = 0; r < rate_count; r++) {
+                const RateRule *rule = &rate_rules[r];
+                if ((rule->type != -1 && rule->type != type) || (rule->day_kind != -1 && rule->day_kind != kind)) {
+                    continue;
+                }
+                int h = rule->start;
+                do {
+                    if (rule->is_factor) pricing.rate[type][kind][h] *= rule->value;
+                    else pricing.rate[type][kind][h] = rule->value;
+                    h = (h + 1) % 24;
+                } while (h != rule->end % 24);
+            }
+            pricing.day_prefix[type][kind][0] = 0;
+            for (int h = 0; h < 24; h++) {
+                pricing.day_prefix[type][kind][h + 1] = pricing.day_prefix[type][kind][h] + pricing.rate[type][kind][h];
+            }
+        }
+    }
+    qsort(pricing.holidays, pricing.holiday_count, sizeof(int), compare_int);
+
+    // Tiers in order of the hour they start at
+    for (int type = 0; type < 3; type++) {
+        for (int i = 1; i < pricing.tier_count[type]; i++) {
+            for (int j = i; j > 0 && pricing.tier_from[type][j - 1] > pricing.tier_from[type][j]; j--) {
+                double from = pricing.tier_from[type][j], factor = pricing.tier_factor[type][j];
+                pricing.tier_from[type][j] = pricing.tier_from[type][j - 1];
+                pricing.tier_factor[type][j] = pricing.tier_factor[type][j - 1];
+                pricing.tier_from[type][j - 1] = from;
+                pricing.tier_factor[type][j - 1] = factor;
+            }
+        }
+    }
+}
+
+void pricing_load() {
+    OccupancyRule occupancy_rules[32] = {{-1, 80, 1.25}, {-1, 95, 1.5}};
+    RateRule rate_rules[TARIFF_MAX_RULES];
+    int occupancy_count = 2, defaults = 1, rate_count = 0;
+    char line[128], word[16], target[16], kind[16];
+    int line_number = 0;
+
+    memset(&pricing, 0, sizeof(pricing));
+    pricing.base[0] = BIKE_PRICE;
+    pricing.base[1] = CAR_PRICE;
+    pricing.base[2] = TRUCK_PRICE;
+    pricing.max_factor = PRICING_MAX_FACTOR;
+
+    FILE *file = fopen(PRICING_FILE, "r");
+    while (file != NULL && fgets(line, sizeof(line), file) != NULL) {
+        int start, end, percent, year, month, day;
+        double value, factor;
+        line_number++;
+        if (sscanf(line, "%15s", word) != 1 || word[0] == '#') continue;
+
+        // A misspelt type or day kind must not quietly change some other rate
+        target[0] = kind[0] = '\0';
+        sscanf(line, "%*s %15s %15s", target, kind);
+        int typed = strcmp(word, "base") == 0 || strcmp(word, "occupancy") == 0 || strcmp(word, "rate") == 0 ||
+                    strcmp(word, "tier") == 0;
+        if (typed && parse_vehicle_target(target) == TARGET_UNKNOWN) {
+            fprintf(stderr, "%s line %d: unknown vehicle type '%s', line ignored\n", PRICING_FILE, line_number,
+                    target);
+            continue;
+        }
+        if (strcmp(word, "rate") == 0 && parse_day_kind(kind) == TARGET_UNKNOWN) {
+            fprintf(stderr, "%s line %d: unknown day kind '%s', line ignored\n", PRICING_FILE, line_number, kind);
+            continue;
+        }
+
+        if (strcmp(word, "base") == 0 && sscanf(line, "%*s %15s %lf", target, &value) == 2 && value >= 0) {
+            for (int type = 0; type < 3; type++) {
+                if (parse_vehicle_target(target) == -1 || parse_vehicle_target(target) == type) {
+                    pricing.base[type] = value;
+                }
+            }
+        } else if (strcmp(word, "occupancy") == 0 &&
+                   sscanf(line, "%*s %15s %d %lf", target, &percent, &value) == 3 &&
+                   percent >= 0 && percent <= 100 && value > 0) {
+            if (defaults) occupancy_count = defaults = 0; // the lot's own rules replace the defaults
+            if (occupancy_count < (int)(sizeof(occupancy_rules) / sizeof(occupancy_rules[0]))) {
+                occupancy_rules[occupancy_count].type = parse_vehicle_target(target);
+                occupancy_rules[occupancy_count].percent = percent;
+                occupancy_rules[occupancy_count].factor = value;
+                occupancy_count++;
+            }
+        } else if ((strcmp(word, "rate") == 0 &&
+                    sscanf(line, "%*s %15s %15s %d %d %lf", target, kind, &start, &end, &value) == 5) ||
+                   (strcmp(word, "hours") == 0 && sscanf(line, "%*s %d %d %lf", &start, &end, &value) == 3)) {
+            if (start < 0 || start > 23 || end < 0 || end > 24 || start == end || value < 0) continue;
+            if (rate_count == TARIFF_MAX_RULES) continue;
+            RateRule *rule = &rate_rules[rate_count++];
+            rule->is_factor = word[0] == 'h';
+            rule->type = rule->is_factor ? -1 : parse_vehicle_target(target);
+            rule->day_kind = rule->is_factor ? -1 : parse_day_kind(kind);
+            rule->start = start;
+            rule->end = end;
+            rule->value = value;
+        } else if (strcmp(word, "tier") == 0 && sscanf(line, "%*s %15s %lf %lf", target, &value, &factor) == 3) {
+            if (value <= 0 || factor < 0) continue; // value: hour of the stay the tier starts at
+            for (int type = 0; type < 3; type++) {
+                if (parse_vehicle_target(target) != -1 && parse_vehicle_target(target) != type) continue;
+                if (pricing.tier_count[type] == TARIFF_MAX_TIERS) continue;
+                pricing.tier_from[type][pricing.tier_count[type]] = value;
+                pricing.tier_factor[type][pricing.tier_count[type]] = factor;
+                pricing.tier_count[type]++;
+            }
+        } else if (strcmp(word, "holiday") == 0 && sscanf(line, "%*s %d-%d-%d", &year, &month, &day) == 3 &&
+                   pricing.holiday_count < TARIFF_MAX_HOLIDAYS) {
+            pricing.holidays[pricing.holiday_count++] = year * 10000 + month * 100 + day;
+        } else if (strcmp(word, "cap") == 0 && sscanf(line, "%*s %lf", &value) == 1 && value > 0) {
+            pricing.max_factor = value;
+        }
+    }
+    if (file != NULL) fclose(file);
+    pricing_compile(occupancy_rules, occupancy_count, rate_rules, rate_count);
+}
+
+// Percent of the type's slots reserved or occupied
+int slot_type_occupancy(int type) {
+    int in_use = slot_type_counts[type][SLOT_STATE_RESERVED] + slot_type_counts[type][SLOT_STATE_OCCUPIED];
+    int total = in_use + slot_type_counts[type][SLOT_STATE_AVAILABLE];
+    return total > 0 ? in_use * 100 / total : 0;
+}
+
+static double pricing_occupancy_factor(int type) {
+    double factor = pricing.occupancy[type][slot_type_occupancy(type)];
+    return factor < pricing.max_factor ? factor : pricing.max_factor;
+}
+
+// Kind of a local calendar day, counted in days since 1970-01-01. Holidays
+// are looked up by binary search over the sorted dates.
+static int pricing_day_kind(long long local_day) {
+    int year, month, day;
+    civil_from_days(local_day, &year, &month, &day);
+    int date = year * 10000 + month * 100 + day;
+    if (bsearch(&date, pricing.holidays, pricing.holiday_count, sizeof(int), compare_int) != NULL) {
+        return DAY_HOLIDAY;
+    }
+    int weekday = (int)((local_day % 7 + 11) % 7); // 1970-01-01 was a Thursday; 0 is Sunday
+    return weekday == 0 || weekday == 6 ? DAY_WEEKEND : DAY_WEEKDAY;
+}
+
+// Local day number and hour of the day (fractional) at engine time `when`
+static long long pricing_local_day(long long when, double *hour) {
+    long long local = when + utc_offset_at(when);
+    long long day = floor_div(local, 86400);
+    *hour = (local - day * 86400) / 3600.0;
+    return day;
+}
+
+// Tariff cost of hours 0..at of one day, at in [0, 24]
+static double pricing_day_cost_to(int type, int kind, double at) {
+    int hour = (int)at;
+    if (hour >= 24) return pricing.day_prefix[type][kind][24];
+    return pricing.day_prefix[type][kind][hour] + (at - hour) * pricing.rate[type][kind][hour];
+}
+
+// Tariff cost of a span of wall-clock time: one prefix-sum difference per calendar day
+static double pricing_span_cost(int type, long long start, double hours) {
+    double at;
+    long long day = pricing_local_day(start, &at);
+    double cost = 0;
+    while (hours > 1e-9) {
+        int kind = pricing_day_kind(day);
+        double span = hours < 24 - at ? hours : 24 - at;
+        cost += pricing_day_cost_to(type, kind, at + span) - pricing_day_cost_to(type, kind, at);
+        hours -= span;
+        day++; // on to midnight of the next day
+        at = 0;
+    }
+    return cost;
+}
+
+// Tariff cost of the first `hours` of a stay that started at `start`,
+// with each tier's multiplier applied to the hours it covers
+double pricing_stay_cost(int type, long long start, double hours) {
+    int tiers = pricing.tier_count[type];
+    double cost = 0;
+    for (int t = 0; t <= tiers; t++) {
+        double from = t > 0 ? pricing.tier_from[type][t - 1] : 0;
+        double to = t < tiers && pricing.tier_from[type][t] < hours ? pricing.tier_from[type][t] : hours;
+        if (from >= hours) break;
+        if (to <= from) continue;
+        double factor = t > 0 ? pricing.tier_factor[type][t - 1] : 1.0;
+        cost += factor * pricing_span_cost(type, start + (long long)(from * 3600), to - from);
+    }
+    return cost;
+}
+
+// Amount for a booking made now, rounded to cents
+double pricing_booking_amount(int type, double hours) {
+    double amount = pricing_stay_cost(type, now_epoch(), hours) * pricing_occupancy_factor(type);
+    return (long long)(amount * 100 + 0.5) / 100.0;
+}
+
+// Hourly rate for a booking of this type (0 bike, 1 car, 2 truck) starting now
+double pricing_quote(int type) {
+    double hour;
+    long long day = pricing_local_day(now_epoch(), &hour);
+    return pricing.rate[type][pricing_day_kind(day)][(int)hour] * pricing_occupancy_factor(type);
+}
+
+// Rate before any multiplier
+double pricing_base_rate(const char *type) {
+    return pricing.base[slot_type_code(type)];
+}
+
+// Lot Geometry
+// geometry.txt places the lot's slots in zones, one line per zone:
+//   zone <name> <level> <first slot>-<last slot> <metres to the first> [metres per slot]
+//   slot <id> <metres>                       (overrides one slot's distance)
+// Distances are walking metres from the level's entrance or lift. The free
+// slots of each zone and vehicle type form a min-heap on distance, so the
+// nearest one is at the top of some zone's heap. Slots that leave the free
+// pool stay in their heap until they reach the top and are dropped there.
+// Freed slots are pushed back from the slot change ring, which also carries
+// other kiosks' changes with --shared-slots. Slots no zone covers form zone
+// "main" on level 0, behind the listed ones. Without the file every slot is
+// there at distance 0, so the lowest free slot number comes first.
+static int geometry_before(int a, int b) {
+    if (slot_distance[a] != slot_distance[b]) return slot_distance[a] < slot_distance[b];
+    return slots[a].slot_id < slots[b].slot_id;
+}
+
+static void zone_heap_push(int slot_index) {
+    LotZone *zone = &lot_zones[slot_zone[slot_index]];
+    int type = slot_type_code(slots[slot_index].type);
+    int *heap = &zone_heaps[zone->heap_start[type]];
+    int i = zone->heap_count[type]++;
+    while (i > 0 && geometry_before(slot_index, heap[(i - 1) / 2])) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i] = slot_index;
+    slot_queued[slot_index] = 1;
+}
+
+static void zone_heap_pop(LotZone *zone, int type) {
+    int *heap = &zone_heaps[zone->heap_start[type]];
+    int count = --zone->heap_count[type], last = heap[count], i = 0;
+    slot_queued[heap[0]] = 0;
+    while (2 * i + 1 < count) {
+        int child = 2 * i + 1;
+        if (child + 1 < count && geometry_before(heap[child + 1], heap[child])) child++;
+        if (!geometry_before(heap[child], last)) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    if (count > 0) heap[i] = last;
+}
+
+// Refills every heap from the slot table
+static void geometry_fill() {
+    geometry_seen_events = __atomic_load_n(&slot_events->head, __ATOMIC_ACQUIRE);
+    for (int z = 0; z < lot_zone_count; z++) {
+        for (int type = 0; type < 3; type++) lot_zones[z].heap_count[type] = 0;
+    }
+    memset(slot_queued, 0, sizeof(slot_queued));
+    for (int i = 0; i < slot_count; i++) {
+        if (strcmp(slots[i].status, "available") == 0) zone_heap_push(i);
+    }
+}
+
+// Puts back the slots freed since the last pick
+static void geometry_sync() {
+    unsigned int head = __atomic_load_n(&slot_events->head, __ATOMIC_ACQUIRE);
+    if (head - geometry_seen_events > SLOT_EVENT_RING) {
+        geometry_fill(); // fell behind the ring
+        return;
+    }
+    for (; geometry_seen_events != head; geometry_seen_events++) {
+        int index = slot_events->slots[geometry_seen_events & (SLOT_EVENT_RING - 1)];
+        if (index >= 0 && index < slot_count && !slot_queued[index] &&
+            strcmp(slots[index].status, "available") == 0) {
+            zone_heap_push(index);
+        }
+    }
+}
+
+static int geometry_zone(const char *name, int level) {
+    for (int z = 0; z < lot_zone_count; z++) {
+        if (strcmp(lot_zones[z].name, name) == 0) return z;
+    }
+    if (lot_zone_count == GEOMETRY_MAX_ZONES) return -1;
+    LotZone *zone = &lot_zones[lot_zone_count];
+    memset(zone, 0, sizeof(LotZone));
+    copy_field(zone->name, sizeof(zone->name), name);
+    zone->level = level;
+    return lot_zone_count++;
+}
+
+// Reads geometry.txt for the slots loaded now and builds the heaps
+void geometry_load() {
+    char line[128], word[16], name[16];
+    int listed = 0;
+
+    lot_zone_count = 0;
+    int main_zone = geometry_zone("main", 0);
+    for (int i = 0; i < slot_count; i++) {
+        slot_zone[i] = main_zone;
+        slot_distance[i] = 0;
+    }
+
+    FILE *file = fopen(GEOMETRY_FILE, "r");
+    while (file != NULL && fgets(line, sizeof(line), file) != NULL) {
+        int level, first, last, metres, step = 0, index;
+        if (sscanf(line, "%15s", word) != 1 || word[0] == '#') continue;
+
+        if (strcmp(word, "zone") == 0 &&
+            sscanf(line, "%*s %15s %d %d-%d %d %d", name, &level, &first, &last, &metres, &step) >= 5 &&
+            first <= last && metres >= 0 && step >= 0) {
+            int zone = geometry_zone(name, level);
+            if (zone == -1) continue;
+            for (int id = first; id <= last; id++) {
+                if ((index = find_slot_index(id)) == -1) continue;
+                slot_zone[index] = zone;
+                slot_distance[index] = metres + (id - first) * step;
+                listed = 1;
+            }
+        } else if (strcmp(word, "slot") == 0 && sscanf(line, "%*s %d %d", &first, &metres) == 2 &&
+                   metres >= 0 && (index = find_slot_index(first)) != -1) {
+            slot_distance[index] = metres;
+        }
+    }
+    if (file != NULL) fclose(file);
+
+    // Unlisted slots come after every listed one
+    for (int i = 0; i < slot_count && listed; i++) {
+        if (slot_zone[i] == main_zone) slot_distance[i] = GEOMETRY_UNLISTED;
+    }
+
+    // Each zone and type gets the range of zone_heaps its slots can fill
+    int sizes[GEOMETRY_MAX_ZONES][3], start = 0;
+    memset(sizes, 0, sizeof(sizes));
+    for (int i = 0; i < slot_count; i++) sizes[slot_zone[i]][slot_type_code(slots[i].type)]++;
+    for (int z = 0; z < lot_zone_count; z++) {
+        for (int type = 0; type < 3; type++) {
+            lot_zones[z].heap_start[type] = start;
+            start += sizes[z][type];
+        }
+    }
+    geometry_fill();
+    geometry_ready = 1;
+}
+
+// Nearest free slot of the type (0 bike, 1 car, 2 truck), on `level` when
+// one is free there (LEVEL_ANY for any level). Returns its slot id, 0 if none.
+int slot_pick_nearest(int type, int level) {
+    int best = -1;
+    if (!geometry_ready) geometry_load();
+    geometry_sync();
+    for (int pass = 0; pass < 2 && best == -1; pass++) {
+        for (int z = 0; z < lot_zone_count; z++) {
+            LotZone *zone = &lot_zones[z];
+            if (pass == 0 && level != LEVEL_ANY && zone->level != level) continue;
+            // Tops taken since they were queued are dropped on the way
+            while (zone->heap_count[type] > 0 &&
+                   strcmp(slots[zone_heaps[zone->heap_start[type]]].status, "available") != 0) {
+                zone_heap_pop(zone, type);
+            }
+            if (zone->heap_count[type] == 0) continue;
+            int top = zone_heaps[zone->heap_start[type]];
+            if (best == -1 || geometry_before(top, best)) best = top;
+        }
+        if (level == LEVEL_ANY) break;
+    }
+    return best == -1 ? 0 : slots[best].slot_id;
+}
+
+// "level -1, zone B2, 17 m" for a slot index
+char *slot_location(int slot_index, char *out) {
+    if (!geometry_ready) geometry_load();
+    const LotZone *zone = &lot_zones[slot_zone[slot_index]];
+    if (slot_distance[slot_index] >= GEOMETRY_UNLISTED) sprintf(out, "level %d, zone %s", zone->level, zone->name);
+    else sprintf(out, "level %d, zone %s, %d m", zone->level, zone->name, slot_distance[slot_index]);
+    return out;
+}
+
+// Reservation Timer Wheel
+// Each active reservation has up to two timers in a hierarchical wheel: one
+// for the end of its booked time (overstay) and, while it is unpaid, one for
+// the end of its hold. Level 0 has one-second slots and each higher level
+// has slots 64 times longer. When a level wraps, the next level's current
+// slot is spread back over the lower levels. Advancing the wheel costs one
+// step per elapsed second plus the timers that move or expire. Expired
+// overstay timers put the reservation on the overstay list, so the overstay
+// screen and the metrics only look at reservations that overran; expired
+// holds release the slot.
+static void wheel_unlink(int timer) {
+    TimerNode *node = &timer_nodes[timer];
+    if (node->level == -1) return;
+    if (node->prev != -1) timer_nodes[node->prev].next = node->next;
+    else wheel_heads[node->level][node->slot] = node->next;
+    if (node->next != -1) timer_nodes[node->next].prev = node->prev;
+    node->level = -1;
+}
+
+static void wheel_insert(int timer, long long expires) {
+    TimerNode *node = &timer_nodes[timer];
+    long long delta = expires - wheel_now;
+    int level = 0;
+    while (level < WHEEL_LEVELS - 1 && delta >= (1LL << (WHEEL_BITS * (level + 1)))) level++;
+    // Beyond the top level's range: park in its last slot and re-place on the next pass
+    long long when = delta < (1LL << (WHEEL_BITS * WHEEL_LEVELS)) ? expires
+                   : wheel_now + (1LL << (WHEEL_BITS * WHEEL_LEVELS)) - 1;
+    node->expires = expires;
+    node->level = level;
+    node->slot = (int)((when >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1));
+    node->prev = -1;
+    node->next = wheel_heads[level][node->slot];
+    if (node->next != -1) timer_nodes[node->next].prev = timer;
+    wheel_heads[level][node->slot] = timer;
+}
+
+static void overstay_list_add(int index) {
+    if (overstay_position[index] != -1) return;
+    overstay_position[index] = overstay_count;
+    overstay_list[overstay_count++] = index;
+    overstay_alerts_total++;
+}
+
+static void overstay_list_remove(int index) {
+    int position = overstay_position[index];
+    if (position == -1) return;
+    int last = overstay_list[--overstay_count];
+    overstay_list[position] = last;
+    overstay_position[last] = position;
+    overstay_position[index] = -1;
+}
+
+// Schedules the timer, or fires it at once when it is already due
+static void timer_arm(int timer, long long expires) {
+    if (expires > wheel_now) {
+        wheel_insert(timer, expires);
+    } else if (timer % TIMER_KINDS == TIMER_OVERSTAY) {
+        overstay_list_add(timer / TIMER_KINDS);
+    } else if (hold_expired_count < MAX_RESERVATIONS) {
+        hold_expired[hold_expired_count++] = timer / TIMER_KINDS;
+    }
+}
+
+// Brings the reservation's timers and overstay entry in line with its status
+// and payment. Called whenever a reservation is added, paid or changes status.
+void reservation_timers_track(int index) {
+    if (!timers_ready) return; // the startup rebuild covers rows loaded before it
+    wheel_unlink(index * TIMER_KINDS + TIMER_OVERSTAY);
+    wheel_unlink(index * TIMER_KINDS + TIMER_HOLD);
+    overstay_list_remove(index);
+    if (strcmp(reservations[index].status, "active") != 0) return;
+
+    long long start = reservations[index].start_time;
+    if (start <= 0) return;
+    timer_arm(index * TIMER_KINDS + TIMER_OVERSTAY,
+              start + (long long)(reservations[index].duration_hours * 3600));
+    if (hold_ttl_seconds > 0 && !reservation_paid[index]) {
+        timer_arm(index * TIMER_KINDS + TIMER_HOLD, start + hold_ttl_seconds);
+    }
+}
+
+// Marks the reservation paid so its hold is not released
+void reservation_timers_paid(int reservation_id) {
+    int index = find_reservation_index(reservation_id);
+    if (index == -1) return;
+    reservation_paid[index] = 1;
+    reservation_timers_track(index);
+}
+
+void timers_rebuild() {
+    for (int level = 0; level < WHEEL_LEVELS; level++) {
+        for (int slot = 0; slot < WHEEL_SLOTS; slot++) wheel_heads[level][slot] = -1;
+    }
+    for (int t = 0; t < MAX_RESERVATIONS * TIMER_KINDS; t++) timer_nodes[t].level = -1;
+    for (int i = 0; i < MAX_RESERVATIONS; i++) {
+        overstay_position[i] = -1;
+        reservation_paid[i] = 0;
+    }
+    for (int p = 0; p < payment_count; p++) {
+        int index = find_reservation_index(payments[p].reservation_id);
+        if (index != -1 && strcmp(payments[p].status, "completed") == 0) reservation_paid[index] = 1;
+    }
+    overstay_count = 0;
+    hold_expired_count = 0;
+    wheel_now = now_epoch();
+    timers_ready = 1;
+    for (int i = 0; i < reservation_count; i++) reservation_timers_track(i);
+    overstay_alerts_total = 0; // overstays found at startup are not new alerts
+}
+
+static void wheel_cascade(int level, int slot) {
+    int timer = wheel_heads[level][slot];
+    wheel_heads[level][slot] = -1;
+    while (timer != -1) {
+        int next = timer_nodes[timer].next;
+        timer_nodes[timer].level = -1;
+        wheel_insert(timer, timer_nodes[timer].expires);
+        timer = next;
+    }
+}
+
+// Releases the slot of a hold that was not paid in time
+static int expire_hold_row(int index) {
+    if (strcmp(reservations[index].status, "active") != 0 ||
+        reservation_is_paid(reservations[index].reservation_id)) {
+        return ENGINE_ERR_STATE;
+    }
+    set_reservation_status(index, "expired", now_epoch());
+
+    int slot_index = find_slot_index(reservations[index].slot_id);
+    if (slot_index != -1 && slots[slot_index].vehicle_id == reservations[index].vehicle_id &&
+        strcmp(slots[slot_index].status, "available") != 0) {
+        set_slot_state(slot_index, "available", 0, 0, 0);
+    }
+    return ENGINE_OK;
+}
+
+int engine_expire_hold(int reservation_id) {
+    double started = monotonic_us();
+    int index = find_reservation_index(reservation_id);
+    if (index == -1) return ENGINE_ERR_NOT_FOUND;
+    record_store_lock_row('N', reservation_id);
+    int result = expire_hold_row(index);
+    record_store_unlock_row('N');
+    if (result >= 0) hold_expiries_total++;
+    if (capture_file != NULL) capture_call(TRACE_EXPIRE, started, result, "i", reservation_id);
+    return result;
+}
+
+void timers_advance(long long now) {
+    if (!timers_ready) return;
+    while (wheel_now < now) {
+        wheel_now++;
+        for (int level = 1; level < WHEEL_LEVELS; level++) {
+            if ((wheel_now & ((1LL << (WHEEL_BITS * level)) - 1)) != 0) break;
+            wheel_cascade(level, (int)((wheel_now >> (WHEEL_BITS * level)) & (WHEEL_SLOTS - 1)));
+        }
+
+        int slot = (int)(wheel_now & (WHEEL_SLOTS - 1));
+        int timer = wheel_heads[0][slot];
+        wheel_heads[0][slot] = -1;
+        while (timer != -1) {
+            int next = timer_nodes[timer].next;
+            timer_nodes[timer].level = -1;
+            timer_arm(timer, timer_nodes[timer].expires); // re-placed if parked beyond the wheel's range
+            timer = next;
+        }
+    }
+
+    // Holds are released after the walk: releasing one changes timers
+    if (hold_expired_count > 0) {
+        for (int i = 0; i < hold_expired_count; i++) {
+            engine_expire_hold(reservations[hold_expired[i]].reservation_id);
+        }
+        hold_expired_count = 0;
+        journal_commit();
+    }
+}
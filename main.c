@@ -4,6 +4,8 @@
 #include <ctype.h>
 
 
+// Standalone prototype: this users.txt is "name|email|phone|nid|password" with no
+// user ids. It is not the Smart_Park_Final.c table, and --record-store does not cover it.
 #define USERS_FILE "users.txt"
 #define MAX_NAME_LEN 50
 #define MAX_EMAIL_LEN 50